@@ -0,0 +1,1052 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <uv.h>
+
+#include "background.h"
+#include "calibration.h"
+#include "decimate.h"
+#include "depth.h"
+#include "depth_codec.h"
+#include "depth_filter.h"
+#include "depth_summary.h"
+#include "frame_ring.h"
+#include "frame_stats.h"
+#include "frame_sync.h"
+#include "latency.h"
+#include "region.h"
+#include "synthetic.h"
+#include "thread_pool.h"
+#include "video_codec.h"
+#include "world_kernel.h"
+
+
+// Benchmarks the frame-processing kernels on synthetic frames, without
+// a Kinect or node. Each kernel reports ns per pixel, frames per second
+// and heap allocations per frame, as a table or as JSON with --json.
+
+
+namespace
+{
+    struct Options
+    {
+        size_t width;
+        size_t height;
+        size_t frames;
+        size_t threads;
+        std::string filter;
+        bool is_json;
+    };
+
+    struct Result
+    {
+        std::string name;
+        size_t pixels;
+        uint64_t frames;
+        uint64_t nanoseconds;
+        uint64_t allocations;
+        uint64_t allocated_bytes;
+
+        // Per frame, for kernels that hand frames between threads
+        bool has_latency;
+        kinect::LatencyHistogram::Summary latency;
+    };
+
+    typedef std::function<void()> Frame;
+
+    // Rows per band of the world kernels, as WorldFrame uses.
+    size_t const BAND_HEIGHT = 16;
+
+    std::atomic<uint64_t> allocations(0);
+    std::atomic<uint64_t> allocated_bytes(0);
+
+    bool parse_options(int, char **, Options &);
+    bool is_selected(Options const &, char const *);
+    Result measure(Options const &, char const *, Frame const &);
+    void bench_synthetic(Options const &, std::vector<Result> &);
+    void bench_depth(Options const &, std::vector<Result> &);
+    void bench_video(Options const &, std::vector<Result> &);
+    void bench_publish(Options const &, std::vector<Result> &);
+    void bench_dispatch(Options const &, std::vector<Result> &);
+    void bench_world(Options const &, std::vector<Result> &);
+    bool check_world(Options const &);
+    void run_world(kinect::WorldKernel, kinect::WorldParams const &,
+            kinect::WorldTables const &, std::vector<uint8_t> const &,
+            std::vector<uint8_t> const &, kinect::WorldOutput const &,
+            kinect::ThreadPool *);
+    bool is_same_world(kinect::WorldOutput const &,
+            kinect::WorldOutput const &, size_t, char const *);
+    void render_frames(Options const &, std::vector<uint8_t> &,
+            std::vector<uint8_t> &);
+    kinect::WorldParams world_params(Options const &);
+    void print_table(std::vector<Result> const &);
+    void print_json(Options const &, std::vector<Result> const &);
+}
+
+
+// Counts every allocation, so kernels that allocate per frame show up.
+void *operator new(size_t const bytes)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    void *const memory = std::malloc(bytes != 0 ? bytes : 1);
+
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void *operator new[](size_t const bytes)
+{
+    return operator new(bytes);
+}
+
+void operator delete(void *const memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *const memory) noexcept
+{
+    operator delete(memory);
+}
+
+
+int main(int argc, char **argv)
+{
+    Options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(stderr, "Usage: kinect_bench [--width N] [--height N] "
+                "[--frames N] [--threads N] [--filter NAME] [--json]\n");
+        return 1;
+    }
+
+    // The world kernels are checked first, so a wrong kernel fails the run.
+    if (!check_world(options))
+    {
+        return 1;
+    }
+
+    std::vector<Result> results;
+    bench_synthetic(options, results);
+    bench_depth(options, results);
+    bench_video(options, results);
+    bench_publish(options, results);
+    bench_dispatch(options, results);
+    bench_world(options, results);
+
+    if (options.is_json)
+    {
+        print_json(options, results);
+    }
+    else
+    {
+        print_table(results);
+    }
+
+    return 0;
+}
+
+
+namespace
+{
+    // =====================================================================
+    // = Kernels                                                           =
+    // =====================================================================
+
+    void bench_synthetic(Options const &options,
+            std::vector<Result> &results)
+    {
+        kinect::Synthetic::Options synthetic =
+            kinect::Synthetic::default_options();
+        synthetic.width = options.width;
+        synthetic.height = options.height;
+        synthetic.noise = 0.005;
+        kinect::Synthetic source(synthetic);
+
+        std::vector<uint16_t> depth(options.width * options.height);
+        std::vector<uint8_t> video(options.width * options.height * 3);
+        uint64_t frame = 0;
+
+        if (is_selected(options, "synthetic_depth"))
+        {
+            results.push_back(measure(options, "synthetic_depth", [&]()
+                    {
+                        source.render_depth(frame++, depth.data());
+                    }));
+        }
+
+        if (is_selected(options, "synthetic_video"))
+        {
+            results.push_back(measure(options, "synthetic_video", [&]()
+                    {
+                        source.render_video(frame++, video.data());
+                    }));
+        }
+    }
+
+    // What the depth callbacks do on the loop thread: the depth range
+    // and region crop, and decimation to the next pyramid level. Then the
+    // depth codec, as the compressed depth callback runs it, and the depth
+    // filters, on a fresh copy of the frame each time.
+    void bench_depth(Options const &options, std::vector<Result> &results)
+    {
+        std::vector<uint8_t> depth;
+        std::vector<uint8_t> video;
+        render_frames(options, depth, video);
+
+        kinect::DepthUnit const unit = kinect::DepthUnit::RAW;
+        uint16_t const invalid = kinect::invalid_depth(unit);
+        std::vector<uint8_t> mask;
+        kinect::build_depth_mask(unit, 0.5, 3.0, mask);
+
+        size_t const width = options.width;
+        size_t const height = options.height;
+        std::vector<uint8_t> out(depth.size());
+
+        if (is_selected(options, "depth_crop"))
+        {
+            kinect::Region const region = kinect::full_region(width, height);
+            results.push_back(measure(options, "depth_crop", [&]()
+                    {
+                        kinect::crop_depth(depth.data(), width, region, mask,
+                                invalid, out.data());
+                    }));
+        }
+
+        struct
+        {
+            char const *name;
+            kinect::DepthDecimation decimation;
+        }
+        const decimations[] = {
+            { "depth_decimate_nearest", kinect::DepthDecimation::NEAREST },
+            { "depth_decimate_mean", kinect::DepthDecimation::MEAN },
+            { "depth_decimate_median", kinect::DepthDecimation::MEDIAN }
+        };
+
+        for (auto const &decimation : decimations)
+        {
+            if (is_selected(options, decimation.name))
+            {
+                results.push_back(measure(options, decimation.name, [&]()
+                        {
+                            kinect::decimate_depth(decimation.decimation,
+                                    depth.data(), width, height, invalid,
+                                    out.data());
+                        }));
+            }
+        }
+
+        std::vector<uint8_t> encoded(kinect::max_encoded_depth_bytes(
+                    width * height));
+        size_t const encoded_bytes = kinect::encode_depth(unit, depth.data(),
+                width, height, encoded.data());
+
+        if (is_selected(options, "depth_encode"))
+        {
+            results.push_back(measure(options, "depth_encode", [&]()
+                    {
+                        kinect::encode_depth(unit, depth.data(), width,
+                                height, encoded.data());
+                    }));
+        }
+
+        if (is_selected(options, "depth_decode"))
+        {
+            results.push_back(measure(options, "depth_decode", [&]()
+                    {
+                        kinect::decode_depth(encoded.data(), encoded_bytes,
+                                out.data());
+                    }));
+        }
+
+        struct
+        {
+            char const *name;
+            kinect::TemporalFilter temporal;
+            size_t frames;
+            kinect::SpatialFilter spatial;
+            size_t fill;
+        }
+        const filters[] = {
+            { "depth_filter_exponential", kinect::TemporalFilter::EXPONENTIAL,
+                3, kinect::SpatialFilter::OFF, 0 },
+            { "depth_filter_median3", kinect::TemporalFilter::MEDIAN, 3,
+                kinect::SpatialFilter::OFF, 0 },
+            { "depth_filter_median5", kinect::TemporalFilter::MEDIAN, 5,
+                kinect::SpatialFilter::OFF, 0 },
+            { "depth_filter_bilateral", kinect::TemporalFilter::OFF, 3,
+                kinect::SpatialFilter::BILATERAL, 0 },
+            { "depth_filter_fill", kinect::TemporalFilter::OFF, 3,
+                kinect::SpatialFilter::OFF, 8 }
+        };
+
+        for (auto const &filter : filters)
+        {
+            if (!is_selected(options, filter.name))
+            {
+                continue;
+            }
+
+            kinect::DepthFilterOptions filter_options =
+                kinect::DepthFilter::default_options();
+            filter_options.temporal = filter.temporal;
+            filter_options.frames = filter.frames;
+            filter_options.spatial = filter.spatial;
+            filter_options.fill = filter.fill;
+            kinect::DepthFilter depth_filter;
+            depth_filter.set_options(filter_options);
+
+            results.push_back(measure(options, filter.name, [&]()
+                    {
+                        std::memcpy(out.data(), depth.data(), depth.size());
+                        depth_filter.process(unit, out.data(), width, height);
+                    }));
+        }
+
+        // Learning continuously, then against the frozen model
+        kinect::BackgroundModel background;
+        std::vector<uint8_t> foreground(width * height);
+        kinect::BackgroundOptions background_options =
+            kinect::BackgroundModel::default_options();
+        background_options.is_continuous = true;
+        background.learn(background_options);
+
+        for (char const *const name : { "depth_background_learn",
+                "depth_background_foreground" })
+        {
+            if (is_selected(options, name))
+            {
+                results.push_back(measure(options, name, [&]()
+                        {
+                            background.process(unit, depth.data(),
+                                    width * height, foreground.data());
+                        }));
+            }
+
+            background.freeze();
+        }
+
+        // The whole frame, and a 4 x 4 grid of cells as well
+        struct
+        {
+            char const *name;
+            size_t cells;
+        }
+        const summaries[] = {
+            { "depth_summary", 1 },
+            { "depth_summary_grid", 4 }
+        };
+
+        kinect::DepthSummary summary;
+
+        for (auto const &grid : summaries)
+        {
+            if (!is_selected(options, grid.name))
+            {
+                continue;
+            }
+
+            kinect::DepthSummaryOptions summary_options =
+                kinect::DepthSummarizer::default_options();
+            summary_options.columns = grid.cells;
+            summary_options.rows = grid.cells;
+            kinect::DepthSummarizer summarizer;
+            summarizer.set_options(summary_options);
+
+            results.push_back(measure(options, grid.name, [&]()
+                    {
+                        summarizer.summarize(unit, depth.data(), width,
+                                height, 0, summary);
+                    }));
+        }
+    }
+
+    // The encodings of the encoded video callback, as one of its workers
+    // runs them.
+    void bench_video(Options const &options, std::vector<Result> &results)
+    {
+        std::vector<uint8_t> depth;
+        std::vector<uint8_t> video;
+        render_frames(options, depth, video);
+
+        struct
+        {
+            char const *name;
+            kinect::VideoEncoding encoding;
+        }
+        const encodings[] = {
+            { "video_jpeg_420", { kinect::VideoCodec::JPEG, 80,
+                kinect::ChromaSubsampling::BOTH } },
+            { "video_jpeg_444", { kinect::VideoCodec::JPEG, 80,
+                kinect::ChromaSubsampling::FULL } },
+            { "video_qoi", { kinect::VideoCodec::QOI, 0,
+                kinect::ChromaSubsampling::FULL } }
+        };
+
+        kinect::JpegEncoder jpeg;
+        std::vector<uint8_t> encoded;
+
+        for (auto const &encoding : encodings)
+        {
+            if (is_selected(options, encoding.name))
+            {
+                results.push_back(measure(options, encoding.name, [&]()
+                        {
+                            kinect::encode_video(encoding.encoding, jpeg,
+                                    video.data(), options.width,
+                                    options.height, encoded);
+                        }));
+            }
+        }
+    }
+
+    // A frame written into the ring, published with its stats and
+    // acquired by the reader, on one thread.
+    void bench_publish(Options const &options, std::vector<Result> &results)
+    {
+        if (!is_selected(options, "publish"))
+        {
+            return;
+        }
+
+        std::vector<uint8_t> depth;
+        std::vector<uint8_t> video;
+        render_frames(options, depth, video);
+
+        std::vector<uint8_t> memory(depth.size() * kinect::FrameRing::SLOTS);
+        uint8_t *slots[kinect::FrameRing::SLOTS];
+
+        for (size_t i = 0; i < kinect::FrameRing::SLOTS; ++i)
+        {
+            slots[i] = memory.data() + i * depth.size();
+        }
+
+        kinect::FrameRing ring;
+        ring.set_slots(slots);
+        kinect::FrameStats stats;
+        uint32_t timestamp = 0;
+
+        results.push_back(measure(options, "publish", [&]()
+                {
+                    bool dropped;
+                    std::memcpy(ring.write_slot(), depth.data(),
+                            depth.size());
+                    ring.publish(timestamp++, uv_hrtime(), dropped);
+                    stats.count_produced(timestamp, dropped);
+                    stats.count_signal();
+
+                    if (ring.acquire())
+                    {
+                        stats.count_delivered();
+                    }
+                }));
+    }
+
+    // =====================================================================
+    // = Dispatch                                                          =
+    // =====================================================================
+
+    // Frames published on a producer thread and handed to a consumer
+    // thread, as from the libfreenect event thread to the loop, with the
+    // wake-ups merged as uv_async_send() merges them. The consumer is a
+    // std::thread rather than a libuv loop, as the bench is built against
+    // node's libuv headers and links the system libuv, whose loop and
+    // handles differ. The producer waits for each frame to be delivered
+    // before publishing the next, as the consumer would otherwise merge
+    // the signals and the run would time the producer's copies, so every
+    // frame's latency from publishing to delivery is recorded.
+    struct Dispatch
+    {
+        kinect::FrameRing ring;
+        kinect::FrameStats stats;
+        kinect::LatencyHistogram latency;
+        std::vector<uint8_t> const *frame;
+        uint64_t frames;
+
+        // Under mutex
+        std::mutex mutex;
+        std::condition_variable signalled;
+        std::condition_variable delivered;
+        bool is_signalled;
+        bool is_done;
+        uint64_t delivered_frames;
+
+        Dispatch() : frame(nullptr), frames(0), is_signalled(false),
+                is_done(false), delivered_frames(0)
+        {
+            // Empty
+        }
+
+        void produce()
+        {
+            for (uint64_t i = 0; i < frames; ++i)
+            {
+                bool dropped;
+                std::memcpy(ring.write_slot(), frame->data(), frame->size());
+                ring.publish(uint32_t(i), uv_hrtime(), dropped);
+                stats.count_produced(uint32_t(i), dropped);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                is_signalled = true;
+                signalled.notify_one();
+                delivered.wait(lock, [this, i]()
+                        {
+                            return delivered_frames > i;
+                        });
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            is_done = true;
+            signalled.notify_one();
+        }
+
+        void consume()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            for (;;)
+            {
+                signalled.wait(lock, [this]()
+                        {
+                            return is_signalled || is_done;
+                        });
+
+                if (!is_signalled)
+                {
+                    return;
+                }
+
+                is_signalled = false;
+                lock.unlock();
+                deliver();
+                lock.lock();
+            }
+        }
+
+        void deliver()
+        {
+            stats.count_signal();
+
+            if (ring.acquire())
+            {
+                latency.record(uv_hrtime() - ring.read_time());
+                stats.count_delivered();
+
+                std::lock_guard<std::mutex> lock(mutex);
+                ++delivered_frames;
+                delivered.notify_one();
+            }
+        }
+    };
+
+    void bench_dispatch(Options const &options,
+            std::vector<Result> &results)
+    {
+        if (!is_selected(options, "dispatch"))
+        {
+            return;
+        }
+
+        std::vector<uint8_t> depth;
+        std::vector<uint8_t> video;
+        render_frames(options, depth, video);
+
+        std::vector<uint8_t> memory(depth.size() * kinect::FrameRing::SLOTS);
+        uint8_t *slots[kinect::FrameRing::SLOTS];
+
+        for (size_t i = 0; i < kinect::FrameRing::SLOTS; ++i)
+        {
+            slots[i] = memory.data() + i * depth.size();
+        }
+
+        Dispatch dispatch;
+        dispatch.ring.set_slots(slots);
+        dispatch.frame = &depth;
+        dispatch.frames = options.frames;
+
+        uint64_t const start_allocations = allocations;
+        uint64_t const start_bytes = allocated_bytes;
+        uint64_t const start = uv_hrtime();
+
+        std::thread consumer(&Dispatch::consume, &dispatch);
+        dispatch.produce();
+        consumer.join();
+
+        Result result;
+        result.name = "dispatch";
+        result.pixels = options.width * options.height;
+        result.frames = options.frames;
+        result.nanoseconds = uv_hrtime() - start;
+        result.allocations = allocations - start_allocations;
+        result.allocated_bytes = allocated_bytes - start_bytes;
+        result.has_latency = true;
+        result.latency = dispatch.latency.summary();
+        results.push_back(result);
+    }
+
+    // =====================================================================
+    // = World                                                             =
+    // =====================================================================
+
+    // WorldFrame::update and process without the node buffers: the frames
+    // are paired by FrameSync and registered in bands on the pool, by
+    // each kernel the CPU supports.
+    void bench_world(Options const &options, std::vector<Result> &results)
+    {
+        std::vector<uint8_t> depth;
+        std::vector<uint8_t> video;
+        render_frames(options, depth, video);
+
+        kinect::WorldParams const params = world_params(options);
+        kinect::WorldTables tables;
+        kinect::build_world_tables(params, tables);
+
+        size_t const pixels = options.width * options.height;
+        kinect::Region const region = kinect::full_region(options.width,
+                options.height);
+        std::vector<uint8_t> rgba(pixels * 4);
+        std::vector<float> points(pixels * 4);
+        kinect::WorldOutput const out = {
+            region, rgba.data(), points.data(), 4, 0
+        };
+
+        kinect::FrameSync sync;
+        std::vector<uint8_t> depth_frame(depth.size());
+        std::vector<uint8_t> video_frame(video.size()
+                + kinect::WORLD_VIDEO_PADDING);
+        kinect::ThreadPool pool;
+        pool.resize(options.threads);
+        uint32_t timestamp = 0;
+
+        kinect::WorldKernel const kernels[] = {
+            kinect::WorldKernel::SCALAR,
+            kinect::WorldKernel::SSE41,
+            kinect::WorldKernel::AVX2
+        };
+
+        for (kinect::WorldKernel const kernel : kernels)
+        {
+            std::string const name = std::string("world_")
+                + kinect::world_kernel_name(kernel);
+
+            if (!kinect::is_world_kernel_supported(kernel)
+                    || !is_selected(options, name.c_str()))
+            {
+                continue;
+            }
+
+            results.push_back(measure(options, name.c_str(), [&]()
+                    {
+                        kinect::FrameSync::Frame *depth_match;
+                        kinect::FrameSync::Frame *video_match;
+
+                        sync.push_depth(depth.data(), depth.size(),
+                                depth.size(), timestamp, uv_hrtime());
+                        sync.push_video(video.data(), video.size(),
+                                video_frame.size(), timestamp);
+                        timestamp += 1001;
+
+                        if (!sync.match(depth_match, video_match))
+                        {
+                            return;
+                        }
+
+                        sync.consume(*depth_match, *video_match);
+                        depth_frame.swap(depth_match->data);
+                        video_frame.swap(video_match->data);
+
+                        size_t const bands = (options.height + BAND_HEIGHT
+                                - 1) / BAND_HEIGHT;
+                        pool.run(bands, [&](size_t const band)
+                                {
+                                    size_t const begin = band * BAND_HEIGHT;
+                                    kinect::world_rows(kernel, params,
+                                            tables, depth_frame.data(),
+                                            video_frame.data(), out, begin,
+                                            std::min(begin + BAND_HEIGHT,
+                                                options.height));
+                                });
+                    }));
+        }
+    }
+
+    // Registers the same frame with every kernel the CPU supports, in
+    // bands on the pool, and compares it with the scalar kernel run as a
+    // single pass on this thread. The world frame and the colour of each
+    // point must match exactly, and the points must match to rounding,
+    // NaN where the scalar point is NaN. With one thread the pool runs
+    // the bands here, so each kernel must also match itself exactly.
+    bool check_world(Options const &options)
+    {
+        std::vector<uint8_t> depth;
+        std::vector<uint8_t> video;
+        render_frames(options, depth, video);
+        video.resize(video.size() + kinect::WORLD_VIDEO_PADDING);
+
+        kinect::WorldParams const params = world_params(options);
+        kinect::WorldTables tables;
+        kinect::build_world_tables(params, tables);
+
+        size_t const pixels = options.width * options.height;
+        kinect::Region const region = kinect::full_region(options.width,
+                options.height);
+        std::vector<uint8_t> rgba[3];
+        std::vector<float> points[3];
+        kinect::WorldOutput out[3];
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            rgba[i].resize(pixels * 4);
+            points[i].resize(pixels * 4);
+            out[i] = { region, rgba[i].data(), points[i].data(), 4, 0 };
+        }
+
+        // At least 2 threads, so the bands are split even on one CPU
+        kinect::ThreadPool pool;
+        pool.resize(std::max<size_t>(options.threads, 2));
+        kinect::ThreadPool single;
+        single.resize(1);
+
+        kinect::WorldKernel const kernels[] = {
+            kinect::WorldKernel::SCALAR,
+            kinect::WorldKernel::SSE41,
+            kinect::WorldKernel::AVX2
+        };
+
+        run_world(kinect::WorldKernel::SCALAR, params, tables, depth, video,
+                out[0], nullptr);
+        bool is_correct = true;
+
+        for (kinect::WorldKernel const kernel : kernels)
+        {
+            if (!kinect::is_world_kernel_supported(kernel))
+            {
+                continue;
+            }
+
+            std::string const name = std::string("world_")
+                + kinect::world_kernel_name(kernel);
+            run_world(kernel, params, tables, depth, video, out[1], &pool);
+            run_world(kernel, params, tables, depth, video, out[2], &single);
+            is_correct = is_same_world(out[0], out[1], pixels, name.c_str())
+                && is_correct;
+
+            if (rgba[1] != rgba[2] || std::memcmp(points[1].data(),
+                        points[2].data(), pixels * 4 * sizeof(float)) != 0)
+            {
+                std::fprintf(stderr, "%s: 1 and %zu threads differ\n",
+                        name.c_str(), pool.size());
+                is_correct = false;
+            }
+        }
+
+        return is_correct;
+    }
+
+    void run_world(kinect::WorldKernel const kernel,
+            kinect::WorldParams const &params,
+            kinect::WorldTables const &tables,
+            std::vector<uint8_t> const &depth,
+            std::vector<uint8_t> const &video, kinect::WorldOutput const &out,
+            kinect::ThreadPool *const pool)
+    {
+        if (pool == nullptr)
+        {
+            kinect::world_rows(kernel, params, tables, depth.data(),
+                    video.data(), out, 0, params.height);
+            return;
+        }
+
+        size_t const bands = (params.height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+        pool->run(bands, [&](size_t const band)
+                {
+                    size_t const begin = band * BAND_HEIGHT;
+                    kinect::world_rows(kernel, params, tables, depth.data(),
+                            video.data(), out, begin,
+                            std::min(begin + BAND_HEIGHT, params.height));
+                });
+    }
+
+    bool is_same_world(kinect::WorldOutput const &expected,
+            kinect::WorldOutput const &actual, size_t const pixels,
+            char const *const name)
+    {
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            float const *const a = expected.points + 4 * i;
+            float const *const b = actual.points + 4 * i;
+            bool is_same = std::memcmp(expected.rgba + 4 * i,
+                    actual.rgba + 4 * i, 4) == 0
+                && std::memcmp(a + 3, b + 3, sizeof(float)) == 0;
+
+            for (size_t axis = 0; axis < 3; ++axis)
+            {
+                is_same = is_same && (std::isnan(a[axis])
+                        ? std::isnan(b[axis])
+                        : std::fabs(a[axis] - b[axis])
+                            <= 1e-5f * std::max(1.0f, std::fabs(a[axis])));
+            }
+
+            if (!is_same)
+            {
+                std::fprintf(stderr, "%s differs from world_scalar at pixel "
+                        "(%zu, %zu)\n", name, i % expected.region.width,
+                        i / expected.region.width);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    kinect::WorldParams world_params(Options const &options)
+    {
+        kinect::Calibration const calibration = kinect::default_calibration();
+        double const scale = options.width / 640.0;
+        kinect::WorldParams params;
+
+        params.width = options.width;
+        params.height = options.height;
+        params.video_width = options.width;
+        params.video_height = options.height;
+
+        params.depth_unit = kinect::DepthUnit::RAW;
+        params.depth_min = 0.5;
+        params.depth_max = 3.0;
+
+        params.fx_depth = calibration.depth.fx * scale;
+        params.fy_depth = calibration.depth.fy * scale;
+        params.cx_depth = calibration.depth.cx * scale;
+        params.cy_depth = calibration.depth.cy * scale;
+
+        params.fx_video = calibration.video.fx * scale;
+        params.fy_video = calibration.video.fy * scale;
+        params.cx_video = calibration.video.cx * scale;
+        params.cy_video = calibration.video.cy * scale;
+
+        for (size_t row = 0; row < 3; ++row)
+        {
+            for (size_t col = 0; col < 3; ++col)
+            {
+                params.R[3 * row + col] = calibration.R(row, col);
+            }
+
+            params.t[row] = calibration.t(row);
+        }
+
+        return params;
+    }
+
+
+    // =====================================================================
+    // = Harness                                                           =
+    // =====================================================================
+
+    bool parse_options(int const argc, char **const argv, Options &options)
+    {
+        options.width = 640;
+        options.height = 480;
+        options.frames = 200;
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+        options.is_json = false;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string const arg = argv[i];
+
+            if (arg == "--json")
+            {
+                options.is_json = true;
+                continue;
+            }
+
+            if (i + 1 == argc)
+            {
+                return false;
+            }
+
+            char const *const value = argv[++i];
+            size_t *const sizes[] = {
+                &options.width, &options.height, &options.frames,
+                &options.threads
+            };
+            char const *const names[] = {
+                "--width", "--height", "--frames", "--threads"
+            };
+            bool is_known = false;
+
+            for (size_t name = 0; name < 4; ++name)
+            {
+                if (arg == names[name])
+                {
+                    char *end;
+                    long const number = std::strtol(value, &end, 10);
+
+                    if (*end != '\0' || number <= 0 || number > 1 << 20)
+                    {
+                        return false;
+                    }
+
+                    *sizes[name] = size_t(number);
+                    is_known = true;
+                }
+            }
+
+            if (arg == "--filter")
+            {
+                options.filter = value;
+                is_known = true;
+            }
+
+            if (!is_known)
+            {
+                return false;
+            }
+        }
+
+        return options.width <= 4096 && options.height <= 4096;
+    }
+
+    // Kernels whose name contains the filter.
+    bool is_selected(Options const &options, char const *const name)
+    {
+        return std::string(name).find(options.filter) != std::string::npos;
+    }
+
+    // Times the frames after a tenth as many to warm the caches and the
+    // pools up.
+    Result measure(Options const &options, char const *const name,
+            Frame const &frame)
+    {
+        for (size_t i = 0; i < std::max<size_t>(1, options.frames / 10); ++i)
+        {
+            frame();
+        }
+
+        uint64_t const start_allocations = allocations;
+        uint64_t const start_bytes = allocated_bytes;
+        uint64_t const start = uv_hrtime();
+
+        for (size_t i = 0; i < options.frames; ++i)
+        {
+            frame();
+        }
+
+        Result result;
+        result.name = name;
+        result.pixels = options.width * options.height;
+        result.frames = options.frames;
+        result.nanoseconds = uv_hrtime() - start;
+        result.allocations = allocations - start_allocations;
+        result.allocated_bytes = allocated_bytes - start_bytes;
+        result.has_latency = false;
+        return result;
+    }
+
+    // The first synthetic depth and video frames, with noise so the
+    // kernels see realistic data.
+    void render_frames(Options const &options, std::vector<uint8_t> &depth,
+            std::vector<uint8_t> &video)
+    {
+        kinect::Synthetic::Options synthetic =
+            kinect::Synthetic::default_options();
+        synthetic.width = options.width;
+        synthetic.height = options.height;
+        synthetic.noise = 0.005;
+        kinect::Synthetic source(synthetic);
+
+        depth.resize(options.width * options.height * 2);
+        video.resize(options.width * options.height * 3);
+        source.render_depth(0, reinterpret_cast<uint16_t *>(depth.data()));
+        source.render_video(0, video.data());
+    }
+
+    void print_table(std::vector<Result> const &results)
+    {
+        std::printf("%-24s %10s %10s %12s %12s\n", "kernel", "ns/pixel",
+                "frames/s", "allocs/frame", "bytes/frame");
+
+        for (Result const &result : results)
+        {
+            double const frames = double(result.frames);
+            std::printf("%-24s %10.3f %10.1f %12.2f %12.0f\n",
+                    result.name.c_str(),
+                    result.nanoseconds / (frames * result.pixels),
+                    frames * 1e9 / result.nanoseconds,
+                    result.allocations / frames,
+                    result.allocated_bytes / frames);
+        }
+
+        for (Result const &result : results)
+        {
+            if (result.has_latency)
+            {
+                std::printf("%s latency: p50 %.1f us, p99 %.1f us, "
+                        "max %.1f us over %llu frames\n",
+                        result.name.c_str(), result.latency.p50 / 1e3,
+                        result.latency.p99 / 1e3, result.latency.max / 1e3,
+                        (unsigned long long) result.latency.count);
+            }
+        }
+    }
+
+    void print_json(Options const &options,
+            std::vector<Result> const &results)
+    {
+        std::printf("{\n  \"width\": %zu,\n  \"height\": %zu,\n"
+                "  \"frames\": %zu,\n  \"threads\": %zu,\n"
+                "  \"cpus\": %u,\n  \"best_world_kernel\": \"%s\",\n"
+                "  \"results\": [", options.width, options.height,
+                options.frames, options.threads,
+                std::thread::hardware_concurrency(),
+                kinect::world_kernel_name(kinect::best_world_kernel()));
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            Result const &result = results[i];
+            double const frames = double(result.frames);
+            std::printf("%s\n    {\"name\": \"%s\", \"ns_per_pixel\": %.4f, "
+                    "\"frames_per_second\": %.2f, "
+                    "\"allocations_per_frame\": %.3f, "
+                    "\"allocated_bytes_per_frame\": %.1f, "
+                    "\"nanoseconds\": %llu",
+                    i == 0 ? "" : ",", result.name.c_str(),
+                    result.nanoseconds / (frames * result.pixels),
+                    frames * 1e9 / result.nanoseconds,
+                    result.allocations / frames,
+                    result.allocated_bytes / frames,
+                    (unsigned long long) result.nanoseconds);
+
+            if (result.has_latency)
+            {
+                std::printf(", \"latency_ns\": {\"p50\": %llu, "
+                        "\"p99\": %llu, \"max\": %llu}",
+                        (unsigned long long) result.latency.p50,
+                        (unsigned long long) result.latency.p99,
+                        (unsigned long long) result.latency.max);
+            }
+
+            std::printf("}");
+        }
+
+        std::printf("\n  ]\n}\n");
+    }
+}
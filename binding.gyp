@@ -4,16 +4,84 @@
     'sources': [
       'src/async_handle.cc',
       'src/async_handles.cc',
+      'src/background.cc',
+      'src/bayer.cc',
+      'src/calibration.cc',
       'src/context.cc',
+      'src/decimate.cc',
+      'src/demosaic.cc',
+      'src/depth.cc',
+      'src/depth_codec.cc',
+      'src/depth_encoder.cc',
+      'src/depth_filter.cc',
+      'src/depth_processor.cc',
+      'src/depth_summary.cc',
+      'src/device.cc',
+      'src/frame_buffers.cc',
+      'src/frame_mode.cc',
+      'src/frame_ring.cc',
+      'src/frame_source.cc',
+      'src/frame_stats.cc',
+      'src/frame_sync.cc',
+      'src/frame_view.cc',
+      'src/latency.cc',
+      'src/recorder.cc',
+      'src/region.cc',
+      'src/replay.cc',
+      'src/synthetic.cc',
+      'src/thread_pool.cc',
       'src/util.cc',
-      'src/world_frame.cc'
+      'src/video_codec.cc',
+      'src/video_encoder.cc',
+      'src/worker.cc',
+      'src/world_frame.cc',
+      'src/world_kernel.cc'
     ],
     'include_dirs': [
       '/usr/include/eigen3',
       '/usr/include/libfreenect',
       '/usr/include/libusb-1.0'
     ],
-    'libraries': ['-lfreenect'],
+    'libraries': ['-lfreenect', '-ljpeg'],
+    'cflags_cc': [
+      '-O3',
+      '-march=native',
+      '-fdiagnostics-color=always',
+      '-std=c++11'
+    ],
+    'cflags_cc!': ['-fno-exceptions'],
+  }, {
+    'target_name': 'kinect_bench',
+    'type': 'executable',
+    'sources': [
+      'bench/bench.cc',
+      'src/background.cc',
+      'src/calibration.cc',
+      'src/decimate.cc',
+      'src/depth.cc',
+      'src/depth_codec.cc',
+      'src/depth_filter.cc',
+      'src/depth_summary.cc',
+      'src/frame_ring.cc',
+      'src/frame_source.cc',
+      'src/frame_stats.cc',
+      'src/frame_sync.cc',
+      'src/latency.cc',
+      'src/region.cc',
+      'src/synthetic.cc',
+      'src/thread_pool.cc',
+      'src/video_codec.cc',
+      'src/world_kernel.cc'
+    ],
+    'include_dirs': [
+      'src',
+      '/usr/include/eigen3',
+      '/usr/include/libfreenect',
+      '/usr/include/libusb-1.0'
+    ],
+    # Only libuv's threads, locks and clock, which are the same in node's
+    # 0.10 headers and the system libuv. Loops and handles are not.
+    'libraries': ['-luv', '-ljpeg', '-lpthread'],
     'cflags_cc': [
       '-O3',
       '-march=native',
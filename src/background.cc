@@ -0,0 +1,210 @@
+#include <algorithm>
+
+#include "background.h"
+
+
+namespace
+{
+    struct Threshold
+    {
+        float deviations_squared;
+        float margin;
+    };
+
+    template <bool IS_RAW> void learn_frame(uint16_t const *, size_t,
+            uint16_t, float *, float *, uint16_t *);
+    template <bool IS_RAW> void find_foreground(uint16_t const *, size_t,
+            Threshold const &, float const *, float const *,
+            uint16_t const *, uint8_t *);
+}
+
+
+namespace kinect
+{
+    BackgroundOptions BackgroundModel::default_options()
+    {
+        BackgroundOptions options;
+        options.frames = 30;
+        options.is_continuous = false;
+        options.deviations = 3.0f;
+        options.margin = 0;
+        return options;
+    }
+
+    BackgroundModel::BackgroundModel() : is_active_(false),
+            is_learning_(false), learned_frames_(0),
+            options_(default_options()), is_reset_(true),
+            unit_(DepthUnit::RAW)
+    {
+        uv_mutex_init(&mutex_);
+    }
+
+    BackgroundModel::~BackgroundModel()
+    {
+        uv_mutex_destroy(&mutex_);
+    }
+
+    bool BackgroundModel::is_active() const
+    {
+        return is_active_;
+    }
+
+    bool BackgroundModel::is_learning() const
+    {
+        return is_learning_;
+    }
+
+    uint64_t BackgroundModel::learned_frames() const
+    {
+        return learned_frames_;
+    }
+
+    // Carries on from the model learned so far, if any.
+    void BackgroundModel::learn(BackgroundOptions const &options)
+    {
+        uv_mutex_lock(&mutex_);
+        options_ = options;
+        is_learning_ = true;
+        is_active_ = true;
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void BackgroundModel::freeze()
+    {
+        is_learning_ = false;
+    }
+
+    void BackgroundModel::reset()
+    {
+        uv_mutex_lock(&mutex_);
+        is_learning_ = false;
+        is_active_ = false;
+        is_reset_ = true;
+        learned_frames_ = 0;
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void BackgroundModel::process(DepthUnit const unit,
+            uint8_t const *const depth, size_t const pixels,
+            uint8_t *const foreground)
+    {
+        uv_mutex_lock(&mutex_);
+
+        uint16_t const *const values =
+            reinterpret_cast<uint16_t const *>(depth);
+        bool const is_raw = unit == DepthUnit::RAW;
+
+        if (is_reset_ || unit != unit_ || pixels != samples_.size())
+        {
+            unit_ = unit;
+            mean_.assign(pixels, 0.0f);
+            variance_.assign(pixels, 0.0f);
+            samples_.assign(pixels, 0);
+            learned_frames_ = 0;
+            is_reset_ = false;
+        }
+
+        if (is_learning_)
+        {
+            uint16_t const window = uint16_t(std::min<size_t>(options_.frames,
+                        UINT16_MAX));
+
+            if (is_raw)
+            {
+                learn_frame<true>(values, pixels, window, mean_.data(),
+                        variance_.data(), samples_.data());
+            }
+            else
+            {
+                learn_frame<false>(values, pixels, window, mean_.data(),
+                        variance_.data(), samples_.data());
+            }
+
+            if (++learned_frames_ >= options_.frames
+                    && !options_.is_continuous)
+            {
+                is_learning_ = false;
+            }
+        }
+
+        Threshold const threshold = {
+            options_.deviations * options_.deviations,
+            float(options_.margin != 0 ? options_.margin
+                    : default_depth_threshold(unit))
+        };
+
+        if (is_raw)
+        {
+            find_foreground<true>(values, pixels, threshold, mean_.data(),
+                    variance_.data(), samples_.data(), foreground);
+        }
+        else
+        {
+            find_foreground<false>(values, pixels, threshold, mean_.data(),
+                    variance_.data(), samples_.data(), foreground);
+        }
+
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void pack_mask(uint8_t const *const mask, size_t const pixels,
+            uint8_t *const bits)
+    {
+        std::fill(bits, bits + (pixels + 7) / 8, 0);
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            bits[i / 8] |= (mask[i] & 1) << (i % 8);
+        }
+    }
+}
+
+
+namespace
+{
+    // Each valid value is weighted 1 / samples, so the first window of
+    // samples are averaged equally and later ones decay exponentially.
+    template <bool IS_RAW> void learn_frame(uint16_t const *const values,
+            size_t const pixels, uint16_t const window, float *const mean,
+            float *const variance, uint16_t *const samples)
+    {
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            float const code = kinect::depth_to_code<IS_RAW>(values[i]);
+
+            if (code == 0.0f)
+            {
+                continue;
+            }
+
+            if (samples[i] < window)
+            {
+                ++samples[i];
+            }
+
+            float const weight = 1.0f / samples[i];
+            float const difference = code - mean[i];
+            mean[i] += weight * difference;
+            variance[i] = (1.0f - weight)
+                * (variance[i] + weight * difference * difference);
+        }
+    }
+
+    // Valid pixels nearer than the background, or where the background
+    // was never seen.
+    template <bool IS_RAW> void find_foreground(uint16_t const *const values,
+            size_t const pixels, Threshold const &threshold,
+            float const *const mean, float const *const variance,
+            uint16_t const *const samples, uint8_t *const foreground)
+    {
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            float const code = kinect::depth_to_code<IS_RAW>(values[i]);
+            float const nearer = mean[i] - code;
+            bool const is_foreground = code != 0.0f && (samples[i] == 0
+                    || (nearer > threshold.margin && nearer * nearer
+                        > threshold.deviations_squared * variance[i]));
+            foreground[i] = is_foreground ? 255 : 0;
+        }
+    }
+}
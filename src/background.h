@@ -0,0 +1,82 @@
+#ifndef BACKGROUND_H
+#define BACKGROUND_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <uv.h>
+
+#include "depth.h"
+
+
+namespace kinect
+{
+    struct BackgroundOptions
+    {
+        // Frames averaged into the model. Learning then stops, unless it is
+        // continuous, when the model keeps following the scene with this
+        // window.
+        size_t frames;
+        bool is_continuous;
+
+        // A pixel is foreground when it is nearer than the background by
+        // both this many standard deviations and the margin, in the
+        // frame's unit. A margin of 0 is the unit's default.
+        float deviations;
+        uint16_t margin;
+    };
+
+    // A running mean and variance of each depth pixel over the frames it
+    // learns from, and the foreground mask of each frame against it. Run
+    // on one worker thread at a time, controlled from the loop thread.
+    class BackgroundModel
+    {
+        public:
+            static BackgroundOptions default_options();
+
+            BackgroundModel();
+            ~BackgroundModel();
+
+            // Learning or holding a learned model
+            bool is_active() const;
+            bool is_learning() const;
+            uint64_t learned_frames() const;
+
+            void learn(BackgroundOptions const &options);
+            void freeze();
+            void reset();
+
+            // Worker thread. Learns from the frame while learning and
+            // writes its mask, 255 where foreground and 0 elsewhere.
+            void process(DepthUnit unit, uint8_t const *depth, size_t pixels,
+                    uint8_t *foreground);
+
+        private:
+            BackgroundModel(BackgroundModel const &that) = delete;
+
+            std::atomic<bool> is_active_;
+            std::atomic<bool> is_learning_;
+            std::atomic<uint64_t> learned_frames_;
+
+            // Shared, under mutex_
+            uv_mutex_t mutex_;
+            BackgroundOptions options_;
+            bool is_reset_;
+
+            // Worker thread, under mutex_. Depth as codes that grow with
+            // distance, with the samples each pixel has had, up to the
+            // window.
+            DepthUnit unit_;
+            std::vector<float> mean_;
+            std::vector<float> variance_;
+            std::vector<uint16_t> samples_;
+    };
+
+    // Packs a mask into 1 bit per pixel, the first pixel in the lowest bit.
+    void pack_mask(uint8_t const *mask, size_t pixels, uint8_t *bits);
+}
+
+
+#endif  // BACKGROUND_H
@@ -0,0 +1,265 @@
+#include <immintrin.h>
+
+#include "bayer.h"
+
+
+using kinect::BayerKernel;
+
+
+namespace
+{
+    void rows_scalar(uint8_t const *, size_t, size_t, uint8_t *, size_t,
+            size_t);
+    void rows_sse41(uint8_t const *, size_t, size_t, uint8_t *, size_t,
+            size_t);
+    void pixel(uint8_t const *, size_t, size_t, uint8_t *, size_t, size_t);
+    size_t reflect(ptrdiff_t, size_t);
+    uint8_t average(uint8_t, uint8_t);
+}
+
+
+namespace kinect
+{
+    bool is_bayer_kernel_supported(BayerKernel const kernel)
+    {
+        switch (kernel)
+        {
+            case BayerKernel::SCALAR:
+                return true;
+            case BayerKernel::SSE41:
+                return __builtin_cpu_supports("sse4.1");
+        }
+
+        return false;
+    }
+
+    BayerKernel best_bayer_kernel()
+    {
+        if (is_bayer_kernel_supported(BayerKernel::SSE41))
+        {
+            return BayerKernel::SSE41;
+        }
+
+        return BayerKernel::SCALAR;
+    }
+
+    void demosaic_rows(BayerKernel const kernel, uint8_t const *const bayer,
+            size_t const width, size_t const height, uint8_t *const rgb,
+            size_t const begin, size_t const end)
+    {
+        switch (kernel)
+        {
+            case BayerKernel::SCALAR:
+                rows_scalar(bayer, width, height, rgb, begin, end);
+                break;
+            case BayerKernel::SSE41:
+                rows_sse41(bayer, width, height, rgb, begin, end);
+                break;
+        }
+    }
+
+    void demosaic_half(uint8_t const *const bayer, size_t const width,
+            size_t const height, uint8_t *rgb)
+    {
+        for (size_t y = 0; y + 1 < height; y += 2)
+        {
+            uint8_t const *const top = bayer + width * y;
+            uint8_t const *const bottom = top + width;
+
+            for (size_t x = 0; x + 1 < width; x += 2)
+            {
+                rgb[0] = top[x + 1];
+                rgb[1] = average(top[x], bottom[x + 1]);
+                rgb[2] = bottom[x];
+                rgb += 3;
+            }
+        }
+    }
+}
+
+
+namespace
+{
+    // = Scalar ============================================================
+
+    // The reference implementation. Averages of four round twice, like
+    // the vectorized kernel.
+    void pixel(uint8_t const *const bayer, size_t const width,
+            size_t const height, uint8_t *const rgb, size_t const x,
+            size_t const y)
+    {
+        auto const at = [=](ptrdiff_t const dx, ptrdiff_t const dy)
+        {
+            return bayer[width * reflect(y + dy, height)
+                    + reflect(x + dx, width)];
+        };
+
+        uint8_t const centre = at(0, 0);
+        uint8_t const horizontal = average(at(-1, 0), at(1, 0));
+        uint8_t const vertical = average(at(0, -1), at(0, 1));
+        uint8_t const cross = average(horizontal, vertical);
+        uint8_t const diagonal = average(average(at(-1, -1), at(1, -1)),
+                average(at(-1, 1), at(1, 1)));
+
+        uint8_t *const out = rgb + 3 * (width * y + x);
+
+        // G R
+        // B G
+        if (y % 2 == 0)
+        {
+            out[0] = x % 2 == 0 ? horizontal : centre;
+            out[1] = x % 2 == 0 ? centre : cross;
+            out[2] = x % 2 == 0 ? vertical : diagonal;
+        }
+        else
+        {
+            out[0] = x % 2 == 0 ? diagonal : vertical;
+            out[1] = x % 2 == 0 ? cross : centre;
+            out[2] = x % 2 == 0 ? centre : horizontal;
+        }
+    }
+
+    void rows_scalar(uint8_t const *const bayer, size_t const width,
+            size_t const height, uint8_t *const rgb, size_t const begin,
+            size_t const end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                pixel(bayer, width, height, rgb, x, y);
+            }
+        }
+    }
+
+    size_t reflect(ptrdiff_t const i, size_t const n)
+    {
+        if (i < 0)
+        {
+            return -i;
+        }
+
+        return size_t(i) < n ? i : 2 * n - 2 - i;
+    }
+
+    uint8_t average(uint8_t const a, uint8_t const b)
+    {
+        return (a + b + 1) >> 1;
+    }
+
+
+    // = SSE4.1 ============================================================
+
+    // Shuffles gathering the bytes of 16 planar R, G and B values into 48
+    // bytes of packed RGB.
+    struct Interleave
+    {
+        alignas(16) uint8_t masks[3][3][16];
+
+        Interleave()
+        {
+            for (size_t chunk = 0; chunk < 3; ++chunk)
+            {
+                for (size_t channel = 0; channel < 3; ++channel)
+                {
+                    for (size_t i = 0; i < 16; ++i)
+                    {
+                        size_t const byte = 16 * chunk + i;
+                        masks[chunk][channel][i] = byte % 3 == channel
+                                ? byte / 3 : 0x80;
+                    }
+                }
+            }
+        }
+    };
+
+    Interleave const interleave;
+
+    __attribute__((target("sse4.1")))
+    void rows_sse41(uint8_t const *const bayer, size_t const width,
+            size_t const height, uint8_t *const rgb, size_t const begin,
+            size_t const end)
+    {
+        // Odd columns, starting from an even x
+        __m128i const odd = _mm_set1_epi16(static_cast<int16_t>(0xff00));
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            // The first and last rows and columns need mirroring.
+            if (y == 0 || y + 1 == height || width < 19)
+            {
+                for (size_t x = 0; x < width; ++x)
+                {
+                    pixel(bayer, width, height, rgb, x, y);
+                }
+                continue;
+            }
+
+            uint8_t const *const up = bayer + width * (y - 1);
+            uint8_t const *const mid = up + width;
+            uint8_t const *const down = mid + width;
+
+            pixel(bayer, width, height, rgb, 0, y);
+            pixel(bayer, width, height, rgb, 1, y);
+
+            size_t x = 2;
+
+            for (; x + 17 <= width; x += 16)
+            {
+                __m128i const centre = _mm_loadu_si128(
+                        (__m128i const *) (mid + x));
+                __m128i const horizontal = _mm_avg_epu8(
+                        _mm_loadu_si128((__m128i const *) (mid + x - 1)),
+                        _mm_loadu_si128((__m128i const *) (mid + x + 1)));
+                __m128i const vertical = _mm_avg_epu8(
+                        _mm_loadu_si128((__m128i const *) (up + x)),
+                        _mm_loadu_si128((__m128i const *) (down + x)));
+                __m128i const cross = _mm_avg_epu8(horizontal, vertical);
+                __m128i const diagonal = _mm_avg_epu8(
+                        _mm_avg_epu8(
+                            _mm_loadu_si128((__m128i const *) (up + x - 1)),
+                            _mm_loadu_si128((__m128i const *) (up + x + 1))),
+                        _mm_avg_epu8(
+                            _mm_loadu_si128((__m128i const *) (down + x - 1)),
+                            _mm_loadu_si128((__m128i const *) (down + x + 1))));
+
+                __m128i channels[3];
+
+                if (y % 2 == 0)
+                {
+                    channels[0] = _mm_blendv_epi8(horizontal, centre, odd);
+                    channels[1] = _mm_blendv_epi8(centre, cross, odd);
+                    channels[2] = _mm_blendv_epi8(vertical, diagonal, odd);
+                }
+                else
+                {
+                    channels[0] = _mm_blendv_epi8(diagonal, vertical, odd);
+                    channels[1] = _mm_blendv_epi8(cross, centre, odd);
+                    channels[2] = _mm_blendv_epi8(centre, horizontal, odd);
+                }
+
+                uint8_t *const out = rgb + 3 * (width * y + x);
+
+                for (size_t chunk = 0; chunk < 3; ++chunk)
+                {
+                    __m128i packed = _mm_setzero_si128();
+
+                    for (size_t channel = 0; channel < 3; ++channel)
+                    {
+                        packed = _mm_or_si128(packed, _mm_shuffle_epi8(
+                                channels[channel], _mm_load_si128(
+                                    (__m128i const *)
+                                    interleave.masks[chunk][channel])));
+                    }
+
+                    _mm_storeu_si128((__m128i *) (out + 16 * chunk), packed);
+                }
+            }
+
+            for (; x < width; ++x)
+            {
+                pixel(bayer, width, height, rgb, x, y);
+            }
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef BAYER_H
+#define BAYER_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace kinect
+{
+    enum class BayerKernel
+    {
+        SCALAR,
+        SSE41
+    };
+
+    bool is_bayer_kernel_supported(BayerKernel kernel);
+    BayerKernel best_bayer_kernel();
+
+    // Bilinear demosaic of rows [begin, end) of a GRBG Bayer frame, as
+    // libfreenect captures it, into packed RGB of the same size. Borders
+    // are mirrored. The width and height must be even.
+    void demosaic_rows(BayerKernel kernel, uint8_t const *bayer, size_t width,
+            size_t height, uint8_t *rgb, size_t begin, size_t end);
+
+    // Half-resolution demosaic, one RGB pixel per 2 x 2 block with the two
+    // greens averaged.
+    void demosaic_half(uint8_t const *bayer, size_t width, size_t height,
+            uint8_t *rgb);
+}
+
+
+#endif  // BAYER_H
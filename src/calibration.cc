@@ -0,0 +1,211 @@
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "calibration.h"
+
+
+namespace
+{
+    bool find_matrix(std::string const &, std::string const &, size_t,
+            std::vector<double> &);
+    size_t find_node(std::string const &, std::string const &);
+    bool parse_numbers(std::string const &, size_t, size_t,
+            std::vector<double> &);
+    void set_intrinsics(std::vector<double> const &, kinect::Intrinsics &);
+}
+
+
+namespace kinect
+{
+    Calibration default_calibration()
+    {
+        Calibration calibration;
+
+        calibration.depth.fx = 5.9421434211923247e+02;
+        calibration.depth.fy = 5.9104053696870778e+02;
+        calibration.depth.cx = 3.3930780975300314e+02;
+        calibration.depth.cy = 2.4273913761751615e+02;
+
+        calibration.video.fx = 5.2921508098293293e+02;
+        calibration.video.fy = 5.2556393630057437e+02;
+        calibration.video.cx = 3.2894272028759258e+02;
+        calibration.video.cy = 2.6748068171871557e+02;
+
+        // Rotation Matrix
+
+        // Row 0
+        calibration.R(0, 0) =  9.9984628826577793e-01;
+        calibration.R(0, 1) =  1.2635359098409581e-03;
+        calibration.R(0, 2) = -1.7487233004436643e-02;
+
+        // Row 1
+        calibration.R(1, 0) = -1.4779096108364480e-03;
+        calibration.R(1, 1) =  9.9992385683542895e-01;
+        calibration.R(1, 2) = -1.2251380107679535e-02;
+
+        // Row 2
+        calibration.R(2, 0) = 1.7470421412464927e-02;
+        calibration.R(2, 1) = 1.2275341476520762e-02;
+        calibration.R(2, 2) = 9.9977202419716948e-01;
+
+        // Translation Vector
+        calibration.t(0) =  1.9985242312092553e-02;
+        calibration.t(1) = -7.4423738761617583e-04;
+        calibration.t(2) = -1.0916736334336222e-02;
+
+        return calibration;
+    }
+
+    bool load_calibration(std::string const &path, Calibration &calibration,
+            std::string &error)
+    {
+        std::ifstream file(path.c_str());
+
+        if (!file)
+        {
+            error = "Could not open calibration file";
+            return false;
+        }
+
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string const text = stream.str();
+
+        std::vector<double> rgb, depth, R, T;
+
+        if (!find_matrix(text, "rgb_intrinsics", 9, rgb)
+                || !find_matrix(text, "depth_intrinsics", 9, depth)
+                || !find_matrix(text, "R", 9, R)
+                || !find_matrix(text, "T", 3, T))
+        {
+            error = "Expected rgb_intrinsics, depth_intrinsics, R and T "
+                    "matrices in calibration file";
+            return false;
+        }
+
+        set_intrinsics(rgb, calibration.video);
+        set_intrinsics(depth, calibration.depth);
+
+        for (size_t row = 0; row < 3; ++row)
+        {
+            for (size_t col = 0; col < 3; ++col)
+            {
+                calibration.R(row, col) = R[3 * row + col];
+            }
+            calibration.t(row) = T[row];
+        }
+
+        return true;
+    }
+}
+
+
+namespace
+{
+    bool find_matrix(std::string const &text, std::string const &key,
+            size_t const count, std::vector<double> &values)
+    {
+        size_t const node = find_node(text, key);
+
+        if (node == std::string::npos)
+        {
+            return false;
+        }
+
+        // YAML: data: [ ... ]
+        size_t const data = text.find("data", node);
+
+        if (data == std::string::npos)
+        {
+            return false;
+        }
+
+        if (text.compare(data - 1, 1, "<") == 0)
+        {
+            // XML: <data> ... </data>
+            size_t const begin = text.find('>', data);
+            size_t const end = text.find("</data>", data);
+            return begin != std::string::npos && end != std::string::npos
+                && parse_numbers(text, begin + 1, end, values)
+                && values.size() == count;
+        }
+
+        size_t const begin = text.find('[', data);
+        size_t const end = text.find(']', data);
+        return begin != std::string::npos && end != std::string::npos
+            && parse_numbers(text, begin + 1, end, values)
+            && values.size() == count;
+    }
+
+    // Finds a top-level YAML key ("\nkey:") or an XML element ("<key>" or
+    // "<key ...>").
+    size_t find_node(std::string const &text, std::string const &key)
+    {
+        std::string const patterns[] = {
+            "\n" + key + ":",
+            "<" + key + ">",
+            "<" + key + " "
+        };
+
+        for (auto const &pattern : patterns)
+        {
+            size_t const position = text.find(pattern);
+
+            if (position != std::string::npos)
+            {
+                return position + pattern.size();
+            }
+        }
+
+        return std::string::npos;
+    }
+
+    bool parse_numbers(std::string const &text, size_t const begin,
+            size_t const end, std::vector<double> &values)
+    {
+        if (begin > end)
+        {
+            return false;
+        }
+
+        std::string const numbers = text.substr(begin, end - begin);
+        char const *cursor = numbers.c_str();
+        values.clear();
+
+        for (;;)
+        {
+            while (*cursor == ',' || isspace(*cursor))
+            {
+                ++cursor;
+            }
+
+            if (*cursor == '\0')
+            {
+                return true;
+            }
+
+            char *next;
+            double const value = strtod(cursor, &next);
+
+            if (next == cursor)
+            {
+                return false;
+            }
+
+            values.push_back(value);
+            cursor = next;
+        }
+    }
+
+    void set_intrinsics(std::vector<double> const &K,
+            kinect::Intrinsics &intrinsics)
+    {
+        intrinsics.fx = K[0];
+        intrinsics.cx = K[2];
+        intrinsics.fy = K[4];
+        intrinsics.cy = K[5];
+    }
+}
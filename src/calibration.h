@@ -0,0 +1,38 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <string>
+
+#include <Eigen/Dense>
+
+
+namespace kinect
+{
+    struct Intrinsics
+    {
+        double fx;
+        double fy;
+        double cx;
+        double cy;
+    };
+
+    // Intrinsics of both cameras and the transform from the depth camera
+    // to the video camera.
+    struct Calibration
+    {
+        Intrinsics depth;
+        Intrinsics video;
+        Eigen::Matrix3d R;  // Rotation
+        Eigen::Vector3d t;  // Translation
+    };
+
+    Calibration default_calibration();
+
+    // Reads the rgb_intrinsics, depth_intrinsics, R and T matrices of an
+    // OpenCV FileStorage calibration, in YAML or XML.
+    bool load_calibration(std::string const &path, Calibration &calibration,
+            std::string &error);
+}
+
+
+#endif  // CALIBRATION_H
@@ -0,0 +1,111 @@
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Layout of a recording. All fields are little-endian.
+//
+//   FileHeader, padded to a page
+//   Records, each a RecordHeader and its frame, padded to a page
+//   IndexEntry for every record, starting on a page
+//   IndexTrailer, the last bytes of the file
+//
+// Records are page-aligned so a reader can mmap the file and hand out
+// frames in place, and the trailer locates the index without scanning the
+// records. A file without a trailer was not closed and can only be read
+// by walking the records.
+namespace kinect
+{
+    namespace capture
+    {
+        uint32_t const FILE_MAGIC = 0x54434e4b;     // "KNCT"
+        uint32_t const RECORD_MAGIC = 0x454d5246;   // "FRME"
+        uint32_t const INDEX_MAGIC = 0x5844494b;    // "KIDX"
+        uint32_t const VERSION = 1;
+        uint64_t const PAGE_BYTES = 4096;
+
+        // Frames start this far into their record, so they stay aligned
+        // for SIMD readers.
+        uint64_t const RECORD_HEADER_BYTES = 64;
+
+        enum class Stream : uint32_t
+        {
+            DEPTH = 0,
+            VIDEO = 1
+        };
+
+        size_t const STREAMS = 2;
+
+        // A freenect_frame_mode, enough to find it again with
+        // freenect_find_*_mode.
+        struct ModeInfo
+        {
+            uint32_t resolution;
+            int32_t format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t bytes;
+            uint32_t reserved;
+        };
+
+        struct FileHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t page_bytes;
+            ModeInfo depth;
+            ModeInfo video;
+        };
+
+        struct RecordHeader
+        {
+            uint32_t magic;
+            uint32_t stream;
+            uint32_t timestamp;     // Device clock
+            uint32_t reserved;
+            uint64_t host_time;     // uv_hrtime() nanoseconds
+            uint64_t sequence;
+            uint64_t bytes;
+        };
+
+        struct IndexEntry
+        {
+            uint64_t offset;        // Of the RecordHeader
+            uint64_t bytes;
+            uint64_t host_time;
+            uint32_t timestamp;
+            uint32_t stream;
+        };
+
+        struct IndexTrailer
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t index_offset;
+            uint64_t entries;
+        };
+
+        static_assert(sizeof(FileHeader) <= PAGE_BYTES,
+                "The file header must fit in a page");
+        static_assert(sizeof(RecordHeader) <= RECORD_HEADER_BYTES,
+                "The record header must fit before the frame");
+        static_assert(sizeof(IndexEntry) == 32, "Unexpected index padding");
+        static_assert(sizeof(IndexTrailer) == 24, "Unexpected trailer padding");
+
+        inline uint64_t page_align(uint64_t const bytes)
+        {
+            return (bytes + PAGE_BYTES - 1) / PAGE_BYTES * PAGE_BYTES;
+        }
+
+        inline uint64_t record_bytes(uint64_t const frame_bytes)
+        {
+            return page_align(RECORD_HEADER_BYTES + frame_bytes);
+        }
+    }
+}
+
+
+#endif  // CAPTURE_FORMAT_H
@@ -1,7 +1,6 @@
 #include <sys/time.h>
 
 #include <node.h>
-#include <node_buffer.h>
 
 #include <libfreenect.hpp>
 
@@ -15,19 +14,9 @@ using namespace v8;
 
 namespace
 {
-    v8::Persistent<v8::String> depthCallbackSymbol;
-    v8::Persistent<v8::String> videoCallbackSymbol;
+    void define_constant(Handle<Object>, char const *, int32_t);
 
     void call_process_events_forever(void *);
-
-    void video_callback(freenect_device *, void *, uint32_t);
-    void async_video_callback(uv_async_t *, int);
-
-    void depth_callback(freenect_device *, void *, uint32_t);
-    void async_depth_callback(uv_async_t *, int);
-
-    kinect::Context *get_kinect_context(uv_async_t *);
-    kinect::Context *get_kinect_context(freenect_device *);
 }
 
 
@@ -39,19 +28,39 @@ namespace kinect
         HandleScope scope;
         Context *const context = new Context();
         context->Wrap(args.This());
+        context->add_device(Device::NewInstance());
+
+        // The context's own callbacks are called with it as this.
+        context->default_device()->set_receiver(context);
         return scope.Close(args.This());
     }
 
-    Context::Context() : ObjectWrap(), running_(false), context_(nullptr),
-            async_handles(async_depth_callback, async_video_callback),
-            device_(nullptr)
+    Context::Context() : ObjectWrap(), running_(false), context_(nullptr)
     {
         // Empty
     }
 
     Context::~Context()
     {
-        // Empty
+        // The device may outlive the context while its workers are busy.
+        default_device()->set_receiver(nullptr);
+
+        for (auto &handle : device_handles_)
+        {
+            handle.Dispose();
+        }
+    }
+
+    Device *Context::add_device(Handle<Object> const handle)
+    {
+        device_handles_.push_back(Persistent<Object>::New(handle));
+        devices_.push_back(ObjectWrap::Unwrap<Device>(handle));
+        return devices_.back();
+    }
+
+    Device *Context::default_device() const
+    {
+        return devices_.front();
     }
 
     Handle<Value> Context::CallEnable(Arguments const &args)
@@ -66,25 +75,9 @@ namespace kinect
         HandleScope scope;
 
         int user_device_number;
-        int const argc = args.Length();
 
-        if (argc == 0)
+        if (!default_device()->configure(args, user_device_number))
         {
-            user_device_number = 0;
-        }
-        else if (argc == 1)
-        {
-            if (!args[0]->IsInt32())
-            {
-                throw_error("userDeviceNumber must be an integer");
-                return;
-            }
-
-            user_device_number = args[0]->ToInt32()->Value();
-        }
-        else
-        {
-            throw_error("Excepted 1 argument");
             return;
         }
 
@@ -100,33 +93,7 @@ namespace kinect
                 (freenect_device_flags)
                 (FREENECT_DEVICE_MOTOR | FREENECT_DEVICE_CAMERA));
 
-        if (freenect_open_device(context_, &device_, user_device_number) < 0)
-        {
-            throw_error("Could not open device number");
-            return;
-        }
-
-        freenect_set_user(device_, this);
-
-        // Initialize video mode
-        video_mode_ = freenect_find_video_mode(FREENECT_RESOLUTION_MEDIUM,
-                FREENECT_VIDEO_RGB);
-        assert(video_mode_.is_valid);
-
-        // Initialize depth mode
-        depth_mode_ = freenect_find_depth_mode(FREENECT_RESOLUTION_MEDIUM,
-                FREENECT_DEPTH_11BIT);
-        assert(depth_mode_.is_valid);
-
-        // LibUV stuff
-        if (!async_handles.enable())
-        {
-            throw_error("Could not enable async handles");
-            return;
-        }
-
-        async_handles.set_depth_data(this);
-        async_handles.set_video_data(this);
+        default_device()->open(context_, user_device_number);
     }
 
     Handle<Value> Context::CallDisable(Arguments const &args)
@@ -141,13 +108,12 @@ namespace kinect
         std::string error_message;
 
 
-        if (device_ != nullptr)
+        for (Device *const device : devices_)
         {
-            if (freenect_close_device(device_) != 0)
+            if (!device->close() && error_message.length() == 0)
             {
                 error_message += "Could not close device";
             }
-            device_ = nullptr;
         }
 
         if (context_ != nullptr)
@@ -167,351 +133,214 @@ namespace kinect
         {
             throw_error(error_message.c_str());
         }
-
-        async_handles.disable();
     }
 
 
     // =====================================================================
-    // = Events                                                            =
+    // = Devices                                                           =
     // =====================================================================
 
-    Handle<Value> Context::CallStartProcessingEvents(Arguments const &args)
+    Handle<Value> Context::call_open_device(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->StartProcessingEvents();
-        return scope.Close(Undefined());
-    }
-
-    void Context::StartProcessingEvents()
-    {
-        if (running_)
-        {
-            throw_error("Already processing events");
-            return;
-        }
-
-        running_ = true;
-        uv_thread_create(&event_thread_, call_process_events_forever, this);
+        return scope.Close(GetContext(args)->open_device(args));
     }
 
-    Handle<Value> Context::CallStopProcessingEvents(Arguments const &args)
+    // Opens another device on the freenect context of enable(). It is
+    // driven by the same event thread, so it has to be opened before
+    // processing events.
+    Handle<Value> Context::open_device(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->StopProcessingEvents();
-        return scope.Close(Undefined());
-    }
 
-    void Context::StopProcessingEvents()
-    {
-        if (!running_)
+        if (context_ == nullptr)
         {
-            throw_error("Already stopped processing events");
-            return;
+            throw_error("Context not enabled");
+            return scope.Close(Undefined());
         }
 
-        running_ = false;
-        uv_thread_join(&event_thread_);
-    }
+        if (running_)
+        {
+            throw_error("Cannot open a device while processing events");
+            return scope.Close(Undefined());
+        }
 
-    void Context::process_events_forever()
-    {
-        struct timeval timeout;
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
+        Local<Object> const handle = Device::NewInstance();
+        Device *const device = ObjectWrap::Unwrap<Device>(handle);
+        int index;
 
-        while (running_)
+        if (!device->configure(args, index) || !device->open(context_, index))
         {
-            freenect_process_events_timeout(context_, &timeout);
+            device->close();
+            return scope.Close(Undefined());
         }
-    }
-
 
-    // =====================================================================
-    // = World frame                                                       =
-    // =====================================================================
+        add_device(handle);
+        return scope.Close(handle);
+    }
 
-    Handle<Value> Context::call_set_world_callback(Arguments const &args)
+    Handle<Value> Context::call_enable_replay(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->world_.set_callback(args);
+        GetContext(args)->default_device()->open_replay(args);
         return scope.Close(Undefined());
     }
 
-    void Context::update_world()
-    {
-        if (depthBuffer_ != nullptr && video_buffer_ != nullptr)
-        {
-            world_.update((uint8_t *) Buffer::Data(depthBuffer_),
-                          (uint8_t *) Buffer::Data(video_buffer_));
-        }
-    }
-
-    // =====================================================================
-    // = Video                                                             =
-    // =====================================================================
-
-    // = Start =============================================================
-
-    Handle<Value> Context::StartVideo(Arguments const &args)
+    Handle<Value> Context::call_open_replay(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->StartVideo();
-        return scope.Close(Undefined());
+        return scope.Close(GetContext(args)->open_replay(args));
     }
 
-    void Context::StartVideo()
+    // Opens another device playing a recording back, which needs no
+    // freenect context.
+    Handle<Value> Context::open_replay(Arguments const &args)
     {
-        freenect_set_video_callback(device_, video_callback);
+        HandleScope scope;
 
-        if (freenect_set_video_mode(device_, video_mode_) != 0)
+        if (running_)
         {
-            throw_error("Could not set video mode");
-            return;
+            throw_error("Cannot open a device while processing events");
+            return scope.Close(Undefined());
         }
 
-        video_buffer_ = Buffer::New(video_mode_.bytes);
-        video_buffer_handle_ = Persistent<Value>::New(video_buffer_->handle_);
+        Local<Object> const handle = Device::NewInstance();
 
-        if (freenect_set_video_buffer(device_, Buffer::Data(video_buffer_))
-                != 0)
+        if (!ObjectWrap::Unwrap<Device>(handle)->open_replay(args))
         {
-            throw_error("Could not set video buffer");
-            return;
+            return scope.Close(Undefined());
         }
 
-        if (freenect_start_video(device_) != 0)
-        {
-            throw_error("Could not start video");
-            return;
-        }
+        add_device(handle);
+        return scope.Close(handle);
     }
 
-
-    // = Stop ==============================================================
-
-    Handle<Value> Context::StopVideo(Arguments const &args)
+    Handle<Value> Context::call_enable_synthetic(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->StopVideo();
+        GetContext(args)->default_device()->open_synthetic(args);
         return scope.Close(Undefined());
     }
 
-    void Context::StopVideo()
+    Handle<Value> Context::call_open_synthetic(Arguments const &args)
     {
-        freenect_stop_video(device_);
-        freenect_set_video_buffer(device_, nullptr);
-        video_buffer_handle_.Dispose();
-        video_buffer_handle_.Clear();
-        video_buffer_ = nullptr;
-        freenect_set_video_callback(device_, nullptr);
+        HandleScope scope;
+        return scope.Close(GetContext(args)->open_synthetic(args));
     }
 
-
-    // = Callback ==========================================================
-
-    Handle<Value> Context::CallSetVideoCallback(Arguments const& args)
+    // Opens another device generating frames, which needs no freenect
+    // context.
+    Handle<Value> Context::open_synthetic(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->SetVideoCallback(args);
-        return scope.Close(Undefined());
-    }
 
-    void Context::SetVideoCallback(Arguments const &args)
-    {
-        if (args.Length() != 1 || !args[0]->IsFunction())
+        if (running_)
         {
-            throw_error("Expected 1 function as arguments");
-            return;
+            throw_error("Cannot open a device while processing events");
+            return scope.Close(Undefined());
+        }
+
+        Local<Object> const handle = Device::NewInstance();
+
+        if (!ObjectWrap::Unwrap<Device>(handle)->open_synthetic(args))
+        {
+            return scope.Close(Undefined());
         }
 
-        video_callback_ = Persistent<Function>::New(
-                Local<Function>::Cast(args[0]));
+        add_device(handle);
+        return scope.Close(handle);
     }
 
-    Handle<Value> Context::CallUnsetVideoCallback(Arguments const& args)
+    Handle<Value> Context::call_get_device_count(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->UnsetVideoCallback();
-        return scope.Close(Undefined());
+        return scope.Close(GetContext(args)->get_device_count());
     }
 
-    void Context::UnsetVideoCallback()
+    Handle<Value> Context::get_device_count() const
     {
-        video_callback_.Dispose();
-        video_callback_.Clear();
-    }
+        HandleScope scope;
 
-    void Context::VideoCallback()
-    {
-        if (video_buffer_ != nullptr && !video_callback_.IsEmpty())
+        if (context_ == nullptr)
         {
-            unsigned const argc = 1;
-            Handle<Value> argv[1] = { video_buffer_->handle_ };
-            video_callback_->Call(handle_, argc, argv);
+            throw_error("Context not enabled");
+            return scope.Close(Undefined());
         }
-        update_world();
+
+        return scope.Close(Integer::New(freenect_num_devices(context_)));
     }
 
 
     // =====================================================================
-    // = Depth                                                             =
+    // = Events                                                            =
     // =====================================================================
 
-    // = Start =============================================================
-
-    Handle<Value> Context::StartDepth(Arguments const &args)
+    Handle<Value> Context::CallStartProcessingEvents(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->StartDepth();
+        GetContext(args)->StartProcessingEvents();
         return scope.Close(Undefined());
     }
 
-    void Context::StartDepth()
+    void Context::StartProcessingEvents()
     {
-        freenect_set_depth_callback(device_, depth_callback);
-
-        if (freenect_set_depth_mode(device_, depth_mode_) != 0)
+        if (running_)
         {
-            throw_error("Could not set depth mode");
+            throw_error("Already processing events");
             return;
         }
 
-        depthBuffer_ = Buffer::New(depth_mode_.bytes);
-        depth_buffer_handle_ = Persistent<Value>::New(depthBuffer_->handle_);
+        running_ = true;
 
-        if (freenect_set_depth_buffer(device_, Buffer::Data(depthBuffer_)) != 0)
+        if (context_ != nullptr)
         {
-            throw_error("Could not set depth buffer");
-            return;
+            uv_thread_create(&event_thread_, call_process_events_forever,
+                    this);
         }
 
-        if (freenect_start_depth(device_) != 0)
+        for (Device *const device : devices_)
         {
-            throw_error("Could not start depth");
-            return;
+            device->start_source();
         }
     }
 
-
-    // = Stop ==============================================================
-
-    Handle<Value> Context::StopDepth(Arguments const &args)
+    Handle<Value> Context::CallStopProcessingEvents(Arguments const &args)
     {
         HandleScope scope;
-        GetContext(args)->StopDepth();
+        GetContext(args)->StopProcessingEvents();
         return scope.Close(Undefined());
     }
 
-    void Context::StopDepth()
-    {
-        freenect_stop_depth(device_);
-        freenect_set_depth_buffer(device_, nullptr);
-        depth_buffer_handle_.Dispose();
-        depth_buffer_handle_.Clear();
-        depthBuffer_ = nullptr;
-        freenect_set_depth_callback(device_, nullptr);
-    }
-
-
-    // = Callback ==========================================================
-
-    Handle<Value> Context::CallSetDepthCallback(Arguments const &args)
-    {
-        HandleScope scope;
-        GetContext(args)->SetDepthCallback(args);
-        return Undefined();
-    }
-
-    void Context::SetDepthCallback(Arguments const &args)
+    void Context::StopProcessingEvents()
     {
-        if (args.Length() != 1 || !args[0]->IsFunction())
+        if (!running_)
         {
-            throw_error("Expected 1 functions as arguments");
+            throw_error("Already stopped processing events");
             return;
         }
 
-        depth_callback_ = Persistent<Function>::New(
-                Local<Function>::Cast(args[0]));
-    }
-
-    Handle<Value> Context::CallUnsetDepthCallback(Arguments const &args)
-    {
-        HandleScope scope;
-        GetContext(args)->UnsetDepthCallback();
-        return scope.Close(Undefined());
-    }
-
-    void Context::UnsetDepthCallback()
-    {
-        depth_callback_.Dispose();
-        depth_callback_.Clear();
-    }
-
-    void Context::DepthCallback()
-    {
-        if (depthBuffer_ != nullptr && !depth_callback_.IsEmpty())
-        {
-            unsigned const argc = 1;
-            Handle<Value> argv[1] = { depthBuffer_->handle_ };
-            depth_callback_->Call(handle_, argc, argv);
-        }
-        update_world();
-    }
-
-
-    // =====================================================================
-    // = LED                                                               =
-    // =====================================================================
-
-    Handle<Value> Context::CallSetLEDOption(Arguments const &args)
-    {
-        HandleScope scope;
-        GetContext(args)->SetLEDOption(args);
-        return scope.Close(Undefined());
-    }
+        running_ = false;
 
-    void Context::SetLEDOption(Arguments const &args)
-    {
-        if (args.Length() != 1 || !args[0]->IsInt32())
+        if (context_ != nullptr)
         {
-            throw_error("Expected 1 number");
-            return;
+            uv_thread_join(&event_thread_);
         }
 
-        auto const option = static_cast<freenect_led_options>(
-                args[0]->ToInt32()->NumberValue());
-
-        if (freenect_set_led(device_, option) != 0)
+        for (Device *const device : devices_)
         {
-            throw_error("Could not set LED option");
+            device->stop_source();
         }
     }
 
-
-    // =====================================================================
-    // = Tilt                                                              =
-    // =====================================================================
-
-    Handle<Value> Context::CallTilt(Arguments const &args)
-    {
-        HandleScope scope;
-        GetContext(args)->Tilt(args);
-        return scope.Close(Undefined());
-
-    }
-
-    void Context::Tilt(Arguments const &args)
+    void Context::process_events_forever()
     {
-        if (args.Length() != 1 || !args[0]->IsInt32())
-        {
-            throw_error("Expected 1 integer");
-            return;
-        }
+        struct timeval timeout;
+        timeout.tv_sec = 1;
+        timeout.tv_usec = 0;
 
-        if (freenect_set_tilt_degs(device_, args[0]->ToInt32()->Value()) != 0)
+        while (running_)
         {
-            throw_error("Could not set tilt angle");
+            freenect_process_events_timeout(context_, &timeout);
         }
     }
 
@@ -541,36 +370,50 @@ namespace kinect
         NODE_DEFINE_CONSTANT(target, LED_BLINK_GREEN);
         NODE_DEFINE_CONSTANT(target, LED_BLINK_RED_YELLOW);
 
+        define_constant(target, "RESOLUTION_LOW", FREENECT_RESOLUTION_LOW);
+        define_constant(target, "RESOLUTION_MEDIUM",
+                FREENECT_RESOLUTION_MEDIUM);
+        define_constant(target, "RESOLUTION_HIGH", FREENECT_RESOLUTION_HIGH);
+
+        define_constant(target, "VIDEO_RGB", FREENECT_VIDEO_RGB);
+        define_constant(target, "VIDEO_BAYER", FREENECT_VIDEO_BAYER);
+        define_constant(target, "VIDEO_IR_8BIT", FREENECT_VIDEO_IR_8BIT);
+        define_constant(target, "VIDEO_IR_10BIT", FREENECT_VIDEO_IR_10BIT);
+        define_constant(target, "VIDEO_IR_10BIT_PACKED",
+                FREENECT_VIDEO_IR_10BIT_PACKED);
+        define_constant(target, "VIDEO_YUV_RGB", FREENECT_VIDEO_YUV_RGB);
+        define_constant(target, "VIDEO_YUV_RAW", FREENECT_VIDEO_YUV_RAW);
+
+        define_constant(target, "DEPTH_11BIT", FREENECT_DEPTH_11BIT);
+        define_constant(target, "DEPTH_10BIT", FREENECT_DEPTH_10BIT);
+        define_constant(target, "DEPTH_11BIT_PACKED",
+                FREENECT_DEPTH_11BIT_PACKED);
+        define_constant(target, "DEPTH_10BIT_PACKED",
+                FREENECT_DEPTH_10BIT_PACKED);
+        define_constant(target, "DEPTH_REGISTERED", FREENECT_DEPTH_REGISTERED);
+        define_constant(target, "DEPTH_MM", FREENECT_DEPTH_MM);
+
         Local<FunctionTemplate> tpl = FunctionTemplate::New(New);
         tpl->InstanceTemplate()->SetInternalFieldCount(1);
 
         NODE_SET_PROTOTYPE_METHOD(tpl, "enable", CallEnable);
         NODE_SET_PROTOTYPE_METHOD(tpl, "disable", CallDisable);
 
+        NODE_SET_PROTOTYPE_METHOD(tpl, "openDevice", call_open_device);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "enableReplay", call_enable_replay);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "openReplay", call_open_replay);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "enableSynthetic",
+                call_enable_synthetic);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "openSynthetic", call_open_synthetic);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "getDeviceCount",
+                call_get_device_count);
+
         NODE_SET_PROTOTYPE_METHOD(tpl, "startProcessingEvents",
                 CallStartProcessingEvents);
         NODE_SET_PROTOTYPE_METHOD(tpl, "stopProcessingEvents",
                 CallStopProcessingEvents);
 
-        NODE_SET_PROTOTYPE_METHOD(tpl, "setWorldCallback",
-                call_set_world_callback);
-
-        NODE_SET_PROTOTYPE_METHOD(tpl, "startDepth", StartDepth);
-        NODE_SET_PROTOTYPE_METHOD(tpl, "stopDepth", StopDepth);
-        NODE_SET_PROTOTYPE_METHOD(tpl, "setDepthCallback",
-                CallSetDepthCallback);
-        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetDepthCallback",
-                CallUnsetDepthCallback);
-
-        NODE_SET_PROTOTYPE_METHOD(tpl, "startVideo", StartVideo);
-        NODE_SET_PROTOTYPE_METHOD(tpl, "stopVideo", StopVideo);
-        NODE_SET_PROTOTYPE_METHOD(tpl, "setVideoCallback",
-                CallSetVideoCallback);
-        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetVideoCallback",
-                CallUnsetVideoCallback);
-
-        NODE_SET_PROTOTYPE_METHOD(tpl, "setLedOption", CallSetLEDOption);
-        NODE_SET_PROTOTYPE_METHOD(tpl, "setTilt", CallTilt);
+        Device::set_prototype_methods(tpl);
 
         target->Set(String::NewSymbol("Context"), tpl->GetFunction());
     }
@@ -584,56 +427,21 @@ namespace
         static_cast<kinect::Context *>(arg)->process_events_forever();
     }
 
-    // = Depth =============================================================
-
-    void depth_callback(freenect_device *dev, void *depth, uint32_t timestamp)
-    {
-        get_kinect_context(dev)->async_handles.send_depth();
-    }
-
-    void async_depth_callback(uv_async_t *handle, int notUsed)
-    {
-        get_kinect_context(handle)->DepthCallback();
-    }
-
-
-    // = Video =============================================================
-
-    void video_callback(freenect_device *dev, void *video, uint32_t timestamp)
-    {
-        get_kinect_context(dev)->async_handles.send_video();
-    }
-
-    void async_video_callback(uv_async_t *handle, int notUsed)
+    void define_constant(Handle<Object> const target, char const *const name,
+            int32_t const value)
     {
-        get_kinect_context(handle)->VideoCallback();
-    }
-
-
-    // = Helpers ===========================================================
-
-    kinect::Context *get_kinect_context(uv_async_t *const handle)
-    {
-        auto const context = static_cast<kinect::Context *>(handle->data);
-        assert(context != nullptr);
-        return context;
-    }
-
-    kinect::Context *get_kinect_context(freenect_device *const device)
-    {
-        auto const context = static_cast<kinect::Context *>(
-                freenect_get_user(device));
-        assert(context != nullptr);
-        return context;
+        target->Set(String::NewSymbol(name), Integer::New(value),
+                static_cast<PropertyAttribute>(ReadOnly | DontDelete));
     }
 }
 
 
 void init(Handle<Object> target)
 {
+    kinect::Device::Initialize(target);
     kinect::Context::Initialize(target);
+    kinect::DepthEncoder::Initialize(target);
 }
 
 
 NODE_MODULE(kinect, init)
-
@@ -2,10 +2,10 @@
 #define KINECT_H
 
 #include <string>
+#include <vector>
 #include <node.h>
 
-#include "async_handles.h"
-#include "world_frame.h"
+#include "device.h"
 
 
 namespace kinect {
@@ -14,13 +14,11 @@ namespace kinect {
     public:
       static void            Initialize (v8::Handle<v8::Object> target);
       virtual                ~Context   ();
-      void                   DepthCallback    ();
-      void                   VideoCallback    ();
       bool                   running_;
       freenect_context*      context_;
-      AsyncHandles async_handles;
 
       void process_events_forever();
+      Device *default_device() const;
 
     private:
       Context();
@@ -32,98 +30,55 @@ namespace kinect {
       static v8::Handle<v8::Value> CallEnable(v8::Arguments const &args);
       static v8::Handle<v8::Value> CallDisable(v8::Arguments const &args);
       static v8::Handle<v8::Value> Close(v8::Arguments const &args);
+      Device *add_device(v8::Handle<v8::Object> handle);
 
-      // = Events ==============================================================
+      // = Devices =============================================================
 
-      void StartProcessingEvents();
-      void StopProcessingEvents();
+      static v8::Handle<v8::Value> call_open_device(v8::Arguments const &args);
 
-      static v8::Handle<v8::Value> CallStartProcessingEvents(
-              v8::Arguments const &args);
+      v8::Handle<v8::Value> open_device(v8::Arguments const &args);
 
-      static v8::Handle<v8::Value> CallStopProcessingEvents(
+      static v8::Handle<v8::Value> call_enable_replay(
               v8::Arguments const &args);
 
+      static v8::Handle<v8::Value> call_open_replay(v8::Arguments const &args);
 
-      // = World ===============================================================
+      v8::Handle<v8::Value> open_replay(v8::Arguments const &args);
 
-      static v8::Handle<v8::Value> call_set_world_callback(
+      static v8::Handle<v8::Value> call_enable_synthetic(
               v8::Arguments const &args);
 
-        void update_world();
-
-
-      // = Depth ===============================================================
-
-      static v8::Handle<v8::Value> StartDepth(v8::Arguments const &args);
-
-      void StartDepth();
-
-      static v8::Handle<v8::Value> StopDepth(v8::Arguments const &args);
-
-      void StopDepth();
-
-      static v8::Handle<v8::Value> CallSetDepthCallback(
+      static v8::Handle<v8::Value> call_open_synthetic(
               v8::Arguments const &args);
 
-      void SetDepthCallback(v8::Arguments const&args);
+      v8::Handle<v8::Value> open_synthetic(v8::Arguments const &args);
 
-      static v8::Handle<v8::Value> CallUnsetDepthCallback(
+      static v8::Handle<v8::Value> call_get_device_count(
               v8::Arguments const &args);
 
-      void UnsetDepthCallback();
+      v8::Handle<v8::Value> get_device_count() const;
 
 
-      // = Video ===============================================================
-
-      static v8::Handle<v8::Value> StartVideo(v8::Arguments const &args);
-
-      void StartVideo();
-
-      static v8::Handle<v8::Value> StopVideo(v8::Arguments const &args);
+      // = Events ==============================================================
 
-      void StopVideo();
+      void StartProcessingEvents();
+      void StopProcessingEvents();
 
-      static v8::Handle<v8::Value> CallSetVideoCallback(
+      static v8::Handle<v8::Value> CallStartProcessingEvents(
               v8::Arguments const &args);
 
-      void SetVideoCallback(v8::Arguments const &args);
-
-      static v8::Handle<v8::Value> CallUnsetVideoCallback(
+      static v8::Handle<v8::Value> CallStopProcessingEvents(
               v8::Arguments const &args);
 
-      void UnsetVideoCallback();
-
-
-      // = LED =================================================================
-
-      static v8::Handle<v8::Value> CallSetLEDOption(v8::Arguments const &args);
-
-      void SetLEDOption(v8::Arguments const &args);
-
-
-      // = Tilt ================================================================
-
-      static v8::Handle<v8::Value> CallTilt(v8::Arguments const &args);
-      void Tilt(v8::Arguments const &args);
-
-      v8::Persistent<v8::Function> depth_callback_;
-      v8::Persistent<v8::Function> video_callback_;
-
-      node::Buffer *video_buffer_;
-      v8::Persistent<v8::Value> video_buffer_handle_;
-      node::Buffer *depthBuffer_;
-      v8::Persistent<v8::Value> depth_buffer_handle_;
-
-      freenect_device*      device_;
-      freenect_frame_mode   video_mode_;
-      freenect_frame_mode   depth_mode_;
+      // The device opened by enable(), which the per-device methods of the
+      // context act on, followed by those opened with openDevice(). The
+      // handles keep them alive for as long as the context.
+      std::vector<Device *> devices_;
+      std::vector<v8::Persistent<v8::Object>> device_handles_;
 
       uv_thread_t event_thread_;
-      WorldFrame world_;
   };
 
 }
 
 #endif  // KINECT_H
-
@@ -0,0 +1,147 @@
+#include <algorithm>
+
+#include "decimate.h"
+
+
+using kinect::DepthDecimation;
+
+
+namespace
+{
+    uint16_t combine(DepthDecimation, uint16_t const *, uint16_t);
+    uint16_t load(uint8_t const *, size_t);
+    void store(uint8_t *, size_t, uint16_t);
+}
+
+
+namespace kinect
+{
+    void decimate_depth(DepthDecimation const decimation,
+            uint8_t const *const src, size_t const width, size_t const height,
+            uint16_t const invalid, uint8_t *const dst)
+    {
+        size_t const half_width = width / 2;
+
+        for (size_t y = 0; y < height / 2; ++y)
+        {
+            size_t const top = width * 2 * y;
+            size_t const bottom = top + width;
+
+            for (size_t x = 0; x < half_width; ++x)
+            {
+                uint16_t const values[4] = {
+                    load(src, top + 2 * x),
+                    load(src, top + 2 * x + 1),
+                    load(src, bottom + 2 * x),
+                    load(src, bottom + 2 * x + 1)
+                };
+
+                store(dst, half_width * y + x,
+                        combine(decimation, values, invalid));
+            }
+        }
+    }
+
+    void decimate_bytes(uint8_t const *const src, size_t const width,
+            size_t const height, size_t const channels, uint8_t *dst)
+    {
+        size_t const stride = width * channels;
+
+        for (size_t y = 0; y < height / 2; ++y)
+        {
+            uint8_t const *const top = src + stride * 2 * y;
+            uint8_t const *const bottom = top + stride;
+
+            for (size_t x = 0; x < width / 2; ++x)
+            {
+                size_t const left = 2 * x * channels;
+                size_t const right = left + channels;
+
+                for (size_t c = 0; c < channels; ++c)
+                {
+                    *dst++ = (top[left + c] + top[right + c]
+                            + bottom[left + c] + bottom[right + c] + 2) >> 2;
+                }
+            }
+        }
+    }
+
+    void decimate_words(uint8_t const *const src, size_t const width,
+            size_t const height, uint8_t *const dst)
+    {
+        size_t const half_width = width / 2;
+
+        for (size_t y = 0; y < height / 2; ++y)
+        {
+            size_t const top = width * 2 * y;
+            size_t const bottom = top + width;
+
+            for (size_t x = 0; x < half_width; ++x)
+            {
+                uint32_t const sum = load(src, top + 2 * x)
+                    + load(src, top + 2 * x + 1)
+                    + load(src, bottom + 2 * x)
+                    + load(src, bottom + 2 * x + 1);
+
+                store(dst, half_width * y + x, (sum + 2) >> 2);
+            }
+        }
+    }
+}
+
+
+namespace
+{
+    uint16_t combine(DepthDecimation const decimation,
+            uint16_t const *const values, uint16_t const invalid)
+    {
+        uint16_t valid[4];
+        size_t count = 0;
+
+        for (size_t i = 0; i < 4; ++i)
+        {
+            if (values[i] != invalid)
+            {
+                valid[count++] = values[i];
+            }
+        }
+
+        if (count == 0)
+        {
+            return invalid;
+        }
+
+        switch (decimation)
+        {
+            case DepthDecimation::NEAREST:
+                return valid[0];
+            case DepthDecimation::MEAN:
+            {
+                uint32_t sum = 0;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    sum += valid[i];
+                }
+
+                return (sum + count / 2) / count;
+            }
+            case DepthDecimation::MEDIAN:
+                std::sort(valid, valid + count);
+                return valid[(count - 1) / 2];
+        }
+
+        return invalid;
+    }
+
+    uint16_t load(uint8_t const *const data, size_t const i)
+    {
+        return data[2 * i] | (data[2 * i + 1] << 8);
+    }
+
+    void store(uint8_t *const data, size_t const i, uint16_t const value)
+    {
+        data[2 * i] = value & 0xff;
+        data[2 * i + 1] = value >> 8;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace kinect
+{
+    // How four depth values become one. Invalid values are ignored, and
+    // the result is only invalid if all four are.
+    enum class DepthDecimation
+    {
+        NEAREST,  // The top-left valid value
+        MEAN,     // The mean of the valid values
+        MEDIAN    // The lower median of the valid values
+    };
+
+    // Halve a frame of packed rows, dropping an odd last row or column.
+    // dst holds (width / 2) x (height / 2) pixels.
+
+    // 16-bit little-endian depth
+    void decimate_depth(DepthDecimation decimation, uint8_t const *src,
+            size_t width, size_t height, uint16_t invalid, uint8_t *dst);
+
+    // Box filter of 8-bit channels, rounded
+    void decimate_bytes(uint8_t const *src, size_t width, size_t height,
+            size_t channels, uint8_t *dst);
+
+    // Box filter of one 16-bit little-endian channel, rounded
+    void decimate_words(uint8_t const *src, size_t width, size_t height,
+            uint8_t *dst);
+}
+
+
+#endif  // DECIMATE_H
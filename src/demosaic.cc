@@ -0,0 +1,157 @@
+#include <cassert>
+
+#include "demosaic.h"
+
+
+using node::Buffer;
+using v8::Handle;
+using v8::Persistent;
+using v8::Value;
+
+
+namespace kinect
+{
+    Demosaic::Demosaic() : resolution_(Resolution::OFF),
+            kernel_(best_bayer_kernel()), bytes_(0), front_(0), timestamp_(0)
+    {
+        for (size_t i = 0; i < BUFFERS; ++i)
+        {
+            buffers_[i] = nullptr;
+        }
+    }
+
+    Demosaic::~Demosaic()
+    {
+        release();
+    }
+
+    void Demosaic::set_owner(WorkerOwner *const owner)
+    {
+        worker_.set_owner(owner);
+    }
+
+    void Demosaic::set_resolution(Resolution const resolution)
+    {
+        resolution_ = resolution;
+    }
+
+    bool Demosaic::is_enabled() const
+    {
+        return resolution_ != Resolution::OFF;
+    }
+
+    bool Demosaic::is_busy() const
+    {
+        return worker_.is_busy();
+    }
+
+    freenect_frame_mode Demosaic::output_mode(
+            freenect_frame_mode const &mode) const
+    {
+        freenect_frame_mode output = mode;
+
+        if (resolution_ == Resolution::HALF)
+        {
+            output.width /= 2;
+            output.height /= 2;
+        }
+
+        output.video_format = FREENECT_VIDEO_RGB;
+        output.data_bits_per_pixel = 24;
+        output.padding_bits_per_pixel = 0;
+        output.bytes = output.width * output.height * 3;
+        return output;
+    }
+
+    bool Demosaic::queue(uint8_t const *const frame,
+            freenect_frame_mode const &mode, uint32_t const timestamp,
+            std::function<void()> done)
+    {
+        if (worker_.is_busy())
+        {
+            return false;
+        }
+
+        // The ring slot may be reused as soon as the next frame is
+        // acquired, so the worker reads a copy.
+        size_t const width = mode.width;
+        size_t const height = mode.height;
+        bayer_.assign(frame, frame + width * height);
+        allocate(output_mode(mode).bytes);
+
+        size_t const back = (front_ + 1) % BUFFERS;
+        uint8_t *const rgb = (uint8_t *) Buffer::Data(buffers_[back]);
+        BayerKernel const kernel = kernel_;
+        bool const is_half = resolution_ == Resolution::HALF;
+
+        return worker_.queue(
+            [this, kernel, is_half, width, height, rgb]()
+            {
+                if (is_half)
+                {
+                    demosaic_half(bayer_.data(), width, height, rgb);
+                }
+                else
+                {
+                    demosaic_rows(kernel, bayer_.data(), width, height, rgb,
+                            0, height);
+                }
+            },
+            [this, back, timestamp, done]()
+            {
+                front_ = back;
+                timestamp_ = timestamp;
+                done();
+            });
+    }
+
+    uint8_t const *Demosaic::front() const
+    {
+        assert(buffers_[front_] != nullptr);
+        return (uint8_t const *) Buffer::Data(buffers_[front_]);
+    }
+
+    Handle<Value> Demosaic::front_handle() const
+    {
+        assert(buffers_[front_] != nullptr);
+        return buffers_[front_]->handle_;
+    }
+
+    uint32_t Demosaic::front_timestamp() const
+    {
+        return timestamp_;
+    }
+
+    void Demosaic::allocate(size_t const bytes)
+    {
+        if (bytes == bytes_)
+        {
+            return;
+        }
+
+        release();
+
+        for (size_t i = 0; i < BUFFERS; ++i)
+        {
+            buffers_[i] = Buffer::New(bytes);
+            handles_[i] = Persistent<Value>::New(buffers_[i]->handle_);
+        }
+
+        bytes_ = bytes;
+    }
+
+    void Demosaic::release()
+    {
+        for (size_t i = 0; i < BUFFERS; ++i)
+        {
+            if (buffers_[i] != nullptr)
+            {
+                handles_[i].Dispose();
+                handles_[i].Clear();
+                buffers_[i] = nullptr;
+            }
+        }
+
+        bytes_ = 0;
+    }
+}
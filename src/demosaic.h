@@ -0,0 +1,71 @@
+#ifndef DEMOSAIC_H
+#define DEMOSAIC_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include <libfreenect.h>
+
+#include "bayer.h"
+#include "worker.h"
+
+
+namespace kinect
+{
+    // Demosaics Bayer video frames on the libuv thread pool rather than
+    // on the libfreenect event thread, into double-buffered RGB frames.
+    class Demosaic
+    {
+        public:
+            enum class Resolution
+            {
+                OFF,
+                FULL,
+                HALF
+            };
+
+            Demosaic();
+            ~Demosaic();
+            void set_owner(WorkerOwner *owner);
+            void set_resolution(Resolution resolution);
+            bool is_enabled() const;
+            bool is_busy() const;
+
+            // The RGB mode a Bayer mode is demosaiced to
+            freenect_frame_mode output_mode(
+                    freenect_frame_mode const &mode) const;
+
+            // Copies frame, a Bayer frame of mode, demosaics it on the
+            // worker and then calls done on the loop thread.
+            bool queue(uint8_t const *frame, freenect_frame_mode const &mode,
+                    uint32_t timestamp, std::function<void()> done);
+
+            uint8_t const *front() const;
+            v8::Handle<v8::Value> front_handle() const;
+            uint32_t front_timestamp() const;
+
+        private:
+            static size_t const BUFFERS = 2;
+
+            Demosaic(Demosaic const &that) = delete;
+            Resolution resolution_;
+            BayerKernel kernel_;
+            std::vector<uint8_t> bayer_;
+            node::Buffer *buffers_[BUFFERS];
+            v8::Persistent<v8::Value> handles_[BUFFERS];
+            size_t bytes_;
+            size_t front_;
+            uint32_t timestamp_;
+            Worker worker_;
+
+            void allocate(size_t bytes);
+            void release();
+    };
+}
+
+
+#endif  // DEMOSAIC_H
@@ -0,0 +1,124 @@
+#include "depth.h"
+
+
+namespace
+{
+    constexpr uint16_t RAW_DEPTH_INVALID = 2047;
+    constexpr uint16_t MM_DEPTH_INVALID = 0;
+    constexpr uint16_t MM_DEPTH_MAX = 10000;
+}
+
+
+namespace kinect
+{
+    size_t depth_values(DepthUnit const unit)
+    {
+        switch (unit)
+        {
+            case DepthUnit::RAW:
+                return RAW_DEPTH_INVALID + 1;
+            case DepthUnit::MILLIMETRES:
+                return MM_DEPTH_MAX + 2;
+        }
+
+        return 0;
+    }
+
+    uint16_t invalid_depth(DepthUnit const unit)
+    {
+        return unit == DepthUnit::RAW ? RAW_DEPTH_INVALID : MM_DEPTH_INVALID;
+    }
+
+    void depth_to_codes(DepthUnit const unit, uint16_t *const depth,
+            size_t const pixels)
+    {
+        if (unit == DepthUnit::RAW)
+        {
+            for (size_t i = 0; i < pixels; ++i)
+            {
+                depth[i] = depth_to_code<true>(depth[i]);
+            }
+        }
+    }
+
+    void codes_to_depth(DepthUnit const unit, uint16_t *const codes,
+            size_t const pixels)
+    {
+        if (unit == DepthUnit::RAW)
+        {
+            for (size_t i = 0; i < pixels; ++i)
+            {
+                codes[i] = code_to_depth<true>(codes[i]);
+            }
+        }
+    }
+
+    uint16_t default_depth_threshold(DepthUnit const unit)
+    {
+        return unit == DepthUnit::RAW ? 8 : 50;
+    }
+
+    float depth_to_metres(DepthUnit const unit, uint16_t const value)
+    {
+        if (unit == DepthUnit::RAW)
+        {
+            return raw_depth_to_metres(value);
+        }
+
+        return value <= MM_DEPTH_MAX ? value * 0.001f : 0.0f;
+    }
+
+    float raw_depth_to_metres(uint16_t const raw)
+    {
+        if (raw >= RAW_DEPTH_INVALID)
+        {
+            return 0.0f;
+        }
+
+        return 1.0f / (raw * -0.0030711016f + 3.3309495161f);
+    }
+
+    uint16_t metres_to_depth(DepthUnit const unit, float const metres)
+    {
+        if (!(metres > 0.0f))
+        {
+            return invalid_depth(unit);
+        }
+
+        float value;
+
+        if (unit == DepthUnit::RAW)
+        {
+            value = (1.0f / metres - 3.3309495161f) / -0.0030711016f;
+        }
+        else
+        {
+            value = metres * 1000.0f;
+        }
+
+        // 0 is a valid raw value but the invalid millimetre value.
+        float const min = unit == DepthUnit::RAW ? 0 : 1;
+        float const max = unit == DepthUnit::RAW ? RAW_DEPTH_INVALID - 1
+            : MM_DEPTH_MAX;
+
+        if (!(value >= min - 0.5f && value < max + 0.5f))
+        {
+            return invalid_depth(unit);
+        }
+
+        return uint16_t(value + 0.5f);
+    }
+
+    void build_depth_mask(DepthUnit const unit, double const min,
+            double const max, std::vector<uint8_t> &mask)
+    {
+        size_t const values = depth_values(unit);
+        mask.resize(values);
+
+        for (size_t value = 0; value < values; ++value)
+        {
+            float const d = depth_to_metres(unit, value);
+            mask[value] = d > 0.0f && d >= min && d <= max;
+        }
+    }
+}
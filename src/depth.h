@@ -0,0 +1,58 @@
+#ifndef DEPTH_H
+#define DEPTH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace kinect
+{
+    // How a depth frame encodes distance.
+    enum class DepthUnit
+    {
+        RAW,         // 11-bit disparity, 2047 where invalid
+        MILLIMETRES  // 0 where invalid
+    };
+
+    // Entries in a table indexed by depth value. Larger values use the
+    // last entry, which is always invalid.
+    size_t depth_values(DepthUnit unit);
+
+    uint16_t invalid_depth(DepthUnit unit);
+
+    // Depth codes are 0 where invalid and grow with distance in both
+    // units: raw depth is rotated by one so the invalid 2047 becomes 0,
+    // and millimetres are kept as they are. Raw values above 2047 wrap.
+    template <bool IS_RAW> inline uint16_t depth_to_code(uint16_t value)
+    {
+        return IS_RAW ? (value + 1u) & 0x7ff : value;
+    }
+
+    template <bool IS_RAW> inline uint16_t code_to_depth(uint32_t code)
+    {
+        return IS_RAW ? (code + 0x7ff) & 0x7ff : uint16_t(code);
+    }
+
+    // The same over a frame, in place
+    void depth_to_codes(DepthUnit unit, uint16_t *depth, size_t pixels);
+    void codes_to_depth(DepthUnit unit, uint16_t *codes, size_t pixels);
+
+    // The depth difference taken to separate two surfaces by default,
+    // about 3 cm at 1 metre for raw depth, whose steps grow with distance.
+    uint16_t default_depth_threshold(DepthUnit unit);
+
+    // Not positive where invalid
+    float depth_to_metres(DepthUnit unit, uint16_t value);
+    float raw_depth_to_metres(uint16_t raw);
+
+    // The nearest value, invalid where the unit cannot encode the distance.
+    uint16_t metres_to_depth(DepthUnit unit, float metres);
+
+    // Builds a table of the depth values within [min, max] metres.
+    void build_depth_mask(DepthUnit unit, double min, double max,
+            std::vector<uint8_t> &mask);
+}
+
+
+#endif  // DEPTH_H
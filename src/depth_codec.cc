@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cstring>
+
+#include "depth_codec.h"
+
+
+namespace
+{
+    uint32_t const MAGIC = 0x4c56524b;  // "KRVL"
+    uint8_t const VERSION = 1;
+
+    // Variable-length values of 3 bits per nibble, the 4th bit set if more
+    // follow, 8 nibbles per word from the most significant.
+    class NibbleWriter
+    {
+        public:
+            explicit NibbleWriter(uint8_t *out);
+            void write(uint32_t value);
+            size_t finish();
+
+        private:
+            void store();
+
+            uint8_t *out_;
+            uint8_t *const begin_;
+            uint32_t word_;
+            unsigned nibbles_;
+    };
+
+    class NibbleReader
+    {
+        public:
+            NibbleReader(uint8_t const *data, size_t bytes);
+            bool read(uint32_t &value);
+
+        private:
+            uint8_t const *data_;
+            uint8_t const *const end_;
+            uint32_t word_;
+            unsigned nibbles_;
+    };
+
+    template <bool IS_RAW> size_t encode_values(uint16_t const *, size_t,
+            uint8_t *);
+    template <bool IS_RAW> bool decode_values(uint8_t const *, size_t,
+            size_t, uint16_t *);
+    uint16_t read_u16(uint8_t const *);
+    uint32_t read_u32(uint8_t const *);
+    void write_u16(uint8_t *, uint16_t);
+    void write_u32(uint8_t *, uint32_t);
+}
+
+
+namespace kinect
+{
+    // 17-bit zigzag deltas take 6 nibbles, and both run lengths of the
+    // last run up to 11 nibbles each, plus a partly filled word.
+    size_t max_encoded_depth_bytes(size_t const pixels)
+    {
+        return DEPTH_CODEC_HEADER_BYTES + pixels * 3 + 16;
+    }
+
+    size_t encode_depth(DepthUnit const unit, uint8_t const *const depth,
+            size_t const width, size_t const height, uint8_t *const out)
+    {
+        uint16_t const *const values =
+            reinterpret_cast<uint16_t const *>(depth);
+        size_t const pixels = width * height;
+        uint8_t *const words = out + DEPTH_CODEC_HEADER_BYTES;
+        size_t const bytes = unit == DepthUnit::RAW
+            ? encode_values<true>(values, pixels, words)
+            : encode_values<false>(values, pixels, words);
+
+        write_u32(out, MAGIC);
+        write_u16(out + 4, uint16_t(width));
+        write_u16(out + 6, uint16_t(height));
+        out[8] = unit == DepthUnit::RAW ? 0 : 1;
+        out[9] = VERSION;
+        write_u16(out + 10, 0);
+        write_u32(out + 12, uint32_t(bytes));
+        return DEPTH_CODEC_HEADER_BYTES + bytes;
+    }
+
+    bool read_depth_header(uint8_t const *const data, size_t const bytes,
+            DepthUnit &unit, size_t &width, size_t &height)
+    {
+        if (bytes < DEPTH_CODEC_HEADER_BYTES || read_u32(data) != MAGIC
+                || data[8] > 1 || data[9] != VERSION)
+        {
+            return false;
+        }
+
+        if (read_u16(data + 4) * size_t(read_u16(data + 6))
+                > MAX_DEPTH_CODEC_PIXELS
+                || read_u32(data + 12) > bytes - DEPTH_CODEC_HEADER_BYTES)
+        {
+            return false;
+        }
+
+        unit = data[8] == 0 ? DepthUnit::RAW : DepthUnit::MILLIMETRES;
+        width = read_u16(data + 4);
+        height = read_u16(data + 6);
+        return true;
+    }
+
+    bool decode_depth(uint8_t const *const data, size_t const bytes,
+            uint8_t *const depth)
+    {
+        DepthUnit unit;
+        size_t width;
+        size_t height;
+
+        if (!read_depth_header(data, bytes, unit, width, height))
+        {
+            return false;
+        }
+
+        size_t const words = read_u32(data + 12);
+        uint8_t const *const begin = data + DEPTH_CODEC_HEADER_BYTES;
+        uint16_t *const values = reinterpret_cast<uint16_t *>(depth);
+        return unit == DepthUnit::RAW
+            ? decode_values<true>(begin, words, width * height, values)
+            : decode_values<false>(begin, words, width * height, values);
+    }
+}
+
+
+namespace
+{
+    // =====================================================================
+    // = Nibbles                                                           =
+    // =====================================================================
+
+    NibbleWriter::NibbleWriter(uint8_t *const out) : out_(out), begin_(out),
+            word_(0), nibbles_(0)
+    {
+        // Empty
+    }
+
+    void NibbleWriter::write(uint32_t value)
+    {
+        for (;;)
+        {
+            uint32_t nibble = value & 0x7;
+            value >>= 3;
+
+            if (value != 0)
+            {
+                nibble |= 0x8;
+            }
+
+            word_ = (word_ << 4) | nibble;
+
+            if (++nibbles_ == 8)
+            {
+                store();
+            }
+
+            if (value == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    size_t NibbleWriter::finish()
+    {
+        if (nibbles_ != 0)
+        {
+            word_ <<= 4 * (8 - nibbles_);
+            store();
+        }
+
+        return out_ - begin_;
+    }
+
+    void NibbleWriter::store()
+    {
+        write_u32(out_, word_);
+        out_ += 4;
+        word_ = 0;
+        nibbles_ = 0;
+    }
+
+    NibbleReader::NibbleReader(uint8_t const *const data, size_t const bytes)
+            : data_(data), end_(data + bytes / 4 * 4), word_(0), nibbles_(0)
+    {
+        // Empty
+    }
+
+    // Fails at the end of the data, or on a value longer than 32 bits.
+    bool NibbleReader::read(uint32_t &value)
+    {
+        value = 0;
+
+        for (unsigned shift = 0; shift < 32; shift += 3)
+        {
+            if (nibbles_ == 0)
+            {
+                if (data_ == end_)
+                {
+                    return false;
+                }
+
+                word_ = read_u32(data_);
+                data_ += 4;
+                nibbles_ = 8;
+            }
+
+            uint32_t const nibble = word_ >> 28;
+            word_ <<= 4;
+            --nibbles_;
+            value |= (nibble & 0x7) << shift;
+
+            if ((nibble & 0x8) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    // =====================================================================
+    // = Values                                                            =
+    // =====================================================================
+
+    template <bool IS_RAW> size_t encode_values(uint16_t const *const values,
+            size_t const pixels, uint8_t *const out)
+    {
+        NibbleWriter writer(out);
+        uint32_t previous = 0;
+        size_t i = 0;
+
+        while (i < pixels)
+        {
+            size_t const invalid_begin = i;
+
+            while (i < pixels && kinect::depth_to_code<IS_RAW>(values[i]) == 0)
+            {
+                ++i;
+            }
+
+            size_t const valid_begin = i;
+
+            while (i < pixels && kinect::depth_to_code<IS_RAW>(values[i]) != 0)
+            {
+                ++i;
+            }
+
+            writer.write(uint32_t(valid_begin - invalid_begin));
+            writer.write(uint32_t(i - valid_begin));
+
+            for (size_t j = valid_begin; j < i; ++j)
+            {
+                uint32_t const code = kinect::depth_to_code<IS_RAW>(values[j]);
+                int32_t const delta = int32_t(code) - int32_t(previous);
+                writer.write(uint32_t(delta << 1) ^ uint32_t(delta >> 31));
+                previous = code;
+            }
+        }
+
+        return writer.finish();
+    }
+
+    template <bool IS_RAW> bool decode_values(uint8_t const *const data,
+            size_t const bytes, size_t const pixels, uint16_t *const values)
+    {
+        NibbleReader reader(data, bytes);
+        uint16_t const invalid = kinect::code_to_depth<IS_RAW>(0);
+        uint32_t previous = 0;
+        size_t i = 0;
+
+        while (i < pixels)
+        {
+            uint32_t invalid_run;
+            uint32_t valid_run;
+
+            if (!reader.read(invalid_run) || invalid_run > pixels - i)
+            {
+                return false;
+            }
+
+            std::fill(values + i, values + i + invalid_run, invalid);
+            i += invalid_run;
+
+            if (!reader.read(valid_run) || valid_run > pixels - i
+                    || (invalid_run == 0 && valid_run == 0))
+            {
+                return false;
+            }
+
+            for (size_t const end = i + valid_run; i < end; ++i)
+            {
+                uint32_t zigzag;
+
+                if (!reader.read(zigzag))
+                {
+                    return false;
+                }
+
+                previous += (zigzag >> 1) ^ (0u - (zigzag & 1));
+                values[i] = kinect::code_to_depth<IS_RAW>(previous);
+            }
+        }
+
+        return true;
+    }
+
+
+    // =====================================================================
+    // = Little-endian                                                     =
+    // =====================================================================
+
+    uint16_t read_u16(uint8_t const *const data)
+    {
+        return uint16_t(data[0] | data[1] << 8);
+    }
+
+    uint32_t read_u32(uint8_t const *const data)
+    {
+        return uint32_t(data[0]) | uint32_t(data[1]) << 8
+            | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+    }
+
+    void write_u16(uint8_t *const data, uint16_t const value)
+    {
+        data[0] = uint8_t(value);
+        data[1] = uint8_t(value >> 8);
+    }
+
+    void write_u32(uint8_t *const data, uint32_t const value)
+    {
+        data[0] = uint8_t(value);
+        data[1] = uint8_t(value >> 8);
+        data[2] = uint8_t(value >> 16);
+        data[3] = uint8_t(value >> 24);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef DEPTH_CODEC_H
+#define DEPTH_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "depth.h"
+
+
+namespace kinect
+{
+    // Lossless depth compression after RVL (Wilson, 2017). Runs of invalid
+    // pixels are stored as their length, and the valid pixels between them
+    // as zigzag deltas from the previous valid pixel, in variable-length
+    // nibbles packed into 32-bit words. Raw depth is mapped so that 2047,
+    // rather than 0, is invalid, so values must fit in 11 bits.
+    //
+    // An encoded frame starts with a header of DEPTH_CODEC_HEADER_BYTES:
+    //
+    //   uint32  magic, "KRVL"
+    //   uint16  width
+    //   uint16  height
+    //   uint8   unit, 0 for raw and 1 for millimetres
+    //   uint8   version, 1
+    //   uint16  reserved, 0
+    //   uint32  bytes of the words that follow
+    //
+    // all little-endian.
+
+    size_t const DEPTH_CODEC_HEADER_BYTES = 16;
+
+    // Runs of invalid pixels take a few nibbles whatever their length, so
+    // a header alone could ask for gigabytes. Frames are limited to this
+    // many pixels, 16 times a 640 x 480 one.
+    size_t const MAX_DEPTH_CODEC_PIXELS = 16 * 640 * 480;
+
+    // Encoded size of a frame of pixels at worst
+    size_t max_encoded_depth_bytes(size_t pixels);
+
+    // Encodes width x height 16-bit little-endian depth values into out,
+    // which holds max_encoded_depth_bytes(width * height). Returns the
+    // bytes written. Width and height are at most 65535, and their product
+    // at most MAX_DEPTH_CODEC_PIXELS.
+    size_t encode_depth(DepthUnit unit, uint8_t const *depth, size_t width,
+            size_t height, uint8_t *out);
+
+    // Fails if data does not start with a valid header, of at most
+    // MAX_DEPTH_CODEC_PIXELS and words that fit in bytes.
+    bool read_depth_header(uint8_t const *data, size_t bytes,
+            DepthUnit &unit, size_t &width, size_t &height);
+
+    // Decodes a frame into depth, which holds width x height values of
+    // the header. Fails if the frame is truncated or corrupt.
+    bool decode_depth(uint8_t const *data, size_t bytes, uint8_t *depth);
+}
+
+
+#endif  // DEPTH_CODEC_H
@@ -0,0 +1,253 @@
+#include "depth_codec.h"
+#include "depth_encoder.h"
+#include "util.h"
+
+
+using node::Buffer;
+using v8::Arguments;
+using v8::Handle;
+using v8::HandleScope;
+using v8::Integer;
+using v8::Local;
+using v8::Object;
+using v8::String;
+using v8::Undefined;
+using v8::Value;
+
+
+namespace
+{
+    bool get_size_option(Local<Object>, char const *, size_t &);
+}
+
+
+namespace kinect
+{
+    DepthEncoder::DepthEncoder() : encoded_bytes_(0), timestamp_(0)
+    {
+        // Empty
+    }
+
+    void DepthEncoder::set_owner(WorkerOwner *const owner)
+    {
+        worker_.set_owner(owner);
+    }
+
+    bool DepthEncoder::is_busy() const
+    {
+        return worker_.is_busy();
+    }
+
+    bool DepthEncoder::queue(uint8_t const *const frame,
+            freenect_frame_mode const &mode, DepthUnit const unit,
+            uint32_t const timestamp, std::function<void()> done)
+    {
+        if (worker_.is_busy())
+        {
+            return false;
+        }
+
+        // The ring slot may be reused as soon as the next frame is
+        // acquired, so the worker reads a copy.
+        size_t const width = mode.width;
+        size_t const height = mode.height;
+        depth_.assign(frame, frame + width * height * 2);
+        encoded_.resize(max_encoded_depth_bytes(width * height));
+
+        return worker_.queue(
+            [this, unit, width, height]()
+            {
+                encoded_bytes_ = encode_depth(unit, depth_.data(), width,
+                        height, encoded_.data());
+            },
+            [this, timestamp, done]()
+            {
+                timestamp_ = timestamp;
+                done();
+            });
+    }
+
+    Handle<Value> DepthEncoder::encoded() const
+    {
+        HandleScope scope;
+        Buffer *const buffer = Buffer::New(
+                reinterpret_cast<char const *>(encoded_.data()),
+                encoded_bytes_);
+        return scope.Close(buffer->handle_);
+    }
+
+    uint32_t DepthEncoder::timestamp() const
+    {
+        return timestamp_;
+    }
+
+
+    // =====================================================================
+    // = Module functions                                                  =
+    // =====================================================================
+
+    // Takes a Buffer of depth and an optional object of its width, height
+    // and depthFormat, 640 x 480 DEPTH_11BIT by default.
+    Handle<Value> DepthEncoder::call_encode_depth(Arguments const &args)
+    {
+        HandleScope scope;
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !Buffer::HasInstance(args[0])
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected a Buffer and an optional options object");
+            return scope.Close(Undefined());
+        }
+
+        size_t width = 640;
+        size_t height = 480;
+        size_t format = FREENECT_DEPTH_11BIT;
+
+        if (argc == 2)
+        {
+            Local<Object> const options = args[1]->ToObject();
+
+            if (!get_size_option(options, "width", width)
+                    || !get_size_option(options, "height", height)
+                    || !get_size_option(options, "depthFormat", format))
+            {
+                throw_error("Expected width, height and depthFormat to be "
+                        "unsigned integers");
+                return scope.Close(Undefined());
+            }
+        }
+
+        if (width == 0 || height == 0 || width > 65535 || height > 65535
+                || width * height > MAX_DEPTH_CODEC_PIXELS)
+        {
+            throw_error("Expected width and height from 1 to 65535, and at "
+                    "most 4915200 pixels");
+            return scope.Close(Undefined());
+        }
+
+        if (format != FREENECT_DEPTH_11BIT && format != FREENECT_DEPTH_MM
+                && format != FREENECT_DEPTH_REGISTERED)
+        {
+            throw_error("Expected depthFormat to be DEPTH_11BIT, DEPTH_MM or "
+                    "DEPTH_REGISTERED");
+            return scope.Close(Undefined());
+        }
+
+        Local<Object> const depth = args[0]->ToObject();
+
+        if (Buffer::Length(depth) != width * height * 2)
+        {
+            throw_error("Expected the Buffer to hold width x height 16-bit "
+                    "values");
+            return scope.Close(Undefined());
+        }
+
+        DepthUnit const unit = format == FREENECT_DEPTH_11BIT
+            ? DepthUnit::RAW : DepthUnit::MILLIMETRES;
+
+        // Raw values are stored in 11 bits, and larger ones would wrap.
+        if (unit == DepthUnit::RAW)
+        {
+            uint16_t const *const values =
+                reinterpret_cast<uint16_t const *>(Buffer::Data(depth));
+
+            for (size_t i = 0; i < width * height; ++i)
+            {
+                if (values[i] > invalid_depth(unit))
+                {
+                    throw_error("Expected DEPTH_11BIT values of at most "
+                            "2047");
+                    return scope.Close(Undefined());
+                }
+            }
+        }
+
+        std::vector<uint8_t> encoded(max_encoded_depth_bytes(width * height));
+        size_t const bytes = encode_depth(unit,
+                reinterpret_cast<uint8_t const *>(Buffer::Data(depth)), width,
+                height, encoded.data());
+
+        Buffer *const buffer = Buffer::New(
+                reinterpret_cast<char const *>(encoded.data()), bytes);
+        return scope.Close(buffer->handle_);
+    }
+
+    // Returns an object of the width, height, depthFormat and depth Buffer
+    // of an encoded frame.
+    Handle<Value> DepthEncoder::call_decode_depth(Arguments const &args)
+    {
+        HandleScope scope;
+
+        if (args.Length() != 1 || !Buffer::HasInstance(args[0]))
+        {
+            throw_error("Expected a Buffer");
+            return scope.Close(Undefined());
+        }
+
+        Local<Object> const encoded = args[0]->ToObject();
+        uint8_t const *const data =
+            reinterpret_cast<uint8_t const *>(Buffer::Data(encoded));
+        size_t const bytes = Buffer::Length(encoded);
+        DepthUnit unit;
+        size_t width;
+        size_t height;
+
+        if (!read_depth_header(data, bytes, unit, width, height))
+        {
+            throw_error("Not an encoded depth frame");
+            return scope.Close(Undefined());
+        }
+
+        Buffer *const depth = Buffer::New(width * height * 2);
+
+        if (!decode_depth(data, bytes,
+                    reinterpret_cast<uint8_t *>(Buffer::Data(depth))))
+        {
+            throw_error("Corrupt encoded depth frame");
+            return scope.Close(Undefined());
+        }
+
+        Local<Object> frame = Object::New();
+        frame->Set(String::NewSymbol("width"), Integer::New(width));
+        frame->Set(String::NewSymbol("height"), Integer::New(height));
+        frame->Set(String::NewSymbol("depthFormat"), Integer::New(
+                    unit == DepthUnit::RAW ? FREENECT_DEPTH_11BIT
+                    : FREENECT_DEPTH_MM));
+        frame->Set(String::NewSymbol("depth"), depth->handle_);
+        return scope.Close(frame);
+    }
+
+    void DepthEncoder::Initialize(Handle<Object> const target)
+    {
+        NODE_SET_METHOD(target, "encodeDepth", call_encode_depth);
+        NODE_SET_METHOD(target, "decodeDepth", call_decode_depth);
+    }
+}
+
+
+namespace
+{
+    // Leaves value alone if the key is missing and fails if it is not an
+    // unsigned integer.
+    bool get_size_option(Local<Object> const options, char const *const key,
+            size_t &value)
+    {
+        Handle<String> const name = String::NewSymbol(key);
+
+        if (!options->Has(name))
+        {
+            return true;
+        }
+
+        Local<Value> const option = options->Get(name);
+
+        if (!option->IsUint32())
+        {
+            return false;
+        }
+
+        value = option->Uint32Value();
+        return true;
+    }
+}
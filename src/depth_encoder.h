@@ -0,0 +1,59 @@
+#ifndef DEPTH_ENCODER_H
+#define DEPTH_ENCODER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include <libfreenect.h>
+
+#include "depth.h"
+#include "worker.h"
+
+
+namespace kinect
+{
+    // Compresses depth frames with the depth codec on the libuv thread
+    // pool, one at a time, for the compressed depth callback. Also exports
+    // Kinect.encodeDepth() and Kinect.decodeDepth().
+    class DepthEncoder
+    {
+        public:
+            static void Initialize(v8::Handle<v8::Object> target);
+
+            DepthEncoder();
+            void set_owner(WorkerOwner *owner);
+            bool is_busy() const;
+
+            // Copies frame, a depth frame in unit, encodes it on the worker
+            // and then calls done on the loop thread.
+            bool queue(uint8_t const *frame, freenect_frame_mode const &mode,
+                    DepthUnit unit, uint32_t timestamp,
+                    std::function<void()> done);
+
+            // A new Buffer of the last encoded frame
+            v8::Handle<v8::Value> encoded() const;
+            uint32_t timestamp() const;
+
+        private:
+            DepthEncoder(DepthEncoder const &that) = delete;
+
+            static v8::Handle<v8::Value> call_encode_depth(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_decode_depth(
+                    v8::Arguments const &args);
+
+            std::vector<uint8_t> depth_;
+            std::vector<uint8_t> encoded_;
+            size_t encoded_bytes_;
+            uint32_t timestamp_;
+            Worker worker_;
+    };
+}
+
+
+#endif  // DEPTH_ENCODER_H
@@ -0,0 +1,682 @@
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "depth_filter.h"
+
+
+namespace
+{
+    struct Blend
+    {
+        float alpha;
+        float threshold;
+        float hold;
+    };
+
+    struct Range
+    {
+        float inverse_threshold_squared;
+        float const *spatial;  // 2 * radius + 1 weights
+        ptrdiff_t radius;
+    };
+
+    void exponential_scalar(uint16_t *, float *, float *, size_t,
+            Blend const &);
+    void exponential_sse41(uint16_t *, float *, float *, size_t,
+            Blend const &);
+    void median_scalar(uint16_t *, uint16_t const *, size_t, size_t,
+            size_t);
+    void median_sse41(uint16_t *, uint16_t const *, size_t, size_t);
+    void bilateral_scalar(float const *, ptrdiff_t, size_t, Range const &,
+            float *);
+    void bilateral_sse41(float const *, ptrdiff_t, size_t, Range const &,
+            float *);
+    void bilateral_avx2(float const *, ptrdiff_t, size_t, Range const &,
+            float *);
+    void fill_run(uint16_t *, size_t, size_t, uint16_t);
+}
+
+
+namespace kinect
+{
+    DepthFilterOptions DepthFilter::default_options()
+    {
+        DepthFilterOptions options;
+        options.temporal = TemporalFilter::EXPONENTIAL;
+        options.alpha = 0.5f;
+        options.hold = 2;
+        options.frames = 3;
+        options.spatial = SpatialFilter::OFF;
+        options.radius = 2;
+        options.fill = 0;
+        options.threshold = 0;
+        return options;
+    }
+
+    DepthFilter::DepthFilter() :
+            has_sse41_(__builtin_cpu_supports("sse4.1")),
+            has_avx2_(__builtin_cpu_supports("avx2")), is_enabled_(false),
+            options_(default_options()), is_reset_(true),
+            unit_(DepthUnit::RAW), pixels_(0), next_frame_(0),
+            padded_pitch_(0)
+    {
+        uv_mutex_init(&mutex_);
+    }
+
+    DepthFilter::~DepthFilter()
+    {
+        uv_mutex_destroy(&mutex_);
+    }
+
+    bool DepthFilter::is_enabled() const
+    {
+        return is_enabled_;
+    }
+
+    void DepthFilter::set_options(DepthFilterOptions const &options)
+    {
+        uv_mutex_lock(&mutex_);
+        options_ = options;
+        is_reset_ = true;
+        is_enabled_ = true;
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void DepthFilter::disable()
+    {
+        uv_mutex_lock(&mutex_);
+        is_enabled_ = false;
+        is_reset_ = true;
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void DepthFilter::process(DepthUnit const unit, uint8_t *const depth,
+            size_t const width, size_t const height)
+    {
+        if (!is_enabled_)
+        {
+            return;
+        }
+
+        uv_mutex_lock(&mutex_);
+
+        size_t const pixels = width * height;
+        uint16_t *const codes = reinterpret_cast<uint16_t *>(depth);
+        uint16_t const threshold = options_.threshold != 0
+            ? options_.threshold : default_depth_threshold(unit);
+
+        if (is_reset_ || unit != unit_ || pixels != pixels_)
+        {
+            unit_ = unit;
+            pixels_ = pixels;
+            average_.assign(pixels, 0.0f);
+            age_.assign(pixels, 0.0f);
+            frames_.clear();
+            next_frame_ = 0;
+            is_reset_ = false;
+        }
+
+        depth_to_codes(unit, codes, pixels);
+
+        switch (options_.temporal)
+        {
+            case TemporalFilter::OFF:
+                break;
+            case TemporalFilter::EXPONENTIAL:
+                exponential(codes, pixels, threshold);
+                break;
+            case TemporalFilter::MEDIAN:
+                median(codes, pixels);
+                break;
+        }
+
+        if (options_.spatial == SpatialFilter::BILATERAL)
+        {
+            bilateral(codes, width, height, threshold);
+        }
+
+        if (options_.fill > 0)
+        {
+            fill_holes(codes, width, height, threshold);
+        }
+
+        codes_to_depth(unit, codes, pixels);
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void DepthFilter::exponential(uint16_t *const codes, size_t const pixels,
+            uint16_t const threshold)
+    {
+        Blend const blend = {
+            options_.alpha,
+            float(threshold),
+            float(options_.hold)
+        };
+
+        if (has_sse41_)
+        {
+            exponential_sse41(codes, average_.data(), age_.data(), pixels,
+                    blend);
+        }
+        else
+        {
+            exponential_scalar(codes, average_.data(), age_.data(), pixels,
+                    blend);
+        }
+    }
+
+    void DepthFilter::median(uint16_t *const codes, size_t const pixels)
+    {
+        size_t const frames = options_.frames;
+
+        // The history starts out as copies of the first frame.
+        if (frames_.empty())
+        {
+            frames_.resize(frames * pixels);
+
+            for (size_t i = 0; i < frames; ++i)
+            {
+                std::copy(codes, codes + pixels, &frames_[i * pixels]);
+            }
+        }
+        else
+        {
+            std::copy(codes, codes + pixels, &frames_[next_frame_ * pixels]);
+        }
+
+        next_frame_ = (next_frame_ + 1) % frames;
+
+        if (has_sse41_)
+        {
+            median_sse41(codes, frames_.data(), frames, pixels);
+        }
+        else
+        {
+            median_scalar(codes, frames_.data(), frames, pixels, 0);
+        }
+    }
+
+    // Filters along rows and then along the columns of the result. The
+    // codes are padded with radius invalid ones all round, so the taps
+    // never leave the buffers.
+    void DepthFilter::bilateral(uint16_t *const codes, size_t const width,
+            size_t const height, uint16_t const threshold)
+    {
+        size_t const radius = std::min(options_.radius, MAX_RADIUS);
+        size_t const pitch = width + 2 * radius;
+        size_t const padding = radius * pitch + radius;
+        size_t const size = pitch * (height + 2 * radius);
+
+        if (pitch != padded_pitch_ || size != padded_.size())
+        {
+            padded_.assign(size, 0.0f);
+            rows_.assign(size, 0.0f);
+            padded_pitch_ = pitch;
+        }
+
+        // A Gaussian with a standard deviation of half the radius
+        float spatial[2 * MAX_RADIUS + 1];
+        float const sigma = radius / 2.0f;
+
+        for (size_t i = 0; i <= 2 * radius; ++i)
+        {
+            float const offset = float(i) - float(radius);
+            spatial[i] = std::exp(-offset * offset / (2.0f * sigma * sigma));
+        }
+
+        Range const range = {
+            1.0f / (float(threshold) * float(threshold)),
+            spatial,
+            ptrdiff_t(radius)
+        };
+
+        auto const pass = has_avx2_ ? bilateral_avx2
+            : has_sse41_ ? bilateral_sse41 : bilateral_scalar;
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            std::copy(codes + y * width, codes + (y + 1) * width,
+                    &padded_[padding + y * pitch]);
+        }
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            pass(&padded_[padding + y * pitch], 1, width, range,
+                    &rows_[padding + y * pitch]);
+        }
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            pass(&rows_[padding + y * pitch], ptrdiff_t(pitch), width, range,
+                    &padded_[padding + y * pitch]);
+        }
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            float const *const row = &padded_[padding + y * pitch];
+
+            for (size_t x = 0; x < width; ++x)
+            {
+                codes[y * width + x] = uint16_t(std::nearbyint(row[x]));
+            }
+        }
+    }
+
+    // Fills runs of at most fill invalid codes along rows and then
+    // columns. The columns are walked a row at a time, with the first row
+    // of the hole each column is in.
+    void DepthFilter::fill_holes(uint16_t *const codes, size_t const width,
+            size_t const height, uint16_t const threshold)
+    {
+        size_t const fill = options_.fill;
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            uint16_t *const row = codes + y * width;
+            size_t x = 0;
+
+            while (x < width)
+            {
+                if (row[x] != 0)
+                {
+                    ++x;
+                    continue;
+                }
+
+                size_t const begin = x;
+
+                while (x < width && row[x] == 0)
+                {
+                    ++x;
+                }
+
+                if (begin > 0 && x < width && x - begin <= fill)
+                {
+                    fill_run(row + begin - 1, 1, x - begin, threshold);
+                }
+            }
+        }
+
+        uint32_t const none = uint32_t(height);
+        holes_.assign(width, none);
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            uint16_t *const row = codes + y * width;
+
+            for (size_t x = 0; x < width; ++x)
+            {
+                uint32_t &begin = holes_[x];
+
+                if (row[x] == 0)
+                {
+                    if (begin == none)
+                    {
+                        begin = uint32_t(y);
+                    }
+                }
+                else if (begin != none)
+                {
+                    if (begin > 0 && y - begin <= fill)
+                    {
+                        fill_run(codes + (begin - 1) * width + x, width,
+                                y - begin, threshold);
+                    }
+
+                    begin = none;
+                }
+            }
+        }
+    }
+}
+
+
+namespace
+{
+    // =====================================================================
+    // = Exponential                                                       =
+    // =====================================================================
+
+    // A valid code moves the average towards it, or restarts it if the
+    // average is empty or too far away. An invalid code leaves the average
+    // alone for hold frames and then empties it.
+    void exponential_scalar(uint16_t *const codes, float *const average,
+            float *const age, size_t const pixels, Blend const &blend)
+    {
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            float const code = codes[i];
+            float const previous = average[i];
+
+            if (code > 0.0f)
+            {
+                float const difference = code - previous;
+                bool const restart = previous == 0.0f
+                    || std::fabs(difference) > blend.threshold;
+                average[i] = restart ? code
+                    : previous + blend.alpha * difference;
+                age[i] = 0.0f;
+            }
+            else
+            {
+                age[i] += 1.0f;
+                average[i] = age[i] > blend.hold ? 0.0f : previous;
+            }
+
+            codes[i] = uint16_t(std::nearbyint(average[i]));
+        }
+    }
+
+    __attribute__((target("sse4.1")))
+    inline __m128 blend_sse41(__m128 const code, float *const average,
+            float *const age, Blend const &blend)
+    {
+        __m128 const zero = _mm_setzero_ps();
+        __m128 const one = _mm_set1_ps(1.0f);
+        __m128 const sign = _mm_set1_ps(-0.0f);
+        __m128 const alpha = _mm_set1_ps(blend.alpha);
+        __m128 const threshold = _mm_set1_ps(blend.threshold);
+        __m128 const hold = _mm_set1_ps(blend.hold);
+
+        __m128 const previous = _mm_loadu_ps(average);
+        __m128 const valid = _mm_cmpgt_ps(code, zero);
+        __m128 const difference = _mm_sub_ps(code, previous);
+        __m128 const restart = _mm_or_ps(_mm_cmpeq_ps(previous, zero),
+                _mm_cmpgt_ps(_mm_andnot_ps(sign, difference), threshold));
+        __m128 const blended = _mm_blendv_ps(
+                _mm_add_ps(previous, _mm_mul_ps(alpha, difference)), code,
+                restart);
+
+        __m128 const aged = _mm_add_ps(_mm_loadu_ps(age), one);
+        __m128 const held = _mm_andnot_ps(_mm_cmpgt_ps(aged, hold),
+                previous);
+        __m128 const next = _mm_blendv_ps(held, blended, valid);
+
+        _mm_storeu_ps(average, next);
+        _mm_storeu_ps(age, _mm_andnot_ps(valid, aged));
+        return next;
+    }
+
+    __attribute__((target("sse4.1")))
+    void exponential_sse41(uint16_t *const codes, float *const average,
+            float *const age, size_t const pixels, Blend const &blend)
+    {
+        size_t i = 0;
+
+        for (; i + 8 <= pixels; i += 8)
+        {
+            __m128i const code = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(codes + i));
+            __m128 const low = _mm_cvtepi32_ps(_mm_cvtepu16_epi32(code));
+            __m128 const high = _mm_cvtepi32_ps(
+                    _mm_cvtepu16_epi32(_mm_srli_si128(code, 8)));
+
+            __m128i const next = _mm_packus_epi32(
+                    _mm_cvtps_epi32(blend_sse41(low, average + i, age + i,
+                            blend)),
+                    _mm_cvtps_epi32(blend_sse41(high, average + i + 4,
+                            age + i + 4, blend)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(codes + i), next);
+        }
+
+        exponential_scalar(codes + i, average + i, age + i, pixels - i,
+                blend);
+    }
+
+
+    // =====================================================================
+    // = Median                                                            =
+    // =====================================================================
+
+    // The median is taken twice, once with invalid codes sorting first and
+    // once last, and the two averaged. That is the median of the valid
+    // codes when at most one is invalid, and close to it otherwise. Pixels
+    // invalid in more than half of the frames stay invalid.
+    uint16_t median3(uint16_t const a, uint16_t const b, uint16_t const c)
+    {
+        return std::max(std::min(a, b), std::min(std::max(a, b), c));
+    }
+
+    // The middle two of the first four and the fifth
+    uint16_t median5(uint16_t const a, uint16_t const b, uint16_t const c,
+            uint16_t const d, uint16_t const e)
+    {
+        return median3(std::max(std::min(a, b), std::min(c, d)),
+                std::min(std::max(a, b), std::max(c, d)), e);
+    }
+
+    void median_scalar(uint16_t *const codes, uint16_t const *const history,
+            size_t const frames, size_t const pixels, size_t const begin)
+    {
+        for (size_t i = begin; i < pixels; ++i)
+        {
+            uint16_t low[5];
+            uint16_t high[5];
+
+            for (size_t j = 0; j < frames; ++j)
+            {
+                low[j] = history[j * pixels + i];
+                high[j] = uint16_t(low[j] - 1);
+            }
+
+            uint16_t const first = frames == 3
+                ? median3(low[0], low[1], low[2])
+                : median5(low[0], low[1], low[2], low[3], low[4]);
+            uint16_t const last = frames == 3
+                ? median3(high[0], high[1], high[2])
+                : median5(high[0], high[1], high[2], high[3], high[4]);
+            codes[i] = last == 0xffff ? 0
+                : uint16_t((first + last + 2) >> 1);
+        }
+    }
+
+    __attribute__((target("sse4.1")))
+    inline __m128i median3_sse41(__m128i const a, __m128i const b,
+            __m128i const c)
+    {
+        return _mm_max_epu16(_mm_min_epu16(a, b),
+                _mm_min_epu16(_mm_max_epu16(a, b), c));
+    }
+
+    __attribute__((target("sse4.1")))
+    inline __m128i median_of_sse41(__m128i const *const v,
+            size_t const frames)
+    {
+        if (frames == 3)
+        {
+            return median3_sse41(v[0], v[1], v[2]);
+        }
+
+        return median3_sse41(
+                _mm_max_epu16(_mm_min_epu16(v[0], v[1]),
+                    _mm_min_epu16(v[2], v[3])),
+                _mm_min_epu16(_mm_max_epu16(v[0], v[1]),
+                    _mm_max_epu16(v[2], v[3])),
+                v[4]);
+    }
+
+    __attribute__((target("sse4.1")))
+    void median_sse41(uint16_t *const codes, uint16_t const *const history,
+            size_t const frames, size_t const pixels)
+    {
+        __m128i const one = _mm_set1_epi16(1);
+        __m128i const invalid = _mm_set1_epi16(-1);
+        size_t i = 0;
+
+        for (; i + 8 <= pixels; i += 8)
+        {
+            __m128i low[5];
+            __m128i high[5];
+
+            for (size_t j = 0; j < frames; ++j)
+            {
+                low[j] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(
+                            history + j * pixels + i));
+                high[j] = _mm_sub_epi16(low[j], one);
+            }
+
+            __m128i const first = median_of_sse41(low, frames);
+            __m128i const last = median_of_sse41(high, frames);
+            __m128i const middle = _mm_avg_epu16(first,
+                    _mm_add_epi16(last, one));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(codes + i),
+                    _mm_andnot_si128(_mm_cmpeq_epi16(last, invalid), middle));
+        }
+
+        median_scalar(codes, history, frames, pixels, i);
+    }
+
+
+    // =====================================================================
+    // = Bilateral                                                         =
+    // =====================================================================
+
+    // Each valid neighbour within step * radius of a valid code is
+    // weighted by its distance along the step and by a biweight of its
+    // depth difference, which falls to 0 at the threshold, so other
+    // surfaces take no part. Invalid codes stay invalid.
+    void bilateral_scalar(float const *const codes, ptrdiff_t const step,
+            size_t const count, Range const &range, float *const out)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            float const centre = codes[i];
+            float sum = 0.0f;
+            float total = 0.0f;
+
+            for (ptrdiff_t k = -range.radius; k <= range.radius; ++k)
+            {
+                float const code = codes[ptrdiff_t(i) + k * step];
+                float const difference = code - centre;
+                float const ratio = difference * difference
+                    * range.inverse_threshold_squared;
+                float const falloff = 1.0f - ratio;
+                float const weight = ratio < 1.0f && code > 0.0f
+                    ? falloff * falloff * range.spatial[k + range.radius]
+                    : 0.0f;
+                sum += weight * code;
+                total += weight;
+            }
+
+            out[i] = centre > 0.0f ? sum / total : 0.0f;
+        }
+    }
+
+    __attribute__((target("sse4.1")))
+    void bilateral_sse41(float const *const codes, ptrdiff_t const step,
+            size_t const count, Range const &range, float *const out)
+    {
+        __m128 const zero = _mm_setzero_ps();
+        __m128 const one = _mm_set1_ps(1.0f);
+        __m128 const inverse = _mm_set1_ps(range.inverse_threshold_squared);
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 const centre = _mm_loadu_ps(codes + i);
+            __m128 sum = zero;
+            __m128 total = zero;
+
+            for (ptrdiff_t k = -range.radius; k <= range.radius; ++k)
+            {
+                __m128 const code = _mm_loadu_ps(codes + ptrdiff_t(i)
+                        + k * step);
+                __m128 const difference = _mm_sub_ps(code, centre);
+                __m128 const ratio = _mm_mul_ps(
+                        _mm_mul_ps(difference, difference), inverse);
+                __m128 const falloff = _mm_sub_ps(one, ratio);
+                __m128 const near = _mm_and_ps(_mm_cmplt_ps(ratio, one),
+                        _mm_cmpgt_ps(code, zero));
+                __m128 const weight = _mm_and_ps(near, _mm_mul_ps(
+                            _mm_mul_ps(falloff, falloff),
+                            _mm_set1_ps(range.spatial[k + range.radius])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(weight, code));
+                total = _mm_add_ps(total, weight);
+            }
+
+            // 0 / 0 where the centre is invalid, masked to 0
+            _mm_storeu_ps(out + i, _mm_and_ps(_mm_cmpgt_ps(centre, zero),
+                        _mm_div_ps(sum, total)));
+        }
+
+        bilateral_scalar(codes + i, step, count - i, range, out + i);
+    }
+
+    __attribute__((target("avx2")))
+    void bilateral_avx2(float const *const codes, ptrdiff_t const step,
+            size_t const count, Range const &range, float *const out)
+    {
+        __m256 const zero = _mm256_setzero_ps();
+        __m256 const one = _mm256_set1_ps(1.0f);
+        __m256 const inverse = _mm256_set1_ps(
+                range.inverse_threshold_squared);
+        size_t i = 0;
+
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 const centre = _mm256_loadu_ps(codes + i);
+            __m256 sum = zero;
+            __m256 total = zero;
+
+            for (ptrdiff_t k = -range.radius; k <= range.radius; ++k)
+            {
+                __m256 const code = _mm256_loadu_ps(codes + ptrdiff_t(i)
+                        + k * step);
+                __m256 const difference = _mm256_sub_ps(code, centre);
+                __m256 const ratio = _mm256_mul_ps(
+                        _mm256_mul_ps(difference, difference), inverse);
+                __m256 const falloff = _mm256_sub_ps(one, ratio);
+                __m256 const near = _mm256_and_ps(
+                        _mm256_cmp_ps(ratio, one, _CMP_LT_OQ),
+                        _mm256_cmp_ps(code, zero, _CMP_GT_OQ));
+                __m256 const weight = _mm256_and_ps(near, _mm256_mul_ps(
+                            _mm256_mul_ps(falloff, falloff),
+                            _mm256_set1_ps(range.spatial[k + range.radius])));
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(weight, code));
+                total = _mm256_add_ps(total, weight);
+            }
+
+            _mm256_storeu_ps(out + i, _mm256_and_ps(
+                        _mm256_cmp_ps(centre, zero, _CMP_GT_OQ),
+                        _mm256_div_ps(sum, total)));
+        }
+
+        bilateral_sse41(codes + i, step, count - i, range, out + i);
+    }
+
+
+    // =====================================================================
+    // = Holes                                                             =
+    // =====================================================================
+
+    // A run between values within threshold of each other is interpolated,
+    // otherwise it takes the farther value, as the holes the projector's
+    // shadow leaves belong to the background. before is the valid code
+    // ahead of the run.
+    void fill_run(uint16_t *const before, size_t const stride,
+            size_t const run, uint16_t const threshold)
+    {
+        int const first = before[0];
+        int const last = before[(run + 1) * stride];
+
+        if (std::abs(last - first) <= threshold)
+        {
+            for (size_t i = 1; i <= run; ++i)
+            {
+                before[i * stride] = uint16_t(first
+                        + (last - first) * int(i) / int(run + 1));
+            }
+        }
+        else
+        {
+            uint16_t const farther = uint16_t(std::max(first, last));
+
+            for (size_t i = 1; i <= run; ++i)
+            {
+                before[i * stride] = farther;
+            }
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef DEPTH_FILTER_H
+#define DEPTH_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <uv.h>
+
+#include "depth.h"
+
+
+namespace kinect
+{
+    enum class TemporalFilter
+    {
+        OFF,
+        EXPONENTIAL,  // Running average of each pixel
+        MEDIAN        // Median of each pixel over the last frames
+    };
+
+    enum class SpatialFilter
+    {
+        OFF,
+        BILATERAL  // Separable bilateral within each surface
+    };
+
+    struct DepthFilterOptions
+    {
+        TemporalFilter temporal;
+
+        // EXPONENTIAL: weight of the newest frame, in (0, 1]
+        float alpha;
+
+        // EXPONENTIAL: frames an invalid pixel keeps its last value for
+        uint32_t hold;
+
+        // MEDIAN: 3 or 5
+        size_t frames;
+
+        SpatialFilter spatial;
+
+        // BILATERAL: pixels either side averaged, 1 to MAX_RADIUS
+        size_t radius;
+
+        // Longest run of invalid pixels filled, 0 for none
+        size_t fill;
+
+        // Depth difference in the frame's unit beyond which two values are
+        // on different surfaces, so a pixel's history restarts, and
+        // neither the bilateral filter nor the holes interpolate across
+        // them. 0 for the unit's default.
+        uint16_t threshold;
+    };
+
+    // Smooths depth frames over time and space without blurring across
+    // edges, and fills the holes along them, in place, on one worker
+    // thread at a time. The options are set from the loop thread.
+    class DepthFilter
+    {
+        public:
+            static size_t const MAX_RADIUS = 5;
+            static DepthFilterOptions default_options();
+
+            DepthFilter();
+            ~DepthFilter();
+            bool is_enabled() const;
+
+            // Starts the history afresh.
+            void set_options(DepthFilterOptions const &options);
+            void disable();
+
+            // Worker thread
+            void process(DepthUnit unit, uint8_t *depth, size_t width,
+                    size_t height);
+
+        private:
+            DepthFilter(DepthFilter const &that) = delete;
+            void exponential(uint16_t *codes, size_t pixels,
+                    uint16_t threshold);
+            void median(uint16_t *codes, size_t pixels);
+            void bilateral(uint16_t *codes, size_t width, size_t height,
+                    uint16_t threshold);
+            void fill_holes(uint16_t *codes, size_t width, size_t height,
+                    uint16_t threshold);
+
+            bool const has_sse41_;
+            bool const has_avx2_;
+            std::atomic<bool> is_enabled_;
+
+            // Shared, under mutex_
+            uv_mutex_t mutex_;
+            DepthFilterOptions options_;
+            bool is_reset_;
+
+            // Worker thread, under mutex_. Depth is kept as codes that
+            // order values by distance, 0 where invalid.
+            DepthUnit unit_;
+            size_t pixels_;
+            std::vector<float> average_;
+            std::vector<float> age_;
+            std::vector<uint16_t> frames_;
+            size_t next_frame_;
+            std::vector<uint32_t> holes_;
+
+            // BILATERAL: the codes with radius invalid pixels around them,
+            // before and after the pass along rows, padded_pitch_ floats
+            // to a row. The passes only write inside the border, so it is
+            // zeroed when the buffers are sized for a new frame size.
+            size_t padded_pitch_;
+            std::vector<float> padded_;
+            std::vector<float> rows_;
+    };
+
+}
+
+
+#endif  // DEPTH_FILTER_H
@@ -0,0 +1,205 @@
+#include <cassert>
+#include <cstring>
+
+#include "depth_processor.h"
+
+
+using node::Buffer;
+using v8::Handle;
+using v8::Persistent;
+using v8::Value;
+
+
+namespace kinect
+{
+    DepthProcessor::DepthProcessor() : bytes_(0), front_(0), sequence_(0),
+            dropped_(0)
+    {
+        for (size_t i = 0; i < BUFFERS; ++i)
+        {
+            buffers_[i] = nullptr;
+            outputs_[i].timestamp = 0;
+            outputs_[i].time = 0;
+            outputs_[i].has_foreground = false;
+            outputs_[i].has_summary = false;
+        }
+    }
+
+    DepthProcessor::~DepthProcessor()
+    {
+        release();
+    }
+
+    void DepthProcessor::set_owner(WorkerOwner *const owner)
+    {
+        worker_.set_owner(owner);
+    }
+
+    bool DepthProcessor::is_enabled() const
+    {
+        return filter_.is_enabled() || background_.is_active()
+            || summarizer_.is_enabled();
+    }
+
+    bool DepthProcessor::is_busy() const
+    {
+        return worker_.is_busy();
+    }
+
+    DepthFilter &DepthProcessor::filter()
+    {
+        return filter_;
+    }
+
+    BackgroundModel &DepthProcessor::background()
+    {
+        return background_;
+    }
+
+    BackgroundModel const &DepthProcessor::background() const
+    {
+        return background_;
+    }
+
+    DepthSummarizer &DepthProcessor::summarizer()
+    {
+        return summarizer_;
+    }
+
+    bool DepthProcessor::queue(DepthUnit const unit,
+            uint8_t const *const frame, freenect_frame_mode const &mode,
+            uint32_t const timestamp, uint64_t const time,
+            std::function<void()> done)
+    {
+        if (worker_.is_busy())
+        {
+            return false;
+        }
+
+        // The ring slot may be reused as soon as the next frame is
+        // acquired, so the stages work in place on a copy.
+        allocate(mode.bytes);
+        size_t const back = (front_ + 1) % BUFFERS;
+        uint8_t *const depth = (uint8_t *) Buffer::Data(buffers_[back]);
+        std::memcpy(depth, frame, mode.bytes);
+
+        // The stages are switched on and off from this thread, so each
+        // frame goes through those that were on when it was queued.
+        size_t const width = mode.width;
+        size_t const height = mode.height;
+        bool const is_filtering = filter_.is_enabled();
+        bool const is_separating = background_.is_active();
+        bool const is_summarizing = summarizer_.is_enabled();
+        uint64_t const sequence = ++sequence_;
+        Output &output = outputs_[back];
+        output.timestamp = timestamp;
+        output.time = time;
+        output.has_foreground = is_separating;
+        output.has_summary = is_summarizing;
+
+        return worker_.queue(
+            [this, unit, depth, width, height, is_filtering, is_separating,
+                    is_summarizing, &output]()
+            {
+                if (is_filtering)
+                {
+                    filter_.process(unit, depth, width, height);
+                }
+
+                if (is_separating)
+                {
+                    output.foreground.resize(width * height);
+                    background_.process(unit, depth, width * height,
+                            output.foreground.data());
+                }
+
+                if (is_summarizing)
+                {
+                    summarizer_.summarize(unit, depth, width, height,
+                            output.timestamp, output.summary);
+                }
+            },
+            [this, back, sequence, done]()
+            {
+                if (sequence <= dropped_)
+                {
+                    return;
+                }
+
+                front_ = back;
+                done();
+            });
+    }
+
+    void DepthProcessor::reset()
+    {
+        dropped_ = sequence_;
+    }
+
+    uint8_t const *DepthProcessor::front() const
+    {
+        assert(buffers_[front_] != nullptr);
+        return (uint8_t const *) Buffer::Data(buffers_[front_]);
+    }
+
+    Handle<Value> DepthProcessor::front_handle() const
+    {
+        assert(buffers_[front_] != nullptr);
+        return buffers_[front_]->handle_;
+    }
+
+    uint32_t DepthProcessor::front_timestamp() const
+    {
+        return outputs_[front_].timestamp;
+    }
+
+    uint64_t DepthProcessor::front_time() const
+    {
+        return outputs_[front_].time;
+    }
+
+    uint8_t const *DepthProcessor::front_foreground() const
+    {
+        Output const &output = outputs_[front_];
+        return output.has_foreground ? output.foreground.data() : nullptr;
+    }
+
+    DepthSummary const *DepthProcessor::front_summary() const
+    {
+        Output const &output = outputs_[front_];
+        return output.has_summary ? &output.summary : nullptr;
+    }
+
+    void DepthProcessor::allocate(size_t const bytes)
+    {
+        if (bytes == bytes_)
+        {
+            return;
+        }
+
+        release();
+
+        for (size_t i = 0; i < BUFFERS; ++i)
+        {
+            buffers_[i] = Buffer::New(bytes);
+            handles_[i] = Persistent<Value>::New(buffers_[i]->handle_);
+        }
+
+        bytes_ = bytes;
+    }
+
+    void DepthProcessor::release()
+    {
+        for (size_t i = 0; i < BUFFERS; ++i)
+        {
+            if (buffers_[i] != nullptr)
+            {
+                handles_[i].Dispose();
+                handles_[i].Clear();
+                buffers_[i] = nullptr;
+            }
+        }
+
+        bytes_ = 0;
+    }
+}
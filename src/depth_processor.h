@@ -0,0 +1,95 @@
+#ifndef DEPTH_PROCESSOR_H
+#define DEPTH_PROCESSOR_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include <libfreenect.h>
+
+#include "background.h"
+#include "depth.h"
+#include "depth_filter.h"
+#include "depth_summary.h"
+#include "worker.h"
+
+
+namespace kinect
+{
+    // Filters depth frames, finds their foreground and summarises them on
+    // the libuv thread pool rather than on the libfreenect event thread,
+    // into double-buffered frames. The stages see the frames in the order
+    // they were queued, which is the order they were produced in, less
+    // those that arrived while the worker was busy.
+    class DepthProcessor
+    {
+        public:
+            DepthProcessor();
+            ~DepthProcessor();
+            void set_owner(WorkerOwner *owner);
+            bool is_enabled() const;
+            bool is_busy() const;
+
+            DepthFilter &filter();
+            BackgroundModel &background();
+            BackgroundModel const &background() const;
+            DepthSummarizer &summarizer();
+
+            // Copies frame, a depth frame of mode that arrived at time,
+            // processes it on the worker and then calls done on the loop
+            // thread, unless reset() was called in between.
+            bool queue(DepthUnit unit, uint8_t const *frame,
+                    freenect_frame_mode const &mode, uint32_t timestamp,
+                    uint64_t time, std::function<void()> done);
+
+            // Drops the frame on the worker, if any, for a stopped stream
+            void reset();
+
+            uint8_t const *front() const;
+            v8::Handle<v8::Value> front_handle() const;
+            uint32_t front_timestamp() const;
+            uint64_t front_time() const;
+
+            // nullptr when the stage was off for the frame
+            uint8_t const *front_foreground() const;
+            DepthSummary const *front_summary() const;
+
+        private:
+            static size_t const BUFFERS = 2;
+
+            struct Output
+            {
+                uint32_t timestamp;
+                uint64_t time;
+                bool has_foreground;
+                std::vector<uint8_t> foreground;
+                bool has_summary;
+                DepthSummary summary;
+            };
+
+            DepthProcessor(DepthProcessor const &that) = delete;
+            DepthFilter filter_;
+            BackgroundModel background_;
+            DepthSummarizer summarizer_;
+            node::Buffer *buffers_[BUFFERS];
+            v8::Persistent<v8::Value> handles_[BUFFERS];
+            Output outputs_[BUFFERS];
+            size_t bytes_;
+            size_t front_;
+
+            // Numbers the queued frames. Frames numbered up to dropped_ are
+            // not delivered.
+            uint64_t sequence_;
+            uint64_t dropped_;
+            Worker worker_;
+
+            void allocate(size_t bytes);
+            void release();
+    };
+}
+
+
+#endif  // DEPTH_PROCESSOR_H
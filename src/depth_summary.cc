@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <limits>
+
+#include "depth_summary.h"
+
+
+namespace
+{
+    constexpr uint16_t NO_BIN = 0xffff;
+
+    void count_values(uint16_t const *, size_t, uint16_t, uint32_t *);
+    void add_pixels(uint16_t const *, size_t, uint16_t, float const *,
+            uint32_t *, kinect::DepthCell &, double &);
+    void add_counts(uint32_t const *, float const *, uint16_t const *,
+            size_t, kinect::DepthCell &, double &, uint32_t *);
+}
+
+
+namespace kinect
+{
+    DepthSummaryOptions DepthSummarizer::default_options()
+    {
+        DepthSummaryOptions options;
+        options.bins = 64;
+        options.min = 0.0f;
+        options.max = 8.0f;
+        options.columns = 1;
+        options.rows = 1;
+        return options;
+    }
+
+    DepthSummarizer::DepthSummarizer() : is_enabled_(false),
+            options_(default_options()), is_reset_(true),
+            unit_(DepthUnit::RAW)
+    {
+        uv_mutex_init(&mutex_);
+    }
+
+    DepthSummarizer::~DepthSummarizer()
+    {
+        uv_mutex_destroy(&mutex_);
+    }
+
+    bool DepthSummarizer::is_enabled() const
+    {
+        return is_enabled_;
+    }
+
+    void DepthSummarizer::set_options(DepthSummaryOptions const &options)
+    {
+        uv_mutex_lock(&mutex_);
+        options_ = options;
+        is_reset_ = true;
+        is_enabled_ = true;
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void DepthSummarizer::disable()
+    {
+        is_enabled_ = false;
+    }
+
+    void DepthSummarizer::summarize(DepthUnit const unit,
+            uint8_t const *const depth, size_t const width,
+            size_t const height, uint32_t const timestamp,
+            DepthSummary &summary)
+    {
+        uv_mutex_lock(&mutex_);
+
+        if (is_reset_ || unit != unit_)
+        {
+            build_tables(unit);
+            is_reset_ = false;
+        }
+
+        size_t const values = metres_.size();
+        size_t const columns = std::max<size_t>(
+                std::min(options_.columns, width), 1);
+        size_t const rows = std::max<size_t>(std::min(options_.rows, height),
+                1);
+        size_t const cells = columns * rows;
+        DepthCell empty = DepthCell();
+        empty.min = std::numeric_limits<float>::infinity();
+        counts_.assign(values, 0);
+        cells_.assign(cells > 1 ? cells : 0, empty);
+        sums_.assign(cells_.size(), 0.0);
+
+        // Values past the table share its last entry, which is invalid.
+        uint16_t const *const pixels =
+            reinterpret_cast<uint16_t const *>(depth);
+        uint16_t const last = uint16_t(values - 1);
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            uint16_t const *const row = pixels + y * width;
+            size_t const first = y * rows / height * columns;
+
+            if (cells_.empty())
+            {
+                count_values(row, width, last, counts_.data());
+                continue;
+            }
+
+            for (size_t column = 0; column < columns; ++column)
+            {
+                size_t const begin = column * width / columns;
+                size_t const end = (column + 1) * width / columns;
+                add_pixels(row + begin, end - begin, last, metres_.data(),
+                        counts_.data(), cells_[first + column],
+                        sums_[first + column]);
+            }
+        }
+
+        // The frame follows from the counts, and each cell from its sums
+        summary.timestamp = timestamp;
+        summary.frame = DepthCell();
+        summary.histogram.assign(options_.bins, 0);
+        double frame_sum = 0.0;
+        add_counts(counts_.data(), metres_.data(), bins_.data(), values,
+                summary.frame, frame_sum, summary.histogram.data());
+        summary.frame.mean = summary.frame.valid > 0
+            ? float(frame_sum / summary.frame.valid) : 0.0f;
+        summary.cells.resize(cells_.size());
+
+        for (size_t cell = 0; cell < cells_.size(); ++cell)
+        {
+            DepthCell &added = summary.cells[cell];
+            added = cells_[cell];
+            added.min = added.valid > 0 ? added.min : 0.0f;
+            added.mean = added.valid > 0 ? float(sums_[cell] / added.valid)
+                : 0.0f;
+        }
+
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void DepthSummarizer::build_tables(DepthUnit const unit)
+    {
+        size_t const values = depth_values(unit);
+        float const scale = options_.bins / (options_.max - options_.min);
+        unit_ = unit;
+        metres_.resize(values);
+        bins_.resize(values);
+
+        for (size_t value = 0; value < values; ++value)
+        {
+            float const metres = depth_to_metres(unit, uint16_t(value));
+            bool const is_binned = metres > 0.0f && metres >= options_.min
+                && metres <= options_.max;
+            metres_[value] = metres > 0.0f ? metres : 0.0f;
+            bins_[value] = is_binned ? uint16_t(std::min<size_t>(
+                        size_t((metres - options_.min) * scale),
+                        options_.bins - 1)) : NO_BIN;
+        }
+    }
+}
+
+
+namespace
+{
+    void count_values(uint16_t const *const row, size_t const count,
+            uint16_t const last, uint32_t *const counts)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            ++counts[std::min(row[i], last)];
+        }
+    }
+
+    // Adds a run of pixels to the cell they are in and counts their
+    // values. Invalid values are 0 metres, so they add nothing to the sum.
+    void add_pixels(uint16_t const *const row, size_t const count,
+            uint16_t const last, float const *const metres,
+            uint32_t *const counts, kinect::DepthCell &cell, double &sum)
+    {
+        float const none = std::numeric_limits<float>::infinity();
+        uint32_t valid = 0;
+        float min = cell.min;
+        float max = cell.max;
+        float run_sum = 0.0f;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint16_t const value = std::min(row[i], last);
+            float const m = metres[value];
+            bool const is_valid = m > 0.0f;
+            ++counts[value];
+            valid += is_valid;
+            min = std::min(min, is_valid ? m : none);
+            max = std::max(max, m);
+            run_sum += m;
+        }
+
+        cell.valid += valid;
+        cell.min = min;
+        cell.max = max;
+        sum += run_sum;
+    }
+
+    void add_counts(uint32_t const *const counts, float const *const metres,
+            uint16_t const *const bins, size_t const values,
+            kinect::DepthCell &cell, double &sum, uint32_t *const histogram)
+    {
+        for (size_t value = 0; value < values; ++value)
+        {
+            uint32_t const count = counts[value];
+
+            if (count == 0 || !(metres[value] > 0.0f))
+            {
+                continue;
+            }
+
+            float const m = metres[value];
+            cell.min = cell.valid == 0 ? m : std::min(cell.min, m);
+            cell.max = std::max(cell.max, m);
+            cell.valid += count;
+            sum += double(count) * m;
+
+            if (bins[value] != NO_BIN)
+            {
+                histogram[bins[value]] += count;
+            }
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef DEPTH_SUMMARY_H
+#define DEPTH_SUMMARY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <uv.h>
+
+#include "depth.h"
+
+
+namespace kinect
+{
+    struct DepthSummaryOptions
+    {
+        // Histogram of the valid depths within [min, max] metres
+        size_t bins;
+        float min;
+        float max;
+
+        // Grid of cells also summarised on their own, 1 x 1 for none
+        size_t columns;
+        size_t rows;
+    };
+
+    // Of the valid pixels, in metres, 0 when there are none
+    struct DepthCell
+    {
+        uint32_t valid;
+        float min;
+        float max;
+        float mean;
+    };
+
+    struct DepthSummary
+    {
+        uint32_t timestamp;
+        DepthCell frame;
+
+        // Row by row, empty for a 1 x 1 grid
+        std::vector<DepthCell> cells;
+        std::vector<uint32_t> histogram;
+    };
+
+    // Summarises depth frames on one worker thread at a time. One pass
+    // adds each pixel to the statistics of its cell and counts the pixels
+    // of each depth value in the frame, and the histogram follows from the
+    // counts. The options are set from the loop thread.
+    class DepthSummarizer
+    {
+        public:
+            static size_t const MAX_BINS = 1024;
+            static size_t const MAX_CELLS = 16;  // Along each side
+            static DepthSummaryOptions default_options();
+
+            DepthSummarizer();
+            ~DepthSummarizer();
+            bool is_enabled() const;
+
+            void set_options(DepthSummaryOptions const &options);
+            void disable();
+
+            // Worker thread
+            void summarize(DepthUnit unit, uint8_t const *depth,
+                    size_t width, size_t height, uint32_t timestamp,
+                    DepthSummary &summary);
+
+        private:
+            DepthSummarizer(DepthSummarizer const &that) = delete;
+            void build_tables(DepthUnit unit);
+
+            std::atomic<bool> is_enabled_;
+
+            // Shared, under mutex_
+            uv_mutex_t mutex_;
+            DepthSummaryOptions options_;
+            bool is_reset_;
+
+            // Worker thread, under mutex_. The metres, 0 when invalid, and
+            // histogram bin of each depth value, the pixels of each value
+            // in the frame, and the statistics and sum of each cell.
+            DepthUnit unit_;
+            std::vector<float> metres_;
+            std::vector<uint16_t> bins_;
+            std::vector<uint32_t> counts_;
+            std::vector<DepthCell> cells_;
+            std::vector<double> sums_;
+    };
+}
+
+
+#endif  // DEPTH_SUMMARY_H
@@ -0,0 +1,2559 @@
+#include <cstring>
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include <libfreenect.hpp>
+
+#include "context.h"
+#include "device.h"
+#include "frame_mode.h"
+#include "util.h"
+
+
+using namespace node;
+using namespace v8;
+
+
+namespace
+{
+    Handle<Object> stats_to_object(kinect::FrameStats const &stats);
+    Handle<Object> latency_to_object(kinect::LatencyHistogram const &);
+    void record_callback(kinect::StreamLatency &, uint64_t, uint64_t);
+    Handle<Object> recording_stats_to_object(kinect::Recorder const &,
+            kinect::capture::Stream);
+    bool get_synthetic_options(Local<Object>, kinect::Synthetic::Options &);
+    bool get_option(Local<Object>, char const *, int32_t &);
+    bool get_level(Local<Object>, size_t &, kinect::DepthDecimation &);
+    bool get_video_encoding(Local<Object>, kinect::VideoEncoding &,
+            size_t &);
+    bool get_depth_filter_options(Local<Object>,
+            kinect::DepthFilterOptions &);
+    bool get_background_options(Local<Object>, kinect::BackgroundOptions &);
+    bool get_depth_summary_options(Local<Object>,
+            kinect::DepthSummaryOptions &);
+    Local<Object> depth_cell_object(kinect::DepthCell const &);
+
+    void video_callback(freenect_device *, void *, uint32_t);
+    void async_video_callback(uv_async_t *, int);
+
+    void depth_callback(freenect_device *, void *, uint32_t);
+    void async_depth_callback(uv_async_t *, int);
+
+    kinect::Device *get_kinect_device(uv_async_t *);
+    kinect::Device *get_kinect_device(freenect_device *);
+}
+
+
+namespace kinect
+{
+    Persistent<FunctionTemplate> Device::constructor_template_;
+
+    Handle<Value> Device::New(Arguments const &args)
+    {
+        assert(args.IsConstructCall());
+        HandleScope scope;
+        Device *const device = new Device();
+        device->Wrap(args.This());
+        return scope.Close(args.This());
+    }
+
+    Local<Object> Device::NewInstance()
+    {
+        HandleScope scope;
+        return scope.Close(
+                constructor_template_->GetFunction()->NewInstance());
+    }
+
+    Device::Device() : ObjectWrap(), packs_foreground_(false),
+            async_handles_(async_depth_callback, async_video_callback),
+            demosaic_time_(0), video_view_(false),
+            depth_view_(true), device_(nullptr), receiver_(nullptr),
+            is_processing_(false),
+            held_jobs_(0)
+    {
+        demosaic_.set_owner(this);
+        depth_encoder_.set_owner(this);
+        depth_processor_.set_owner(this);
+        video_encoder_.set_owner(this);
+        world_.set_owner(this);
+    }
+
+    Device::~Device()
+    {
+        // Held while a job points into the device
+        assert(held_jobs_ == 0);
+    }
+
+    void Device::set_receiver(ObjectWrap *const receiver)
+    {
+        receiver_ = receiver;
+    }
+
+    Handle<Object> Device::receiver() const
+    {
+        return receiver_ != nullptr ? receiver_->handle_ : handle_;
+    }
+
+    void Device::hold()
+    {
+        if (held_jobs_++ == 0)
+        {
+            Ref();
+        }
+    }
+
+    void Device::release()
+    {
+        assert(held_jobs_ > 0);
+
+        if (--held_jobs_ == 0)
+        {
+            Unref();
+        }
+    }
+
+    // Reads the device index and the mode options of enable() and
+    // openDevice(), throwing if they are invalid.
+    bool Device::configure(Arguments const &args, int &index)
+    {
+        int const argc = args.Length();
+        index = 0;
+
+        if (argc > 2)
+        {
+            throw_error("Excepted up to 2 arguments");
+            return false;
+        }
+
+        if (argc >= 1)
+        {
+            if (!args[0]->IsInt32())
+            {
+                throw_error("userDeviceNumber must be an integer");
+                return false;
+            }
+
+            index = args[0]->ToInt32()->Value();
+        }
+
+        // Modes
+        int32_t video_format = FREENECT_VIDEO_RGB;
+        int32_t video_resolution = FREENECT_RESOLUTION_MEDIUM;
+        int32_t depth_format = FREENECT_DEPTH_11BIT;
+        int32_t depth_resolution = FREENECT_RESOLUTION_MEDIUM;
+
+        if (argc == 2)
+        {
+            if (!args[1]->IsObject())
+            {
+                throw_error("options must be an object");
+                return false;
+            }
+
+            Local<Object> const options = args[1]->ToObject();
+
+            if (!get_option(options, "videoFormat", video_format)
+                    || !get_option(options, "videoResolution", video_resolution)
+                    || !get_option(options, "depthFormat", depth_format)
+                    || !get_option(options, "depthResolution",
+                                   depth_resolution))
+            {
+                throw_error("Expected the mode options to be integers");
+                return false;
+            }
+        }
+
+        video_mode_ = freenect_find_video_mode(
+                (freenect_resolution) video_resolution,
+                (freenect_video_format) video_format);
+
+        if (!video_mode_.is_valid)
+        {
+            throw_error("Unsupported video format and resolution");
+            return false;
+        }
+
+        depth_mode_ = freenect_find_depth_mode(
+                (freenect_resolution) depth_resolution,
+                (freenect_depth_format) depth_format);
+
+        if (!depth_mode_.is_valid)
+        {
+            throw_error("Unsupported depth format and resolution");
+            return false;
+        }
+
+        world_.set_modes(depth_mode_, video_output_mode());
+        return true;
+    }
+
+    bool Device::open(freenect_context *const context, int const index)
+    {
+        if (is_open())
+        {
+            throw_error("Device already open");
+            return false;
+        }
+
+        if (freenect_open_device(context, &device_, index) < 0)
+        {
+            device_ = nullptr;
+            throw_error("Could not open device number");
+            return false;
+        }
+
+        freenect_set_user(device_, this);
+        return enable_async_handles();
+    }
+
+    // Plays a recording back in place of a Kinect. Takes the path and an
+    // optional {speed, loop} object.
+    bool Device::open_replay(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !args[0]->IsString()
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected a path and an optional options object");
+            return false;
+        }
+
+        if (is_open())
+        {
+            throw_error("Device already open");
+            return false;
+        }
+
+        double speed = 1;
+        bool is_looping = false;
+
+        if (argc == 2)
+        {
+            Local<Object> const options = args[1]->ToObject();
+            Handle<String> const speed_name = String::NewSymbol("speed");
+            Handle<String> const loop_name = String::NewSymbol("loop");
+
+            if (options->Has(speed_name))
+            {
+                Local<Value> const value = options->Get(speed_name);
+
+                if (!value->IsNumber() || !(value->NumberValue() >= 0))
+                {
+                    throw_error("Expected speed to be a number >= 0");
+                    return false;
+                }
+
+                speed = value->NumberValue();
+            }
+
+            is_looping = options->Get(loop_name)->BooleanValue();
+        }
+
+        String::Utf8Value const path(args[0]);
+        std::unique_ptr<Replay> replay(new Replay());
+
+        if (!replay->open(*path))
+        {
+            throw_error(replay->error().c_str());
+            return false;
+        }
+
+        replay->set_speed(speed);
+        replay->set_loop(is_looping);
+        return open_source(std::move(replay));
+    }
+
+    // Generates frames in place of a Kinect. Takes an optional options
+    // object.
+    bool Device::open_synthetic(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc > 1 || (argc == 1 && !args[0]->IsObject()))
+        {
+            throw_error("Expected an optional options object");
+            return false;
+        }
+
+        if (is_open())
+        {
+            throw_error("Device already open");
+            return false;
+        }
+
+        Synthetic::Options options = Synthetic::default_options();
+
+        if (argc == 1 && !get_synthetic_options(args[0]->ToObject(), options))
+        {
+            return false;
+        }
+
+        return open_source(std::unique_ptr<FrameSource>(
+                    new Synthetic(options)));
+    }
+
+    bool Device::open_source(std::unique_ptr<FrameSource> source)
+    {
+        source_ = std::move(source);
+        depth_mode_ = source_->depth_mode();
+        video_mode_ = source_->video_mode();
+        world_.set_modes(depth_mode_, video_output_mode());
+        return enable_async_handles();
+    }
+
+    bool Device::enable_async_handles()
+    {
+        // LibUV stuff
+        if (!async_handles_.enable())
+        {
+            throw_error("Could not enable async handles");
+            return false;
+        }
+
+        async_handles_.set_depth_data(this);
+        async_handles_.set_video_data(this);
+        return true;
+    }
+
+    // Returns false if the recording could not be finished or libfreenect
+    // could not close the device. The device is forgotten either way.
+    bool Device::close()
+    {
+        if (!is_open())
+        {
+            return true;
+        }
+
+        if (depth_buffers_.is_allocated())
+        {
+            StopDepth();
+        }
+
+        if (video_buffers_.is_allocated())
+        {
+            StopVideo();
+        }
+
+        source_.reset();
+
+        bool const is_finished = recorder_.stop();
+        bool is_closed = true;
+
+        if (device_ != nullptr)
+        {
+            is_closed = freenect_close_device(device_) == 0;
+            device_ = nullptr;
+        }
+
+        async_handles_.disable();
+        return is_finished && is_closed;
+    }
+
+    bool Device::is_open() const
+    {
+        return device_ != nullptr || source_ != nullptr;
+    }
+
+    // A replay or synthetic source runs while the context processes
+    // events, as frames from a Kinect would.
+    void Device::start_source()
+    {
+        is_processing_ = true;
+
+        if (source_ == nullptr)
+        {
+            return;
+        }
+
+        source_->start([this](capture::Stream const stream,
+                    uint8_t const *const frame, size_t const bytes,
+                    uint32_t const timestamp)
+                {
+                    source_frame(stream, frame, bytes, timestamp);
+                });
+    }
+
+    void Device::stop_source()
+    {
+        is_processing_ = false;
+
+        if (source_ != nullptr)
+        {
+            source_->stop();
+        }
+    }
+
+    // Source thread
+    void Device::source_frame(capture::Stream const stream,
+            uint8_t const *const frame, size_t const bytes,
+            uint32_t const timestamp)
+    {
+        if (stream == capture::Stream::DEPTH)
+        {
+            memcpy(depth_buffers_.ring().write_slot(), frame, bytes);
+            publish_depth(frame, timestamp);
+        }
+        else
+        {
+            memcpy(video_buffers_.ring().write_slot(), frame, bytes);
+            publish_video(frame, timestamp);
+        }
+    }
+
+    Handle<Value> Device::call_close(Arguments const &args)
+    {
+        HandleScope scope;
+        Device *const device = GetDevice(args);
+
+        // The event thread may be using the freenect context.
+        if (device->is_processing_)
+        {
+            throw_error("Cannot close a device while processing events");
+            return scope.Close(Undefined());
+        }
+
+        if (!device->close())
+        {
+            throw_error("Could not close device");
+        }
+
+        return scope.Close(Undefined());
+    }
+
+
+    // =====================================================================
+    // = World frame                                                       =
+    // =====================================================================
+
+    Handle<Value> Device::call_set_world_callback(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.set_callback(args);
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_unset_world_callback(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.unset_callback();
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_set_point_cloud_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.set_point_callback(args);
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_unset_point_cloud_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.unset_point_callback();
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_set_world_threads(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.set_threads(args);
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_set_world_sync_tolerance(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.set_sync_tolerance(args);
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_set_calibration(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.set_calibration(args);
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_load_calibration(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.load_calibration(args);
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_get_calibration(Arguments const &args)
+    {
+        HandleScope scope;
+        return scope.Close(GetDevice(args)->world_.get_calibration());
+    }
+
+    Handle<Value> Device::call_set_world_kernel(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.set_kernel(args);
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_get_world_kernel(Arguments const &args)
+    {
+        HandleScope scope;
+        return scope.Close(GetDevice(args)->world_.get_kernel());
+    }
+
+    Handle<Value> Device::call_set_world_foreground(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->world_.set_foreground(args);
+        return scope.Close(Undefined());
+    }
+
+
+    // =====================================================================
+    // = Depth range and region of interest                                =
+    // =====================================================================
+
+    Handle<Value> Device::call_set_depth_range(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->set_depth_range(args);
+        return scope.Close(Undefined());
+    }
+
+    void Device::set_depth_range(Arguments const &args)
+    {
+        if (args.Length() != 2 || !args[0]->IsNumber()
+                || !args[1]->IsNumber())
+        {
+            throw_error("Expected 2 numbers as arguments");
+            return;
+        }
+
+        double const min = args[0]->NumberValue();
+        double const max = args[1]->NumberValue();
+
+        if (!(min >= 0 && min < max))
+        {
+            throw_error("Expected 0 <= min < max");
+            return;
+        }
+
+        depth_view_.set_depth_range(min, max);
+        world_.set_depth_range(min, max);
+    }
+
+    Handle<Value> Device::call_clear_depth_range(Arguments const &args)
+    {
+        HandleScope scope;
+        Device *const device = GetDevice(args);
+        device->depth_view_.clear_depth_range();
+        device->world_.clear_depth_range();
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_set_region_of_interest(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->set_region_of_interest(args);
+        return scope.Close(Undefined());
+    }
+
+    void Device::set_region_of_interest(Arguments const &args)
+    {
+        if (args.Length() != 4 || !args[0]->IsUint32() || !args[1]->IsUint32()
+                || !args[2]->IsUint32() || !args[3]->IsUint32())
+        {
+            throw_error("Expected 4 unsigned integers as arguments");
+            return;
+        }
+
+        Region const region = {
+            args[0]->Uint32Value(),
+            args[1]->Uint32Value(),
+            args[2]->Uint32Value(),
+            args[3]->Uint32Value()
+        };
+
+        if (!world_.is_region_valid(region))
+        {
+            throw_error("Region of interest outside the frame");
+            return;
+        }
+
+        // The region is in depth pixels, and scaled to the video frame,
+        // which may be of another size.
+        video_view_.set_region(region, depth_mode_.width, depth_mode_.height);
+        depth_view_.set_region(region, depth_mode_.width, depth_mode_.height);
+        world_.set_region(region);
+    }
+
+    Handle<Value> Device::call_clear_region_of_interest(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        Device *const device = GetDevice(args);
+        device->video_view_.clear_region();
+        device->depth_view_.clear_region();
+        device->world_.clear_region();
+        return scope.Close(Undefined());
+    }
+
+    // =====================================================================
+    // = Video                                                             =
+    // =====================================================================
+
+    // = Start =============================================================
+
+    Handle<Value> Device::StartVideo(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->StartVideo();
+        return scope.Close(Undefined());
+    }
+
+    void Device::StartVideo()
+    {
+        if (!is_open())
+        {
+            throw_error("Device not open");
+            return;
+        }
+
+        if (source_ != nullptr)
+        {
+            video_buffers_.allocate(video_mode_.bytes);
+            video_view_.set_mode(video_output_mode());
+            source_->set_enabled(capture::Stream::VIDEO, true);
+            return;
+        }
+
+        freenect_set_video_callback(device_, video_callback);
+
+        if (freenect_set_video_mode(device_, video_mode_) != 0)
+        {
+            throw_error("Could not set video mode");
+            return;
+        }
+
+        video_buffers_.allocate(video_mode_.bytes);
+        video_view_.set_mode(video_output_mode());
+
+        if (freenect_set_video_buffer(device_,
+                video_buffers_.ring().write_slot()) != 0)
+        {
+            throw_error("Could not set video buffer");
+            return;
+        }
+
+        if (freenect_start_video(device_) != 0)
+        {
+            throw_error("Could not start video");
+            return;
+        }
+    }
+
+
+    // = Stop ==============================================================
+
+    Handle<Value> Device::StopVideo(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->StopVideo();
+        return scope.Close(Undefined());
+    }
+
+    void Device::StopVideo()
+    {
+        if (!is_open())
+        {
+            throw_error("Device not open");
+            return;
+        }
+
+        if (source_ != nullptr)
+        {
+            source_->set_enabled(capture::Stream::VIDEO, false);
+            video_buffers_.release();
+            return;
+        }
+
+        freenect_stop_video(device_);
+        freenect_set_video_buffer(device_, nullptr);
+        video_buffers_.release();
+        freenect_set_video_callback(device_, nullptr);
+    }
+
+    // Event or replay thread. Returns the slot for the next frame.
+    uint8_t *Device::publish_video(void const *const frame,
+            uint32_t const timestamp)
+    {
+        uint64_t const time = uv_hrtime();
+        recorder_.push(capture::Stream::VIDEO, frame, video_mode_.bytes,
+                timestamp);
+
+        bool dropped;
+        uint8_t *const slot = video_buffers_.ring().publish(timestamp, time,
+                dropped);
+        video_stats_.count_produced(timestamp, dropped);
+        async_handles_.send_video();
+        return slot;
+    }
+
+
+    // = Callback ==========================================================
+
+    Handle<Value> Device::CallSetVideoCallback(Arguments const& args)
+    {
+        HandleScope scope;
+        GetDevice(args)->SetVideoCallback(args);
+        return scope.Close(Undefined());
+    }
+
+    void Device::SetVideoCallback(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !args[0]->IsFunction()
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected 1 function and an optional options object");
+            return;
+        }
+
+        size_t level = 0;
+        DepthDecimation decimation = DepthDecimation::NEAREST;
+
+        if (argc == 2 && !get_level(args[1]->ToObject(), level, decimation))
+        {
+            return;
+        }
+
+        video_view_.set_level(level, decimation);
+
+        video_callback_ = Persistent<Function>::New(
+                Local<Function>::Cast(args[0]));
+    }
+
+    Handle<Value> Device::CallUnsetVideoCallback(Arguments const& args)
+    {
+        HandleScope scope;
+        GetDevice(args)->UnsetVideoCallback();
+        return scope.Close(Undefined());
+    }
+
+    void Device::UnsetVideoCallback()
+    {
+        video_callback_.Dispose();
+        video_callback_.Clear();
+    }
+
+    void Device::VideoCallback()
+    {
+        uint64_t const entry = uv_hrtime();
+        video_stats_.count_signal();
+        deliver_video(entry);
+    }
+
+    // entry is when the loop thread got to the frame.
+    void Device::deliver_video(uint64_t const entry)
+    {
+        FrameRing &ring = video_buffers_.ring();
+
+        if (is_demosaicing())
+        {
+            // While the worker is busy the newest frame waits in the ring.
+            if (video_buffers_.is_allocated() && !demosaic_.is_busy()
+                    && ring.acquire())
+            {
+                video_latency_.dispatch.record(entry - ring.read_time());
+                demosaic_time_ = ring.read_time();
+                demosaic_.queue(ring.read_slot(), video_mode_,
+                        ring.read_timestamp(),
+                        [this]() { deliver_demosaiced(); });
+            }
+            return;
+        }
+
+        if (!video_buffers_.is_allocated() || !ring.acquire())
+        {
+            return;
+        }
+
+        video_stats_.count_delivered();
+        video_latency_.dispatch.record(entry - ring.read_time());
+
+        if (!video_callback_.IsEmpty())
+        {
+            unsigned const argc = 1;
+            Handle<Value> argv[1] = { video_view_.view(ring.read_slot(),
+                    video_buffers_.read_handle()) };
+            uint64_t const start = uv_hrtime();
+            video_callback_->Call(receiver(), argc, argv);
+            record_callback(video_latency_, ring.read_time(), start);
+        }
+
+        // The callback may have stopped the stream.
+        if (ring.has_frame())
+        {
+            world_.push_video(ring.read_slot(), ring.read_timestamp());
+            queue_encoded_video(ring.read_slot(), ring.read_timestamp());
+        }
+    }
+
+    void Device::deliver_demosaiced()
+    {
+        HandleScope scope;
+
+        // The stream may have stopped while the worker was busy.
+        if (!video_buffers_.is_allocated())
+        {
+            return;
+        }
+
+        video_stats_.count_delivered();
+
+        if (!video_callback_.IsEmpty())
+        {
+            unsigned const argc = 1;
+            Handle<Value> argv[1] = { video_view_.view(demosaic_.front(),
+                    demosaic_.front_handle()) };
+            uint64_t const start = uv_hrtime();
+            video_callback_->Call(receiver(), argc, argv);
+            record_callback(video_latency_, demosaic_time_, start);
+        }
+
+        world_.push_video(demosaic_.front(), demosaic_.front_timestamp());
+        queue_encoded_video(demosaic_.front(), demosaic_.front_timestamp());
+
+        // A newer frame may have arrived while the worker was busy.
+        deliver_video(uv_hrtime());
+    }
+
+    bool Device::is_demosaicing() const
+    {
+        return video_mode_.video_format == FREENECT_VIDEO_BAYER
+            && demosaic_.is_enabled();
+    }
+
+    freenect_frame_mode Device::video_output_mode() const
+    {
+        return is_demosaicing() ? demosaic_.output_mode(video_mode_)
+            : video_mode_;
+    }
+
+
+    // = Demosaic ==========================================================
+
+    Handle<Value> Device::call_set_demosaic(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->set_demosaic(args);
+        return scope.Close(Undefined());
+    }
+
+    void Device::set_demosaic(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsString())
+        {
+            throw_error("Expected 1 string");
+            return;
+        }
+
+        String::Utf8Value const name(args[0]);
+        Demosaic::Resolution resolution;
+
+        if (strcmp(*name, "off") == 0)
+        {
+            resolution = Demosaic::Resolution::OFF;
+        }
+        else if (strcmp(*name, "full") == 0)
+        {
+            resolution = Demosaic::Resolution::FULL;
+        }
+        else if (strcmp(*name, "half") == 0)
+        {
+            resolution = Demosaic::Resolution::HALF;
+        }
+        else
+        {
+            throw_error("Expected 'off', 'full' or 'half'");
+            return;
+        }
+
+        demosaic_.set_resolution(resolution);
+
+        if (is_open())
+        {
+            video_view_.set_mode(video_output_mode());
+            world_.set_modes(depth_mode_, video_output_mode());
+        }
+    }
+
+
+    // = Encoded ===========================================================
+
+    Handle<Value> Device::call_set_encoded_video_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->set_encoded_video_callback(args);
+        return scope.Close(Undefined());
+    }
+
+    // Takes a function and an optional object of the format, quality,
+    // subsampling and workers.
+    void Device::set_encoded_video_callback(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !args[0]->IsFunction()
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected 1 function and an optional options object");
+            return;
+        }
+
+        VideoEncoding encoding = { VideoCodec::JPEG, 80,
+            ChromaSubsampling::BOTH };
+        size_t workers = 2;
+
+        if (argc == 2
+                && !get_video_encoding(args[1]->ToObject(), encoding, workers))
+        {
+            return;
+        }
+
+        if (is_open() && video_output_mode().video_format != FREENECT_VIDEO_RGB)
+        {
+            throw_error("Encoded video needs RGB or demosaiced Bayer video");
+            return;
+        }
+
+        video_encoder_.set_encoding(encoding, workers);
+
+        encoded_video_callback_.Dispose();
+        encoded_video_callback_ = Persistent<Function>::New(
+                Local<Function>::Cast(args[0]));
+    }
+
+    Handle<Value> Device::call_unset_encoded_video_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        Device *const device = GetDevice(args);
+        device->encoded_video_callback_.Dispose();
+        device->encoded_video_callback_.Clear();
+        return scope.Close(Undefined());
+    }
+
+    // Encodes the RGB frame just delivered on a free worker, skipping it
+    // while every worker is busy.
+    void Device::queue_encoded_video(uint8_t const *const frame,
+            uint32_t const timestamp)
+    {
+        freenect_frame_mode const mode = video_output_mode();
+
+        if (encoded_video_callback_.IsEmpty()
+                || mode.video_format != FREENECT_VIDEO_RGB)
+        {
+            return;
+        }
+
+        video_encoder_.queue(frame, mode, timestamp,
+                [this](size_t worker) { deliver_encoded_video(worker); });
+    }
+
+    void Device::deliver_encoded_video(size_t const worker)
+    {
+        HandleScope scope;
+
+        // The callback may have been unset while the worker was busy.
+        if (!encoded_video_callback_.IsEmpty())
+        {
+            unsigned const argc = 1;
+            Handle<Value> argv[1] = { video_encoder_.encoded(worker) };
+            encoded_video_callback_->Call(receiver(), argc, argv);
+        }
+    }
+
+
+    // =====================================================================
+    // = Depth                                                             =
+    // =====================================================================
+
+    // = Start =============================================================
+
+    Handle<Value> Device::StartDepth(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->StartDepth();
+        return scope.Close(Undefined());
+    }
+
+    void Device::StartDepth()
+    {
+        if (!is_open())
+        {
+            throw_error("Device not open");
+            return;
+        }
+
+        if (source_ != nullptr)
+        {
+            depth_buffers_.allocate(depth_mode_.bytes);
+            depth_view_.set_mode(depth_mode_);
+            source_->set_enabled(capture::Stream::DEPTH, true);
+            return;
+        }
+
+        freenect_set_depth_callback(device_, depth_callback);
+
+        if (freenect_set_depth_mode(device_, depth_mode_) != 0)
+        {
+            throw_error("Could not set depth mode");
+            return;
+        }
+
+        depth_buffers_.allocate(depth_mode_.bytes);
+        depth_view_.set_mode(depth_mode_);
+
+        if (freenect_set_depth_buffer(device_,
+                depth_buffers_.ring().write_slot()) != 0)
+        {
+            throw_error("Could not set depth buffer");
+            return;
+        }
+
+        if (freenect_start_depth(device_) != 0)
+        {
+            throw_error("Could not start depth");
+            return;
+        }
+    }
+
+
+    // = Stop ==============================================================
+
+    Handle<Value> Device::StopDepth(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->StopDepth();
+        return scope.Close(Undefined());
+    }
+
+    void Device::StopDepth()
+    {
+        if (!is_open())
+        {
+            throw_error("Device not open");
+            return;
+        }
+
+        if (source_ != nullptr)
+        {
+            source_->set_enabled(capture::Stream::DEPTH, false);
+            depth_buffers_.release();
+            depth_processor_.reset();
+            return;
+        }
+
+        freenect_stop_depth(device_);
+        freenect_set_depth_buffer(device_, nullptr);
+        depth_buffers_.release();
+        depth_processor_.reset();
+        freenect_set_depth_callback(device_, nullptr);
+    }
+
+    // Event or replay thread. Returns the slot for the next frame.
+    uint8_t *Device::publish_depth(void const *const frame,
+            uint32_t const timestamp)
+    {
+        uint64_t const time = uv_hrtime();
+        recorder_.push(capture::Stream::DEPTH, frame, depth_mode_.bytes,
+                timestamp);
+
+        bool dropped;
+        uint8_t *const slot = depth_buffers_.ring().publish(timestamp, time,
+                dropped);
+        depth_stats_.count_produced(timestamp, dropped);
+        async_handles_.send_depth();
+        return slot;
+    }
+
+
+    // = Callback ==========================================================
+
+    Handle<Value> Device::CallSetDepthCallback(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->SetDepthCallback(args);
+        return Undefined();
+    }
+
+    void Device::SetDepthCallback(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !args[0]->IsFunction()
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected 1 function and an optional options object");
+            return;
+        }
+
+        size_t level = 0;
+        DepthDecimation decimation = DepthDecimation::NEAREST;
+
+        if (argc == 2 && !get_level(args[1]->ToObject(), level, decimation))
+        {
+            return;
+        }
+
+        depth_view_.set_level(level, decimation);
+
+        depth_callback_ = Persistent<Function>::New(
+                Local<Function>::Cast(args[0]));
+    }
+
+    Handle<Value> Device::CallUnsetDepthCallback(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->UnsetDepthCallback();
+        return scope.Close(Undefined());
+    }
+
+    void Device::UnsetDepthCallback()
+    {
+        depth_callback_.Dispose();
+        depth_callback_.Clear();
+    }
+
+    void Device::DepthCallback()
+    {
+        uint64_t const entry = uv_hrtime();
+        depth_stats_.count_signal();
+        deliver_depth(entry);
+    }
+
+    // entry is when the loop thread got to the frame.
+    void Device::deliver_depth(uint64_t const entry)
+    {
+        FrameRing &ring = depth_buffers_.ring();
+        DepthUnit unit;
+
+        if (depth_processor_.is_enabled() && find_depth_unit(depth_mode_, unit))
+        {
+            // While the worker is busy the newest frame waits in the ring.
+            if (depth_buffers_.is_allocated() && !depth_processor_.is_busy()
+                    && ring.acquire())
+            {
+                depth_latency_.dispatch.record(entry - ring.read_time());
+                depth_processor_.queue(unit, ring.read_slot(), depth_mode_,
+                        ring.read_timestamp(), ring.read_time(),
+                        [this]() { deliver_processed_depth(); });
+            }
+            return;
+        }
+
+        if (!depth_buffers_.is_allocated() || !ring.acquire())
+        {
+            return;
+        }
+
+        depth_stats_.count_delivered();
+        depth_latency_.dispatch.record(entry - ring.read_time());
+        deliver_depth_frame(ring.read_slot(), depth_buffers_.read_handle(),
+                ring.read_timestamp(), ring.read_time(), nullptr, nullptr);
+    }
+
+    void Device::deliver_processed_depth()
+    {
+        HandleScope scope;
+
+        // The stream may have stopped while the worker was busy.
+        if (!depth_buffers_.is_allocated())
+        {
+            return;
+        }
+
+        depth_stats_.count_delivered();
+        deliver_depth_frame(depth_processor_.front(),
+                depth_processor_.front_handle(),
+                depth_processor_.front_timestamp(),
+                depth_processor_.front_time(),
+                depth_processor_.front_foreground(),
+                depth_processor_.front_summary());
+
+        // A newer frame may have arrived while the worker was busy.
+        deliver_depth(uv_hrtime());
+    }
+
+    // Hands a frame, published at time, to the depth callback and then to
+    // the world frame, the encoder and the foreground and summary
+    // callbacks.
+    void Device::deliver_depth_frame(uint8_t const *const depth,
+            Handle<Value> const handle, uint32_t const timestamp,
+            uint64_t const time, uint8_t const *const foreground,
+            DepthSummary const *const summary)
+    {
+        if (!depth_callback_.IsEmpty())
+        {
+            unsigned const argc = 1;
+            Handle<Value> argv[1] = { depth_view_.view(depth, handle) };
+            uint64_t const start = uv_hrtime();
+            depth_callback_->Call(receiver(), argc, argv);
+            record_callback(depth_latency_, time, start);
+        }
+
+        // The callback may have stopped the stream.
+        if (depth_buffers_.ring().has_frame())
+        {
+            world_.push_depth(depth, foreground, timestamp, time);
+            queue_compressed_depth(depth, timestamp);
+            deliver_foreground(foreground);
+            deliver_depth_summary(summary);
+        }
+    }
+
+
+    // = Compressed ========================================================
+
+    Handle<Value> Device::call_set_compressed_depth_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->set_compressed_depth_callback(args);
+        return scope.Close(Undefined());
+    }
+
+    void Device::set_compressed_depth_callback(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsFunction())
+        {
+            throw_error("Expected 1 function");
+            return;
+        }
+
+        DepthUnit unit;
+
+        if (is_open() && !find_depth_unit(depth_mode_, unit))
+        {
+            throw_error("Compressed depth needs 11-bit, millimetre or "
+                    "registered depth");
+            return;
+        }
+
+        compressed_depth_callback_.Dispose();
+        compressed_depth_callback_ = Persistent<Function>::New(
+                Local<Function>::Cast(args[0]));
+    }
+
+    Handle<Value> Device::call_unset_compressed_depth_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        Device *const device = GetDevice(args);
+        device->compressed_depth_callback_.Dispose();
+        device->compressed_depth_callback_.Clear();
+        return scope.Close(Undefined());
+    }
+
+    // Encodes the frame just delivered on the worker, skipping it while
+    // the worker is still busy with an earlier one.
+    void Device::queue_compressed_depth(uint8_t const *const depth,
+            uint32_t const timestamp)
+    {
+        DepthUnit unit;
+
+        if (compressed_depth_callback_.IsEmpty() || depth_encoder_.is_busy()
+                || !find_depth_unit(depth_mode_, unit))
+        {
+            return;
+        }
+
+        depth_encoder_.queue(depth, depth_mode_, unit, timestamp,
+                [this]() { deliver_compressed_depth(); });
+    }
+
+    void Device::deliver_compressed_depth()
+    {
+        HandleScope scope;
+
+        // The callback may have been unset while the worker was busy.
+        if (!compressed_depth_callback_.IsEmpty())
+        {
+            unsigned const argc = 1;
+            Handle<Value> argv[1] = { depth_encoder_.encoded() };
+            compressed_depth_callback_->Call(receiver(), argc, argv);
+        }
+    }
+
+
+    // = Filter ============================================================
+
+    Handle<Value> Device::call_set_depth_filter(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->set_depth_filter(args);
+        return scope.Close(Undefined());
+    }
+
+    // Takes an optional object of the filter options over the defaults.
+    void Device::set_depth_filter(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc > 1 || (argc == 1 && !args[0]->IsObject()))
+        {
+            throw_error("Expected an optional options object");
+            return;
+        }
+
+        DepthFilterOptions options = DepthFilter::default_options();
+
+        if (argc == 1
+                && !get_depth_filter_options(args[0]->ToObject(), options))
+        {
+            return;
+        }
+
+        DepthUnit unit;
+
+        if (is_open() && !find_depth_unit(depth_mode_, unit))
+        {
+            throw_error("Depth filtering needs 11-bit, millimetre or "
+                    "registered depth");
+            return;
+        }
+
+        depth_processor_.filter().set_options(options);
+    }
+
+    Handle<Value> Device::call_clear_depth_filter(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->depth_processor_.filter().disable();
+        return scope.Close(Undefined());
+    }
+
+
+    // = Summary ===========================================================
+
+    Handle<Value> Device::call_set_depth_summary_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->set_depth_summary_callback(args);
+        return scope.Close(Undefined());
+    }
+
+    // Takes a function and an optional object of the histogram and grid
+    // over the defaults.
+    void Device::set_depth_summary_callback(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !args[0]->IsFunction()
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected 1 function and an optional options object");
+            return;
+        }
+
+        DepthSummaryOptions options = DepthSummarizer::default_options();
+
+        if (argc == 2
+                && !get_depth_summary_options(args[1]->ToObject(), options))
+        {
+            return;
+        }
+
+        DepthUnit unit;
+
+        if (is_open() && !find_depth_unit(depth_mode_, unit))
+        {
+            throw_error("Only 11-bit, millimetre or registered depth can be "
+                    "summarised");
+            return;
+        }
+
+        depth_summary_callback_.Dispose();
+        depth_summary_callback_ = Persistent<Function>::New(
+                Local<Function>::Cast(args[0]));
+        depth_processor_.summarizer().set_options(options);
+    }
+
+    Handle<Value> Device::call_unset_depth_summary_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        Device *const device = GetDevice(args);
+        device->depth_processor_.summarizer().disable();
+        device->depth_summary_callback_.Dispose();
+        device->depth_summary_callback_.Clear();
+        return scope.Close(Undefined());
+    }
+
+    void Device::deliver_depth_summary(DepthSummary const *const summary)
+    {
+        if (depth_summary_callback_.IsEmpty() || summary == nullptr)
+        {
+            return;
+        }
+
+        Local<Object> const object = depth_cell_object(summary->frame);
+        object->Set(String::NewSymbol("timestamp"),
+                Number::New(summary->timestamp));
+
+        Local<Array> const histogram = Array::New(summary->histogram.size());
+
+        for (size_t i = 0; i < summary->histogram.size(); ++i)
+        {
+            histogram->Set(i, Number::New(summary->histogram[i]));
+        }
+
+        object->Set(String::NewSymbol("histogram"), histogram);
+
+        if (!summary->cells.empty())
+        {
+            Local<Array> const cells = Array::New(summary->cells.size());
+
+            for (size_t i = 0; i < summary->cells.size(); ++i)
+            {
+                cells->Set(i, depth_cell_object(summary->cells[i]));
+            }
+
+            object->Set(String::NewSymbol("cells"), cells);
+        }
+
+        unsigned const argc = 1;
+        Handle<Value> argv[1] = { object };
+        depth_summary_callback_->Call(receiver(), argc, argv);
+    }
+
+
+    // =====================================================================
+    // = Background                                                        =
+    // =====================================================================
+
+    Handle<Value> Device::call_learn_background(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->learn_background(args);
+        return scope.Close(Undefined());
+    }
+
+    // Takes an optional object of the learning options over the defaults.
+    void Device::learn_background(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc > 1 || (argc == 1 && !args[0]->IsObject()))
+        {
+            throw_error("Expected an optional options object");
+            return;
+        }
+
+        BackgroundOptions options = BackgroundModel::default_options();
+
+        if (argc == 1 && !get_background_options(args[0]->ToObject(), options))
+        {
+            return;
+        }
+
+        DepthUnit unit;
+
+        if (is_open() && !find_depth_unit(depth_mode_, unit))
+        {
+            throw_error("The background model needs 11-bit, millimetre or "
+                    "registered depth");
+            return;
+        }
+
+        depth_processor_.background().learn(options);
+    }
+
+    Handle<Value> Device::call_freeze_background(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->depth_processor_.background().freeze();
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_reset_background(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->depth_processor_.background().reset();
+        return scope.Close(Undefined());
+    }
+
+
+    // = Foreground ========================================================
+
+    Handle<Value> Device::call_set_foreground_callback(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->set_foreground_callback(args);
+        return scope.Close(Undefined());
+    }
+
+    // Takes a function and an optional object with the bits per pixel of
+    // the mask, 8 by default.
+    void Device::set_foreground_callback(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !args[0]->IsFunction()
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected 1 function and an optional options object");
+            return;
+        }
+
+        int32_t bits = 8;
+
+        if (argc == 2 && (!get_option(args[1]->ToObject(), "bits", bits)
+                    || (bits != 1 && bits != 8)))
+        {
+            throw_error("Expected bits to be 1 or 8");
+            return;
+        }
+
+        packs_foreground_ = bits == 1;
+
+        foreground_callback_.Dispose();
+        foreground_callback_ = Persistent<Function>::New(
+                Local<Function>::Cast(args[0]));
+    }
+
+    Handle<Value> Device::call_unset_foreground_callback(
+            Arguments const &args)
+    {
+        HandleScope scope;
+        Device *const device = GetDevice(args);
+        device->foreground_callback_.Dispose();
+        device->foreground_callback_.Clear();
+        return scope.Close(Undefined());
+    }
+
+    // Hands JS a copy of the mask, as the slot is reused once the next
+    // frame is acquired.
+    void Device::deliver_foreground(uint8_t const *const foreground)
+    {
+        if (foreground_callback_.IsEmpty() || foreground == nullptr)
+        {
+            return;
+        }
+
+        size_t const pixels = depth_mode_.width * depth_mode_.height;
+        Buffer *mask;
+
+        if (packs_foreground_)
+        {
+            mask = Buffer::New((pixels + 7) / 8);
+            pack_mask(foreground, pixels,
+                    reinterpret_cast<uint8_t *>(Buffer::Data(mask)));
+        }
+        else
+        {
+            mask = Buffer::New(reinterpret_cast<char const *>(foreground),
+                    pixels);
+        }
+
+        unsigned const argc = 1;
+        Handle<Value> argv[1] = { mask->handle_ };
+        foreground_callback_->Call(receiver(), argc, argv);
+    }
+
+
+    // =====================================================================
+    // = Stats                                                             =
+    // =====================================================================
+
+    Handle<Value> Device::call_get_stats(Arguments const &args)
+    {
+        HandleScope scope;
+        return scope.Close(GetDevice(args)->get_stats());
+    }
+
+    Handle<Value> Device::get_stats() const
+    {
+        HandleScope scope;
+        Local<Object> stats = Object::New();
+        stats->Set(String::NewSymbol("depth"), stats_to_object(depth_stats_));
+        stats->Set(String::NewSymbol("video"), stats_to_object(video_stats_));
+
+        Local<Object> encoder = Object::New();
+        encoder->Set(String::NewSymbol("encoded"),
+                Number::New(video_encoder_.encoded_frames()));
+        encoder->Set(String::NewSymbol("skipped"),
+                Number::New(video_encoder_.skipped_frames()));
+        stats->Set(String::NewSymbol("videoEncoder"), encoder);
+
+        Local<Object> background = Object::New();
+        background->Set(String::NewSymbol("learning"),
+                Boolean::New(depth_processor_.background().is_learning()));
+        background->Set(String::NewSymbol("frames"),
+                Number::New(depth_processor_.background().learned_frames()));
+        stats->Set(String::NewSymbol("background"), background);
+        return scope.Close(stats);
+    }
+
+    Handle<Value> Device::call_get_latency_stats(Arguments const &args)
+    {
+        HandleScope scope;
+        return scope.Close(GetDevice(args)->get_latency_stats(args));
+    }
+
+    // Durations in microseconds since the last reset. Takes an optional
+    // boolean, true to reset once read.
+    Handle<Value> Device::get_latency_stats(Arguments const &args)
+    {
+        HandleScope scope;
+        int const argc = args.Length();
+
+        if (argc > 1 || (argc == 1 && !args[0]->IsBoolean()))
+        {
+            throw_error("Expected an optional boolean");
+            return scope.Close(Undefined());
+        }
+
+        StreamLatency *const streams[] = { &depth_latency_, &video_latency_ };
+        char const *const stream_names[] = { "depth", "video" };
+        Local<Object> stats = Object::New();
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            Local<Object> stream = Object::New();
+            stream->Set(String::NewSymbol("dispatch"),
+                    latency_to_object(streams[i]->dispatch));
+            stream->Set(String::NewSymbol("callback"),
+                    latency_to_object(streams[i]->callback));
+            stream->Set(String::NewSymbol("total"),
+                    latency_to_object(streams[i]->total));
+
+            if (streams[i] == &video_latency_)
+            {
+                stream->Set(String::NewSymbol("encode"),
+                        latency_to_object(video_encoder_.latency()));
+            }
+
+            stats->Set(String::NewSymbol(stream_names[i]), stream);
+        }
+
+        WorldLatency &world_latency = world_.latency();
+        Local<Object> world = Object::New();
+        world->Set(String::NewSymbol("update"),
+                latency_to_object(world_latency.update));
+        world->Set(String::NewSymbol("process"),
+                latency_to_object(world_latency.process));
+        world->Set(String::NewSymbol("callback"),
+                latency_to_object(world_latency.callback));
+        world->Set(String::NewSymbol("total"),
+                latency_to_object(world_latency.total));
+        stats->Set(String::NewSymbol("world"), world);
+
+        if (argc == 1 && args[0]->BooleanValue())
+        {
+            depth_latency_.reset();
+            video_latency_.reset();
+            world_latency.reset();
+            video_encoder_.latency().reset();
+        }
+
+        return scope.Close(stats);
+    }
+
+
+    // =====================================================================
+    // = Recording                                                         =
+    // =====================================================================
+
+    Handle<Value> Device::call_start_recording(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->start_recording(args);
+        return scope.Close(Undefined());
+    }
+
+    // Records the frames as libfreenect delivers them, before the region of
+    // interest, decimation and demosaicing.
+    void Device::start_recording(Arguments const &args)
+    {
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !args[0]->IsString()
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected a path and an optional options object");
+            return;
+        }
+
+        if (!is_open())
+        {
+            throw_error("Device not open");
+            return;
+        }
+
+        int32_t max_queue_bytes = Recorder::DEFAULT_MAX_QUEUE_BYTES;
+
+        if (argc == 2 && (!get_option(args[1]->ToObject(), "maxQueueBytes",
+                                      max_queue_bytes)
+                          || max_queue_bytes <= 0))
+        {
+            throw_error("Expected maxQueueBytes to be a positive integer");
+            return;
+        }
+
+        String::Utf8Value const path(args[0]);
+
+        if (!recorder_.start(*path, depth_mode_, video_mode_,
+                             max_queue_bytes))
+        {
+            throw_error(recorder_.error().c_str());
+        }
+    }
+
+    Handle<Value> Device::call_stop_recording(Arguments const &args)
+    {
+        HandleScope scope;
+        Recorder &recorder = GetDevice(args)->recorder_;
+
+        if (!recorder.stop())
+        {
+            throw_error(recorder.error().c_str());
+        }
+
+        return scope.Close(Undefined());
+    }
+
+    Handle<Value> Device::call_get_recording_stats(Arguments const &args)
+    {
+        HandleScope scope;
+        return scope.Close(GetDevice(args)->get_recording_stats());
+    }
+
+    Handle<Value> Device::get_recording_stats() const
+    {
+        HandleScope scope;
+        Local<Object> stats = Object::New();
+        stats->Set(String::NewSymbol("recording"),
+                Boolean::New(recorder_.is_recording()));
+        stats->Set(String::NewSymbol("depth"),
+                recording_stats_to_object(recorder_, capture::Stream::DEPTH));
+        stats->Set(String::NewSymbol("video"),
+                recording_stats_to_object(recorder_, capture::Stream::VIDEO));
+        stats->Set(String::NewSymbol("bytes"),
+                Number::New(recorder_.written_bytes()));
+        stats->Set(String::NewSymbol("queuedBytes"),
+                Number::New(recorder_.queued_bytes()));
+        return scope.Close(stats);
+    }
+
+
+    // =====================================================================
+    // = LED                                                               =
+    // =====================================================================
+
+    Handle<Value> Device::CallSetLEDOption(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->SetLEDOption(args);
+        return scope.Close(Undefined());
+    }
+
+    void Device::SetLEDOption(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsInt32())
+        {
+            throw_error("Expected 1 number");
+            return;
+        }
+
+        if (device_ == nullptr)
+        {
+            throw_error("No Kinect to control");
+            return;
+        }
+
+        auto const option = static_cast<freenect_led_options>(
+                args[0]->ToInt32()->NumberValue());
+
+        if (freenect_set_led(device_, option) != 0)
+        {
+            throw_error("Could not set LED option");
+        }
+    }
+
+
+    // =====================================================================
+    // = Tilt                                                              =
+    // =====================================================================
+
+    Handle<Value> Device::CallTilt(Arguments const &args)
+    {
+        HandleScope scope;
+        GetDevice(args)->Tilt(args);
+        return scope.Close(Undefined());
+
+    }
+
+    void Device::Tilt(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsInt32())
+        {
+            throw_error("Expected 1 integer");
+            return;
+        }
+
+        if (device_ == nullptr)
+        {
+            throw_error("No Kinect to control");
+            return;
+        }
+
+        if (freenect_set_tilt_degs(device_, args[0]->ToInt32()->Value()) != 0)
+        {
+            throw_error("Could not set tilt angle");
+        }
+    }
+
+    // =====================================================================
+    // = Helpers                                                           =
+    // =====================================================================
+
+    // The per-device methods are also installed on Context, where they act
+    // on the device opened by enable().
+    Device *Device::GetDevice(Arguments const &args)
+    {
+        if (constructor_template_->HasInstance(args.This()))
+        {
+            return ObjectWrap::Unwrap<Device>(args.This());
+        }
+
+        return ObjectWrap::Unwrap<Context>(args.This())->default_device();
+    }
+
+
+    // =====================================================================
+    // = Node initialization                                               =
+    // =====================================================================
+
+    void Device::Initialize(Handle<Object> target)
+    {
+        HandleScope scope;
+
+        Local<FunctionTemplate> tpl = FunctionTemplate::New(New);
+        tpl->InstanceTemplate()->SetInternalFieldCount(1);
+        constructor_template_ = Persistent<FunctionTemplate>::New(tpl);
+
+        NODE_SET_PROTOTYPE_METHOD(tpl, "close", call_close);
+        set_prototype_methods(tpl);
+
+        target->Set(String::NewSymbol("Device"), tpl->GetFunction());
+    }
+
+    void Device::set_prototype_methods(Handle<FunctionTemplate> const tpl)
+    {
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setWorldCallback",
+                call_set_world_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetWorldCallback",
+                call_unset_world_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setPointCloudCallback",
+                call_set_point_cloud_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetPointCloudCallback",
+                call_unset_point_cloud_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setWorldThreads",
+                call_set_world_threads);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setWorldSyncTolerance",
+                call_set_world_sync_tolerance);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setCalibration",
+                call_set_calibration);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "loadCalibration",
+                call_load_calibration);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "getCalibration",
+                call_get_calibration);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setWorldKernel",
+                call_set_world_kernel);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "getWorldKernel",
+                call_get_world_kernel);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setWorldForeground",
+                call_set_world_foreground);
+
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setDepthRange",
+                call_set_depth_range);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "clearDepthRange",
+                call_clear_depth_range);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setRegionOfInterest",
+                call_set_region_of_interest);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "clearRegionOfInterest",
+                call_clear_region_of_interest);
+
+        NODE_SET_PROTOTYPE_METHOD(tpl, "startDepth", StartDepth);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "stopDepth", StopDepth);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setDepthCallback",
+                CallSetDepthCallback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetDepthCallback",
+                CallUnsetDepthCallback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setCompressedDepthCallback",
+                call_set_compressed_depth_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetCompressedDepthCallback",
+                call_unset_compressed_depth_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setDepthFilter",
+                call_set_depth_filter);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "clearDepthFilter",
+                call_clear_depth_filter);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setDepthSummaryCallback",
+                call_set_depth_summary_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetDepthSummaryCallback",
+                call_unset_depth_summary_callback);
+
+        NODE_SET_PROTOTYPE_METHOD(tpl, "learnBackground",
+                call_learn_background);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "freezeBackground",
+                call_freeze_background);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "resetBackground",
+                call_reset_background);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setForegroundCallback",
+                call_set_foreground_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetForegroundCallback",
+                call_unset_foreground_callback);
+
+        NODE_SET_PROTOTYPE_METHOD(tpl, "startVideo", StartVideo);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "stopVideo", StopVideo);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setVideoCallback",
+                CallSetVideoCallback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetVideoCallback",
+                CallUnsetVideoCallback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setDemosaic", call_set_demosaic);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setEncodedVideoCallback",
+                call_set_encoded_video_callback);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "unsetEncodedVideoCallback",
+                call_unset_encoded_video_callback);
+
+        NODE_SET_PROTOTYPE_METHOD(tpl, "getStats", call_get_stats);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "getLatencyStats",
+                call_get_latency_stats);
+
+        NODE_SET_PROTOTYPE_METHOD(tpl, "startRecording", call_start_recording);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "stopRecording", call_stop_recording);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "getRecordingStats",
+                call_get_recording_stats);
+
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setLedOption", CallSetLEDOption);
+        NODE_SET_PROTOTYPE_METHOD(tpl, "setTilt", CallTilt);
+    }
+}
+
+
+namespace
+{
+    // = Depth =============================================================
+
+    void depth_callback(freenect_device *dev, void *depth, uint32_t timestamp)
+    {
+        freenect_set_depth_buffer(dev,
+                get_kinect_device(dev)->publish_depth(depth, timestamp));
+    }
+
+    void async_depth_callback(uv_async_t *handle, int notUsed)
+    {
+        get_kinect_device(handle)->DepthCallback();
+    }
+
+
+    // = Video =============================================================
+
+    void video_callback(freenect_device *dev, void *video, uint32_t timestamp)
+    {
+        freenect_set_video_buffer(dev,
+                get_kinect_device(dev)->publish_video(video, timestamp));
+    }
+
+    void async_video_callback(uv_async_t *handle, int notUsed)
+    {
+        get_kinect_device(handle)->VideoCallback();
+    }
+
+
+    // = Stats =============================================================
+
+    Handle<Object> stats_to_object(kinect::FrameStats const &stats)
+    {
+        HandleScope scope;
+        Local<Object> object = Object::New();
+        object->Set(String::NewSymbol("produced"),
+                Number::New(stats.produced()));
+        object->Set(String::NewSymbol("delivered"),
+                Number::New(stats.delivered()));
+        object->Set(String::NewSymbol("coalesced"),
+                Number::New(stats.coalesced()));
+        object->Set(String::NewSymbol("dropped"),
+                Number::New(stats.dropped()));
+        object->Set(String::NewSymbol("timestamp"),
+                Integer::NewFromUnsigned(stats.timestamp()));
+        return scope.Close(object);
+    }
+
+
+    Handle<Object> latency_to_object(
+            kinect::LatencyHistogram const &histogram)
+    {
+        kinect::LatencyHistogram::Summary const summary = histogram.summary();
+        double const us = 1e-3;
+
+        HandleScope scope;
+        Local<Object> object = Object::New();
+        object->Set(String::NewSymbol("count"), Number::New(summary.count));
+        object->Set(String::NewSymbol("min"), Number::New(summary.min * us));
+        object->Set(String::NewSymbol("mean"),
+                Number::New(summary.mean * us));
+        object->Set(String::NewSymbol("max"), Number::New(summary.max * us));
+        object->Set(String::NewSymbol("p50"), Number::New(summary.p50 * us));
+        object->Set(String::NewSymbol("p90"), Number::New(summary.p90 * us));
+        object->Set(String::NewSymbol("p99"), Number::New(summary.p99 * us));
+        object->Set(String::NewSymbol("p999"),
+                Number::New(summary.p999 * us));
+        return scope.Close(object);
+    }
+
+    // Records the JS callback that started at start, for the frame
+    // published at published.
+    void record_callback(kinect::StreamLatency &latency,
+            uint64_t const published, uint64_t const start)
+    {
+        uint64_t const now = uv_hrtime();
+        latency.callback.record(now - start);
+        latency.total.record(now - published);
+    }
+
+
+    Handle<Object> recording_stats_to_object(kinect::Recorder const &recorder,
+            kinect::capture::Stream const stream)
+    {
+        HandleScope scope;
+        Local<Object> object = Object::New();
+        object->Set(String::NewSymbol("written"),
+                Number::New(recorder.written(stream)));
+        object->Set(String::NewSymbol("dropped"),
+                Number::New(recorder.dropped(stream)));
+        return scope.Close(object);
+    }
+
+
+    // = Modes =============================================================
+
+    // Leaves value alone if the key is missing and fails if it is not an
+    // integer.
+    bool get_option(Local<Object> const options, char const *const key,
+            int32_t &value)
+    {
+        Handle<String> const name = String::NewSymbol(key);
+
+        if (!options->Has(name))
+        {
+            return true;
+        }
+
+        Local<Value> const option = options->Get(name);
+
+        if (!option->IsInt32())
+        {
+            return false;
+        }
+
+        value = option->Int32Value();
+        return true;
+    }
+
+    // Reads the options of a synthetic source over the defaults, throwing if
+    // they are invalid.
+    bool get_synthetic_options(Local<Object> const object,
+            kinect::Synthetic::Options &options)
+    {
+        int32_t width = options.width;
+        int32_t height = options.height;
+        int32_t depth_format = FREENECT_DEPTH_11BIT;
+        int32_t spheres = options.spheres;
+        int32_t seed = options.seed;
+
+        if (!get_option(object, "width", width)
+                || !get_option(object, "height", height)
+                || width <= 0 || height <= 0 || width > 4096 || height > 4096)
+        {
+            kinect::throw_error(
+                    "Expected width and height to be integers from 1 to 4096");
+            return false;
+        }
+
+        if (!get_option(object, "depthFormat", depth_format)
+                || (depth_format != FREENECT_DEPTH_11BIT
+                    && depth_format != FREENECT_DEPTH_MM))
+        {
+            kinect::throw_error("Expected depthFormat to be DEPTH_11BIT or "
+                    "DEPTH_MM");
+            return false;
+        }
+
+        if (!get_option(object, "spheres", spheres) || spheres < 0
+                || size_t(spheres) > kinect::Synthetic::MAX_SPHERES)
+        {
+            kinect::throw_error(
+                    "Expected spheres to be an integer from 0 to 8");
+            return false;
+        }
+
+        if (!get_option(object, "seed", seed))
+        {
+            kinect::throw_error("Expected seed to be an integer");
+            return false;
+        }
+
+        char const *const numbers[] = { "fps", "noise" };
+        double *const values[] = { &options.fps, &options.noise };
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            Handle<String> const name = String::NewSymbol(numbers[i]);
+
+            if (!object->Has(name))
+            {
+                continue;
+            }
+
+            Local<Value> const value = object->Get(name);
+
+            if (!value->IsNumber() || !(value->NumberValue() >= 0))
+            {
+                kinect::throw_error(
+                        "Expected fps and noise to be numbers >= 0");
+                return false;
+            }
+
+            *values[i] = value->NumberValue();
+        }
+
+        Handle<String> const holes = String::NewSymbol("holes");
+
+        if (object->Has(holes))
+        {
+            options.has_holes = object->Get(holes)->BooleanValue();
+        }
+
+        options.width = width;
+        options.height = height;
+        options.unit = depth_format == FREENECT_DEPTH_MM
+            ? kinect::DepthUnit::MILLIMETRES : kinect::DepthUnit::RAW;
+        options.spheres = spheres;
+        options.seed = seed;
+        return true;
+    }
+
+    // Reads the level and decimation options of a callback, throwing if
+    // they are invalid.
+    bool get_level(Local<Object> const options, size_t &level,
+            kinect::DepthDecimation &decimation)
+    {
+        int32_t value = 0;
+
+        if (!get_option(options, "level", value) || value < 0
+                || size_t(value) > kinect::FrameView::MAX_LEVEL)
+        {
+            kinect::throw_error("Expected level to be an integer from 0 to 4");
+            return false;
+        }
+
+        level = value;
+
+        Handle<String> const name = String::NewSymbol("decimation");
+
+        if (!options->Has(name))
+        {
+            return true;
+        }
+
+        String::Utf8Value const method(options->Get(name));
+
+        struct { char const *name; kinect::DepthDecimation value; } const
+                methods[] = {
+            { "nearest", kinect::DepthDecimation::NEAREST },
+            { "mean", kinect::DepthDecimation::MEAN },
+            { "median", kinect::DepthDecimation::MEDIAN }
+        };
+
+        for (auto const &candidate : methods)
+        {
+            if (*method != nullptr && strcmp(*method, candidate.name) == 0)
+            {
+                decimation = candidate.value;
+                return true;
+            }
+        }
+
+        kinect::throw_error(
+                "Expected decimation to be 'nearest', 'mean' or 'median'");
+        return false;
+    }
+
+    // Reads the options of the encoded video callback over the defaults,
+    // throwing if they are invalid.
+    bool get_video_encoding(Local<Object> const options,
+            kinect::VideoEncoding &encoding, size_t &workers)
+    {
+        Handle<String> const format = String::NewSymbol("format");
+
+        if (options->Has(format))
+        {
+            String::Utf8Value const name(options->Get(format));
+
+            if (*name != nullptr && strcmp(*name, "jpeg") == 0)
+            {
+                encoding.codec = kinect::VideoCodec::JPEG;
+            }
+            else if (*name != nullptr && strcmp(*name, "qoi") == 0)
+            {
+                encoding.codec = kinect::VideoCodec::QOI;
+            }
+            else
+            {
+                kinect::throw_error("Expected format to be 'jpeg' or 'qoi'");
+                return false;
+            }
+        }
+
+        int32_t quality = encoding.quality;
+
+        if (!get_option(options, "quality", quality) || quality < 1
+                || quality > 100)
+        {
+            kinect::throw_error(
+                    "Expected quality to be an integer from 1 to 100");
+            return false;
+        }
+
+        encoding.quality = quality;
+
+        Handle<String> const subsampling = String::NewSymbol("subsampling");
+
+        if (options->Has(subsampling))
+        {
+            String::Utf8Value const name(options->Get(subsampling));
+
+            struct { char const *name; kinect::ChromaSubsampling value; }
+                    const modes[] = {
+                { "444", kinect::ChromaSubsampling::FULL },
+                { "422", kinect::ChromaSubsampling::HORIZONTAL },
+                { "420", kinect::ChromaSubsampling::BOTH }
+            };
+
+            bool is_found = false;
+
+            for (auto const &candidate : modes)
+            {
+                if (*name != nullptr && strcmp(*name, candidate.name) == 0)
+                {
+                    encoding.subsampling = candidate.value;
+                    is_found = true;
+                }
+            }
+
+            if (!is_found)
+            {
+                kinect::throw_error(
+                        "Expected subsampling to be '444', '422' or '420'");
+                return false;
+            }
+        }
+
+        int32_t count = int32_t(workers);
+
+        if (!get_option(options, "workers", count) || count < 1
+                || size_t(count) > kinect::VideoEncoder::MAX_WORKERS)
+        {
+            kinect::throw_error(
+                    "Expected workers to be an integer from 1 to 4");
+            return false;
+        }
+
+        workers = count;
+        return true;
+    }
+
+    // Reads the options of the depth filter over the defaults, throwing if
+    // they are invalid.
+    bool get_depth_filter_options(Local<Object> const object,
+            kinect::DepthFilterOptions &options)
+    {
+        Handle<String> const temporal = String::NewSymbol("temporal");
+
+        if (object->Has(temporal))
+        {
+            String::Utf8Value const name(object->Get(temporal));
+
+            struct { char const *name; kinect::TemporalFilter value; } const
+                    filters[] = {
+                { "off", kinect::TemporalFilter::OFF },
+                { "exponential", kinect::TemporalFilter::EXPONENTIAL },
+                { "median", kinect::TemporalFilter::MEDIAN }
+            };
+
+            bool is_found = false;
+
+            for (auto const &candidate : filters)
+            {
+                if (*name != nullptr && strcmp(*name, candidate.name) == 0)
+                {
+                    options.temporal = candidate.value;
+                    is_found = true;
+                }
+            }
+
+            if (!is_found)
+            {
+                kinect::throw_error("Expected temporal to be 'off', "
+                        "'exponential' or 'median'");
+                return false;
+            }
+        }
+
+        Handle<String> const spatial = String::NewSymbol("spatial");
+
+        if (object->Has(spatial))
+        {
+            String::Utf8Value const name(object->Get(spatial));
+
+            struct { char const *name; kinect::SpatialFilter value; } const
+                    filters[] = {
+                { "off", kinect::SpatialFilter::OFF },
+                { "bilateral", kinect::SpatialFilter::BILATERAL }
+            };
+
+            bool is_found = false;
+
+            for (auto const &candidate : filters)
+            {
+                if (*name != nullptr && strcmp(*name, candidate.name) == 0)
+                {
+                    options.spatial = candidate.value;
+                    is_found = true;
+                }
+            }
+
+            if (!is_found)
+            {
+                kinect::throw_error(
+                        "Expected spatial to be 'off' or 'bilateral'");
+                return false;
+            }
+        }
+
+        Handle<String> const alpha = String::NewSymbol("alpha");
+
+        if (object->Has(alpha))
+        {
+            Local<Value> const value = object->Get(alpha);
+
+            if (!value->IsNumber() || !(value->NumberValue() > 0)
+                    || value->NumberValue() > 1)
+            {
+                kinect::throw_error("Expected alpha to be a number in (0, 1]");
+                return false;
+            }
+
+            options.alpha = float(value->NumberValue());
+        }
+
+        int32_t hold = options.hold;
+        int32_t frames = options.frames;
+        int32_t radius = options.radius;
+        int32_t fill = options.fill;
+        int32_t threshold = options.threshold;
+
+        if (!get_option(object, "hold", hold) || hold < 0 || hold > 255)
+        {
+            kinect::throw_error("Expected hold to be an integer from 0 to 255");
+            return false;
+        }
+
+        if (!get_option(object, "frames", frames)
+                || (frames != 3 && frames != 5))
+        {
+            kinect::throw_error("Expected frames to be 3 or 5");
+            return false;
+        }
+
+        if (!get_option(object, "radius", radius) || radius < 1
+                || size_t(radius) > kinect::DepthFilter::MAX_RADIUS)
+        {
+            kinect::throw_error("Expected radius to be an integer from 1 to 5");
+            return false;
+        }
+
+        if (!get_option(object, "fill", fill) || fill < 0 || fill > 64)
+        {
+            kinect::throw_error("Expected fill to be an integer from 0 to 64");
+            return false;
+        }
+
+        if (!get_option(object, "threshold", threshold) || threshold < 0
+                || threshold > 65535)
+        {
+            kinect::throw_error(
+                    "Expected threshold to be an integer from 0 to 65535");
+            return false;
+        }
+
+        options.hold = hold;
+        options.frames = frames;
+        options.radius = radius;
+        options.fill = fill;
+        options.threshold = uint16_t(threshold);
+        return true;
+    }
+
+    // Reads the options of the depth summary over the defaults, throwing if
+    // they are invalid.
+    bool get_depth_summary_options(Local<Object> const object,
+            kinect::DepthSummaryOptions &options)
+    {
+        int32_t bins = options.bins;
+        int32_t columns = options.columns;
+        int32_t rows = options.rows;
+
+        if (!get_option(object, "bins", bins) || bins < 1
+                || size_t(bins) > kinect::DepthSummarizer::MAX_BINS)
+        {
+            kinect::throw_error(
+                    "Expected bins to be an integer from 1 to 1024");
+            return false;
+        }
+
+        if (!get_option(object, "columns", columns) || columns < 1
+                || size_t(columns) > kinect::DepthSummarizer::MAX_CELLS
+                || !get_option(object, "rows", rows) || rows < 1
+                || size_t(rows) > kinect::DepthSummarizer::MAX_CELLS)
+        {
+            kinect::throw_error(
+                    "Expected columns and rows to be integers from 1 to 16");
+            return false;
+        }
+
+        double range[] = { options.min, options.max };
+        char const *const keys[] = { "min", "max" };
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            Handle<String> const key = String::NewSymbol(keys[i]);
+
+            if (object->Has(key))
+            {
+                Local<Value> const value = object->Get(key);
+
+                if (!value->IsNumber())
+                {
+                    kinect::throw_error("Expected min and max to be numbers");
+                    return false;
+                }
+
+                range[i] = value->NumberValue();
+            }
+        }
+
+        if (!(range[0] >= 0 && range[0] < range[1]))
+        {
+            kinect::throw_error("Expected 0 <= min < max");
+            return false;
+        }
+
+        options.bins = bins;
+        options.min = float(range[0]);
+        options.max = float(range[1]);
+        options.columns = columns;
+        options.rows = rows;
+        return true;
+    }
+
+    Local<Object> depth_cell_object(kinect::DepthCell const &cell)
+    {
+        Local<Object> const object = Object::New();
+        object->Set(String::NewSymbol("valid"), Number::New(cell.valid));
+        object->Set(String::NewSymbol("min"), Number::New(cell.min));
+        object->Set(String::NewSymbol("max"), Number::New(cell.max));
+        object->Set(String::NewSymbol("mean"), Number::New(cell.mean));
+        return object;
+    }
+
+    // Reads the options of the background model over the defaults,
+    // throwing if they are invalid.
+    bool get_background_options(Local<Object> const object,
+            kinect::BackgroundOptions &options)
+    {
+        int32_t frames = options.frames;
+        int32_t margin = options.margin;
+
+        if (!get_option(object, "frames", frames) || frames < 1
+                || frames > 65535)
+        {
+            kinect::throw_error(
+                    "Expected frames to be an integer from 1 to 65535");
+            return false;
+        }
+
+        if (!get_option(object, "margin", margin) || margin < 0
+                || margin > 65535)
+        {
+            kinect::throw_error(
+                    "Expected margin to be an integer from 0 to 65535");
+            return false;
+        }
+
+        Handle<String> const deviations = String::NewSymbol("deviations");
+
+        if (object->Has(deviations))
+        {
+            Local<Value> const value = object->Get(deviations);
+
+            if (!value->IsNumber() || !(value->NumberValue() >= 0))
+            {
+                kinect::throw_error("Expected deviations to be a number >= 0");
+                return false;
+            }
+
+            options.deviations = float(value->NumberValue());
+        }
+
+        Handle<String> const continuous = String::NewSymbol("continuous");
+
+        if (object->Has(continuous))
+        {
+            options.is_continuous = object->Get(continuous)->BooleanValue();
+        }
+
+        options.frames = frames;
+        options.margin = uint16_t(margin);
+        return true;
+    }
+
+
+    // = Helpers ===========================================================
+
+    kinect::Device *get_kinect_device(uv_async_t *const handle)
+    {
+        auto const device = static_cast<kinect::Device *>(handle->data);
+        assert(device != nullptr);
+        return device;
+    }
+
+    kinect::Device *get_kinect_device(freenect_device *const dev)
+    {
+        auto const device = static_cast<kinect::Device *>(
+                freenect_get_user(dev));
+        assert(device != nullptr);
+        return device;
+    }
+}
@@ -0,0 +1,353 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+
+#include <memory>
+#include <vector>
+
+#include <node.h>
+
+#include <libfreenect.h>
+
+#include "async_handles.h"
+#include "demosaic.h"
+#include "depth_encoder.h"
+#include "depth_processor.h"
+#include "frame_buffers.h"
+#include "frame_stats.h"
+#include "frame_view.h"
+#include "latency.h"
+#include "recorder.h"
+#include "replay.h"
+#include "synthetic.h"
+#include "video_encoder.h"
+#include "world_frame.h"
+
+
+namespace kinect
+{
+    // One sensor on a Context's freenect context: its streams, callbacks and
+    // world frame. The Context's event thread drives every device it opened.
+    // It keeps itself alive while any of its workers has a job in flight.
+    class Device : public node::ObjectWrap, private WorkerOwner
+    {
+        public:
+            static void Initialize(v8::Handle<v8::Object> target);
+            static void set_prototype_methods(
+                    v8::Handle<v8::FunctionTemplate> tpl);
+            static v8::Local<v8::Object> NewInstance();
+
+            virtual ~Device();
+
+            bool configure(v8::Arguments const &args, int &index);
+            bool open(freenect_context *context, int index);
+            bool open_replay(v8::Arguments const &args);
+            bool open_synthetic(v8::Arguments const &args);
+            bool close();
+            bool is_open() const;
+            void start_source();
+            void stop_source();
+
+            // The object callbacks are called on, the device itself when
+            // null
+            void set_receiver(node::ObjectWrap *receiver);
+
+            void DepthCallback();
+            void VideoCallback();
+            uint8_t *publish_depth(void const *frame, uint32_t timestamp);
+            uint8_t *publish_video(void const *frame, uint32_t timestamp);
+
+        private:
+            Device();
+
+            static v8::Persistent<v8::FunctionTemplate> constructor_template_;
+
+            static Device *GetDevice(v8::Arguments const &args);
+            static v8::Handle<v8::Value> New(v8::Arguments const &args);
+            static v8::Handle<v8::Value> call_close(v8::Arguments const &args);
+            bool open_source(std::unique_ptr<FrameSource> source);
+            bool enable_async_handles();
+            void source_frame(capture::Stream stream, uint8_t const *frame,
+                    size_t bytes, uint32_t timestamp);
+            void hold();
+            void release();
+            v8::Handle<v8::Object> receiver() const;
+
+
+            // == World ========================================================
+
+            static v8::Handle<v8::Value> call_set_world_callback(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_unset_world_callback(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_point_cloud_callback(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_unset_point_cloud_callback(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_world_threads(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_world_sync_tolerance(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_calibration(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_load_calibration(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_get_calibration(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_world_kernel(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_get_world_kernel(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_world_foreground(
+                    v8::Arguments const &args);
+
+
+            // == Depth range and region of interest ===========================
+
+            static v8::Handle<v8::Value> call_set_depth_range(
+                    v8::Arguments const &args);
+
+            void set_depth_range(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_clear_depth_range(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_region_of_interest(
+                    v8::Arguments const &args);
+
+            void set_region_of_interest(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_clear_region_of_interest(
+                    v8::Arguments const &args);
+
+
+            // == Depth ========================================================
+
+            static v8::Handle<v8::Value> StartDepth(v8::Arguments const &args);
+
+            void StartDepth();
+
+            static v8::Handle<v8::Value> StopDepth(v8::Arguments const &args);
+
+            void StopDepth();
+
+            static v8::Handle<v8::Value> CallSetDepthCallback(
+                    v8::Arguments const &args);
+
+            void SetDepthCallback(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> CallUnsetDepthCallback(
+                    v8::Arguments const &args);
+
+            void UnsetDepthCallback();
+
+            void deliver_depth(uint64_t entry);
+
+            void deliver_processed_depth();
+
+            void deliver_depth_frame(uint8_t const *depth,
+                    v8::Handle<v8::Value> handle, uint32_t timestamp,
+                    uint64_t time, uint8_t const *foreground,
+                    DepthSummary const *summary);
+
+            static v8::Handle<v8::Value> call_set_compressed_depth_callback(
+                    v8::Arguments const &args);
+
+            void set_compressed_depth_callback(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_unset_compressed_depth_callback(
+                    v8::Arguments const &args);
+
+            void queue_compressed_depth(uint8_t const *depth,
+                    uint32_t timestamp);
+
+            void deliver_compressed_depth();
+
+            static v8::Handle<v8::Value> call_set_depth_filter(
+                    v8::Arguments const &args);
+
+            void set_depth_filter(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_clear_depth_filter(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_depth_summary_callback(
+                    v8::Arguments const &args);
+
+            void set_depth_summary_callback(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_unset_depth_summary_callback(
+                    v8::Arguments const &args);
+
+            void deliver_depth_summary(DepthSummary const *summary);
+
+
+            // == Background ===================================================
+
+            static v8::Handle<v8::Value> call_learn_background(
+                    v8::Arguments const &args);
+
+            void learn_background(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_freeze_background(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_reset_background(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_foreground_callback(
+                    v8::Arguments const &args);
+
+            void set_foreground_callback(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_unset_foreground_callback(
+                    v8::Arguments const &args);
+
+            void deliver_foreground(uint8_t const *foreground);
+
+
+            // == Video ========================================================
+
+            static v8::Handle<v8::Value> StartVideo(v8::Arguments const &args);
+
+            void StartVideo();
+
+            static v8::Handle<v8::Value> StopVideo(v8::Arguments const &args);
+
+            void StopVideo();
+
+            static v8::Handle<v8::Value> CallSetVideoCallback(
+                    v8::Arguments const &args);
+
+            void SetVideoCallback(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> CallUnsetVideoCallback(
+                    v8::Arguments const &args);
+
+            void UnsetVideoCallback();
+
+            void deliver_video(uint64_t entry);
+
+            void deliver_demosaiced();
+
+            bool is_demosaicing() const;
+
+            freenect_frame_mode video_output_mode() const;
+
+            static v8::Handle<v8::Value> call_set_demosaic(
+                    v8::Arguments const &args);
+
+            void set_demosaic(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_set_encoded_video_callback(
+                    v8::Arguments const &args);
+
+            void set_encoded_video_callback(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_unset_encoded_video_callback(
+                    v8::Arguments const &args);
+
+            void queue_encoded_video(uint8_t const *frame, uint32_t timestamp);
+
+            void deliver_encoded_video(size_t worker);
+
+
+            // == Stats ========================================================
+
+            static v8::Handle<v8::Value> call_get_stats(
+                    v8::Arguments const &args);
+
+            v8::Handle<v8::Value> get_stats() const;
+
+            static v8::Handle<v8::Value> call_get_latency_stats(
+                    v8::Arguments const &args);
+
+            v8::Handle<v8::Value> get_latency_stats(v8::Arguments const &args);
+
+
+            // == Recording ====================================================
+
+            static v8::Handle<v8::Value> call_start_recording(
+                    v8::Arguments const &args);
+
+            void start_recording(v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_stop_recording(
+                    v8::Arguments const &args);
+
+            static v8::Handle<v8::Value> call_get_recording_stats(
+                    v8::Arguments const &args);
+
+            v8::Handle<v8::Value> get_recording_stats() const;
+
+
+            // == LED ==========================================================
+
+            static v8::Handle<v8::Value> CallSetLEDOption(
+                    v8::Arguments const &args);
+
+            void SetLEDOption(v8::Arguments const &args);
+
+
+            // == Tilt =========================================================
+
+            static v8::Handle<v8::Value> CallTilt(v8::Arguments const &args);
+
+            void Tilt(v8::Arguments const &args);
+
+
+            v8::Persistent<v8::Function> depth_callback_;
+            v8::Persistent<v8::Function> video_callback_;
+            v8::Persistent<v8::Function> compressed_depth_callback_;
+            v8::Persistent<v8::Function> encoded_video_callback_;
+            v8::Persistent<v8::Function> foreground_callback_;
+            v8::Persistent<v8::Function> depth_summary_callback_;
+            bool packs_foreground_;
+
+            AsyncHandles async_handles_;
+            FrameBuffers video_buffers_;
+            FrameBuffers depth_buffers_;
+            FrameStats video_stats_;
+            FrameStats depth_stats_;
+            StreamLatency video_latency_;
+            StreamLatency depth_latency_;
+            uint64_t demosaic_time_;
+            FrameView video_view_;
+            FrameView depth_view_;
+            Demosaic demosaic_;
+            DepthEncoder depth_encoder_;
+            DepthProcessor depth_processor_;
+            VideoEncoder video_encoder_;
+            Recorder recorder_;
+            std::unique_ptr<FrameSource> source_;
+
+            freenect_device *device_;
+            node::ObjectWrap *receiver_;
+
+            // Between the context starting and stopping processing events
+            bool is_processing_;
+
+            freenect_frame_mode video_mode_;
+            freenect_frame_mode depth_mode_;
+
+            WorldFrame world_;
+
+            // Jobs in flight on the workers, with the device referenced
+            // while there are any
+            size_t held_jobs_;
+    };
+}
+
+
+#endif  // DEVICE_H
@@ -0,0 +1,81 @@
+#include <cassert>
+
+#include "frame_buffers.h"
+
+
+using node::Buffer;
+using v8::Handle;
+using v8::Persistent;
+using v8::Value;
+
+
+namespace kinect
+{
+    FrameBuffers::FrameBuffers() : bytes_(0)
+    {
+        for (size_t i = 0; i < FrameRing::SLOTS; ++i)
+        {
+            buffers_[i] = nullptr;
+        }
+    }
+
+    FrameBuffers::~FrameBuffers()
+    {
+        release();
+    }
+
+    void FrameBuffers::allocate(size_t const bytes)
+    {
+        release();
+
+        uint8_t *slots[FrameRing::SLOTS];
+
+        for (size_t i = 0; i < FrameRing::SLOTS; ++i)
+        {
+            buffers_[i] = Buffer::New(bytes);
+            handles_[i] = Persistent<Value>::New(buffers_[i]->handle_);
+            slots[i] = (uint8_t *) Buffer::Data(buffers_[i]);
+        }
+
+        bytes_ = bytes;
+        ring_.set_slots(slots);
+    }
+
+    void FrameBuffers::release()
+    {
+        ring_.clear_slots();
+
+        for (size_t i = 0; i < FrameRing::SLOTS; ++i)
+        {
+            if (buffers_[i] != nullptr)
+            {
+                handles_[i].Dispose();
+                handles_[i].Clear();
+                buffers_[i] = nullptr;
+            }
+        }
+
+        bytes_ = 0;
+    }
+
+    bool FrameBuffers::is_allocated() const
+    {
+        return bytes_ > 0;
+    }
+
+    size_t FrameBuffers::bytes() const
+    {
+        return bytes_;
+    }
+
+    FrameRing &FrameBuffers::ring()
+    {
+        return ring_;
+    }
+
+    Handle<Value> FrameBuffers::read_handle() const
+    {
+        assert(ring_.has_frame());
+        return buffers_[ring_.read_index()]->handle_;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef FRAME_BUFFERS_H
+#define FRAME_BUFFERS_H
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include "frame_ring.h"
+
+
+namespace kinect
+{
+    // Owns the node::Buffers backing the slots of a FrameRing, so the frame
+    // handed to JS is the memory libfreenect wrote without a copy.
+    class FrameBuffers
+    {
+        public:
+            FrameBuffers();
+            ~FrameBuffers();
+            void allocate(size_t bytes);
+            void release();
+            bool is_allocated() const;
+            size_t bytes() const;
+            FrameRing &ring();
+            v8::Handle<v8::Value> read_handle() const;
+
+        private:
+            FrameBuffers(FrameBuffers const &that) = delete;
+            size_t bytes_;
+            node::Buffer *buffers_[FrameRing::SLOTS];
+            v8::Persistent<v8::Value> handles_[FrameRing::SLOTS];
+            FrameRing ring_;
+    };
+}
+
+
+#endif  // FRAME_BUFFERS_H
@@ -0,0 +1,33 @@
+#include "frame_mode.h"
+
+
+namespace kinect
+{
+    size_t pixel_bytes(freenect_frame_mode const &mode)
+    {
+        size_t const bits = mode.data_bits_per_pixel
+            + mode.padding_bits_per_pixel;
+        return bits % 8 == 0 ? bits / 8 : 0;
+    }
+
+    bool find_depth_unit(freenect_frame_mode const &mode, DepthUnit &unit)
+    {
+        switch (mode.depth_format)
+        {
+            case FREENECT_DEPTH_11BIT:
+                unit = DepthUnit::RAW;
+                return true;
+            case FREENECT_DEPTH_REGISTERED:
+            case FREENECT_DEPTH_MM:
+                unit = DepthUnit::MILLIMETRES;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_registered_depth(freenect_frame_mode const &mode)
+    {
+        return mode.depth_format == FREENECT_DEPTH_REGISTERED;
+    }
+}
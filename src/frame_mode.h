@@ -0,0 +1,24 @@
+#ifndef FRAME_MODE_H
+#define FRAME_MODE_H
+
+#include <cstddef>
+
+#include <libfreenect.h>
+
+#include "depth.h"
+
+
+namespace kinect
+{
+    // Bytes per pixel, 0 for the packed formats.
+    size_t pixel_bytes(freenect_frame_mode const &mode);
+
+    // Fails for the depth formats whose values have no known conversion
+    // to metres.
+    bool find_depth_unit(freenect_frame_mode const &mode, DepthUnit &unit);
+
+    bool is_registered_depth(freenect_frame_mode const &mode);
+}
+
+
+#endif  // FRAME_MODE_H
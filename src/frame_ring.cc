@@ -0,0 +1,115 @@
+#include <cassert>
+
+#include "frame_ring.h"
+
+
+namespace
+{
+    // Set in middle_ when the middle slot holds a frame the reader has not
+    // acquired yet.
+    constexpr unsigned FRESH = 0x4;
+    constexpr unsigned INDEX_MASK = 0x3;
+}
+
+
+namespace kinect
+{
+    FrameRing::FrameRing() : write_(0), middle_(1), read_(2), has_frame_(false)
+    {
+        clear_slots();
+    }
+
+    void FrameRing::set_slots(uint8_t *const slots[SLOTS])
+    {
+        for (size_t i = 0; i < SLOTS; ++i)
+        {
+            assert(slots[i] != nullptr);
+            slots_[i] = slots[i];
+        }
+
+        write_ = 0;
+        middle_.store(1);
+        read_ = 2;
+        has_frame_ = false;
+    }
+
+    void FrameRing::clear_slots()
+    {
+        for (size_t i = 0; i < SLOTS; ++i)
+        {
+            slots_[i] = nullptr;
+            timestamps_[i] = 0;
+            times_[i] = 0;
+        }
+
+        has_frame_ = false;
+    }
+
+    bool FrameRing::has_slots() const
+    {
+        return slots_[0] != nullptr;
+    }
+
+
+    // == Event thread =====================================================
+
+    uint8_t *FrameRing::write_slot() const
+    {
+        return slots_[write_];
+    }
+
+    uint8_t *FrameRing::publish(uint32_t const timestamp, uint64_t const time,
+            bool &overwrote)
+    {
+        timestamps_[write_] = timestamp;
+        times_[write_] = time;
+
+        unsigned const previous = middle_.exchange(write_ | FRESH,
+                std::memory_order_acq_rel);
+        overwrote = (previous & FRESH) != 0;
+        write_ = previous & INDEX_MASK;
+        return slots_[write_];
+    }
+
+
+    // == Loop thread ======================================================
+
+    bool FrameRing::acquire()
+    {
+        if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0)
+        {
+            return false;
+        }
+
+        unsigned const previous = middle_.exchange(read_,
+                std::memory_order_acq_rel);
+        read_ = previous & INDEX_MASK;
+        has_frame_ = true;
+        return true;
+    }
+
+    bool FrameRing::has_frame() const
+    {
+        return has_frame_;
+    }
+
+    size_t FrameRing::read_index() const
+    {
+        return read_;
+    }
+
+    uint8_t *FrameRing::read_slot() const
+    {
+        return has_frame_ ? slots_[read_] : nullptr;
+    }
+
+    uint32_t FrameRing::read_timestamp() const
+    {
+        return timestamps_[read_];
+    }
+
+    uint64_t FrameRing::read_time() const
+    {
+        return times_[read_];
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace kinect
+{
+    // A triple buffer of frame slots shared between the libfreenect event
+    // thread, which fills them, and the libuv loop thread, which reads them.
+    // The writer and the reader each own one slot and trade it for the
+    // middle slot, so a published frame is never written while it is read.
+    class FrameRing
+    {
+        public:
+            static size_t const SLOTS = 3;
+
+            FrameRing();
+            void set_slots(uint8_t *const slots[SLOTS]);
+            void clear_slots();
+            bool has_slots() const;
+
+            // Event thread
+            uint8_t *write_slot() const;
+            // time is the uv_hrtime() the frame arrived at.
+            uint8_t *publish(uint32_t timestamp, uint64_t time,
+                    bool &overwrote);
+
+            // Loop thread
+            bool acquire();
+            bool has_frame() const;
+            size_t read_index() const;
+            uint8_t *read_slot() const;
+            uint32_t read_timestamp() const;
+            uint64_t read_time() const;
+
+        private:
+            FrameRing(FrameRing const &that) = delete;
+            uint8_t *slots_[SLOTS];
+            uint32_t timestamps_[SLOTS];
+            uint64_t times_[SLOTS];
+            size_t write_;
+            std::atomic<unsigned> middle_;
+            size_t read_;
+            bool has_frame_;
+    };
+}
+
+
+#endif  // FRAME_RING_H
@@ -0,0 +1,168 @@
+#include <algorithm>
+
+#include "frame_source.h"
+
+
+namespace kinect
+{
+    FrameSource::FrameSource() : is_running_(false), is_stopping_(false)
+    {
+        for (size_t stream = 0; stream < capture::STREAMS; ++stream)
+        {
+            is_enabled_[stream] = false;
+            is_emitting_[stream] = false;
+        }
+
+        uv_mutex_init(&mutex_);
+        uv_cond_init(&changed_);
+        uv_cond_init(&emitted_);
+    }
+
+    // Subclasses stop the thread in their own destructor, while run() can
+    // still use their members.
+    FrameSource::~FrameSource()
+    {
+        uv_cond_destroy(&emitted_);
+        uv_cond_destroy(&changed_);
+        uv_mutex_destroy(&mutex_);
+    }
+
+    void FrameSource::start(Sink const &sink)
+    {
+        if (is_running_)
+        {
+            return;
+        }
+
+        sink_ = sink;
+        uv_mutex_lock(&mutex_);
+        is_stopping_ = false;
+        uv_mutex_unlock(&mutex_);
+        is_running_ = true;
+        uv_thread_create(&thread_, call_run, this);
+    }
+
+    void FrameSource::stop()
+    {
+        if (!is_running_)
+        {
+            return;
+        }
+
+        uv_mutex_lock(&mutex_);
+        is_stopping_ = true;
+        uv_cond_signal(&changed_);
+        uv_mutex_unlock(&mutex_);
+
+        uv_thread_join(&thread_);
+        is_running_ = false;
+    }
+
+    bool FrameSource::is_running() const
+    {
+        return is_running_;
+    }
+
+    void FrameSource::set_enabled(capture::Stream const stream,
+            bool const is_enabled)
+    {
+        size_t const index = static_cast<size_t>(stream);
+        uv_mutex_lock(&mutex_);
+        is_enabled_[index] = is_enabled;
+        uv_cond_signal(&changed_);
+
+        while (!is_enabled && is_emitting_[index])
+        {
+            uv_cond_wait(&emitted_, &mutex_);
+        }
+
+        uv_mutex_unlock(&mutex_);
+    }
+
+    // Returns false if stopped while waiting.
+    bool FrameSource::wait_until(uint64_t const time)
+    {
+        uv_mutex_lock(&mutex_);
+
+        while (!is_stopping_)
+        {
+            uint64_t const now = uv_hrtime();
+
+            if (now >= time)
+            {
+                break;
+            }
+
+            uv_cond_timedwait(&changed_, &mutex_, time - now);
+        }
+
+        bool const is_due = !is_stopping_;
+        uv_mutex_unlock(&mutex_);
+        return is_due;
+    }
+
+    // Blocks while no stream is enabled. Returns false if stopped while
+    // waiting.
+    bool FrameSource::wait_for_streams()
+    {
+        uv_mutex_lock(&mutex_);
+
+        while (!is_stopping_ && std::find(is_enabled_,
+                    is_enabled_ + capture::STREAMS, true)
+                == is_enabled_ + capture::STREAMS)
+        {
+            uv_cond_wait(&changed_, &mutex_);
+        }
+
+        bool const has_streams = !is_stopping_;
+        uv_mutex_unlock(&mutex_);
+        return has_streams;
+    }
+
+    bool FrameSource::is_stopping() const
+    {
+        uv_mutex_lock(&mutex_);
+        bool const is_stopping = is_stopping_;
+        uv_mutex_unlock(&mutex_);
+        return is_stopping;
+    }
+
+    bool FrameSource::is_enabled(capture::Stream const stream) const
+    {
+        uv_mutex_lock(&mutex_);
+        bool const is_enabled = is_enabled_[static_cast<size_t>(stream)];
+        uv_mutex_unlock(&mutex_);
+        return is_enabled;
+    }
+
+    // The frame is marked in flight while the sink runs, so set_enabled()
+    // can wait for it without the sink holding the mutex.
+    void FrameSource::emit(capture::Stream const stream,
+            uint8_t const *const frame, size_t const bytes,
+            uint32_t const timestamp)
+    {
+        size_t const index = static_cast<size_t>(stream);
+        uv_mutex_lock(&mutex_);
+
+        if (!is_enabled_[index] || is_stopping_)
+        {
+            uv_mutex_unlock(&mutex_);
+            return;
+        }
+
+        is_emitting_[index] = true;
+        uv_mutex_unlock(&mutex_);
+
+        sink_(stream, frame, bytes, timestamp);
+
+        uv_mutex_lock(&mutex_);
+        is_emitting_[index] = false;
+        uv_cond_broadcast(&emitted_);
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void FrameSource::call_run(void *const source)
+    {
+        static_cast<FrameSource *>(source)->run();
+    }
+}
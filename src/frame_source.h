@@ -0,0 +1,75 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include <uv.h>
+
+#include <libfreenect.h>
+
+#include "capture_format.h"
+
+
+namespace kinect
+{
+    // Produces frames from its own thread, in place of the libfreenect
+    // event thread. Subclasses implement run(), which is called on that
+    // thread and hands frames over with emit(). The mutex is only held to
+    // read and change the state, never across run() or the sink.
+    class FrameSource
+    {
+        public:
+            // Called on the source thread, for enabled streams only.
+            typedef std::function<void(capture::Stream stream,
+                    uint8_t const *frame, size_t bytes, uint32_t timestamp)>
+                Sink;
+
+            FrameSource();
+            virtual ~FrameSource();
+
+            virtual freenect_frame_mode const &depth_mode() const = 0;
+            virtual freenect_frame_mode const &video_mode() const = 0;
+
+            // Loop thread
+            void start(Sink const &sink);
+            void stop();
+            bool is_running() const;
+
+            // Once this returns the sink is not running for the stream.
+            void set_enabled(capture::Stream stream, bool is_enabled);
+
+        protected:
+            virtual void run() = 0;
+
+            // Source thread
+            bool wait_until(uint64_t time);
+            bool wait_for_streams();
+            bool is_stopping() const;
+            bool is_enabled(capture::Stream stream) const;
+            void emit(capture::Stream stream, uint8_t const *frame,
+                    size_t bytes, uint32_t timestamp);
+
+        private:
+            FrameSource(FrameSource const &that) = delete;
+            static void call_run(void *source);
+
+            Sink sink_;
+            uv_thread_t thread_;
+            bool is_running_;
+
+            // Under mutex_. changed_ wakes the source thread when stopping
+            // or enabling a stream, and emitted_ the loop thread when the
+            // frame in flight is done.
+            mutable uv_mutex_t mutex_;
+            uv_cond_t changed_;
+            uv_cond_t emitted_;
+            bool is_stopping_;
+            bool is_enabled_[capture::STREAMS];
+            bool is_emitting_[capture::STREAMS];
+    };
+}
+
+
+#endif  // FRAME_SOURCE_H
@@ -0,0 +1,78 @@
+#include "frame_stats.h"
+
+
+namespace kinect
+{
+    FrameStats::FrameStats() : produced_(0), delivered_(0), coalesced_(0),
+            dropped_(0), timestamp_(0), signalled_(0)
+    {
+        // Empty
+    }
+
+
+    // == Event thread =====================================================
+
+    void FrameStats::count_produced(uint32_t const timestamp,
+            bool const dropped)
+    {
+        timestamp_.store(timestamp, std::memory_order_relaxed);
+
+        if (dropped)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        produced_.fetch_add(1, std::memory_order_release);
+    }
+
+
+    // == Loop thread ======================================================
+
+    void FrameStats::count_signal()
+    {
+        // uv_async_send() merges signals sent before the loop wakes up, so
+        // every frame produced since the last wake up beyond the first one
+        // was signalled but never got its own callback.
+        uint64_t const produced = produced_.load(std::memory_order_acquire);
+        uint64_t const signals = produced - signalled_;
+        signalled_ = produced;
+
+        if (signals > 1)
+        {
+            coalesced_.fetch_add(signals - 1, std::memory_order_relaxed);
+        }
+    }
+
+    void FrameStats::count_delivered()
+    {
+        delivered_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    // == Accessors ========================================================
+
+    uint64_t FrameStats::produced() const
+    {
+        return produced_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t FrameStats::delivered() const
+    {
+        return delivered_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t FrameStats::coalesced() const
+    {
+        return coalesced_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t FrameStats::dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    uint32_t FrameStats::timestamp() const
+    {
+        return timestamp_.load(std::memory_order_relaxed);
+    }
+}
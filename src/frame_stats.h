@@ -0,0 +1,42 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace kinect
+{
+    // Lock-free frame accounting for one stream. The event thread counts
+    // produced and dropped frames, the loop thread counts the rest.
+    class FrameStats
+    {
+        public:
+            FrameStats();
+
+            // Event thread
+            void count_produced(uint32_t timestamp, bool dropped);
+
+            // Loop thread
+            void count_signal();
+            void count_delivered();
+
+            uint64_t produced() const;
+            uint64_t delivered() const;
+            uint64_t coalesced() const;
+            uint64_t dropped() const;
+            uint32_t timestamp() const;
+
+        private:
+            FrameStats(FrameStats const &that) = delete;
+            std::atomic<uint64_t> produced_;
+            std::atomic<uint64_t> delivered_;
+            std::atomic<uint64_t> coalesced_;
+            std::atomic<uint64_t> dropped_;
+            std::atomic<uint32_t> timestamp_;
+            uint64_t signalled_;
+    };
+}
+
+
+#endif  // FRAME_STATS_H
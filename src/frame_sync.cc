@@ -0,0 +1,164 @@
+#include <cstring>
+
+#include "frame_sync.h"
+
+
+namespace
+{
+    // Timestamps wrap around, compare them through their difference.
+    int32_t difference(uint32_t const a, uint32_t const b)
+    {
+        return static_cast<int32_t>(a - b);
+    }
+
+    uint32_t distance(uint32_t const a, uint32_t const b)
+    {
+        int32_t const d = difference(a, b);
+        return d < 0 ? -static_cast<uint32_t>(d) : d;
+    }
+}
+
+
+namespace kinect
+{
+    FrameSync::FrameSync() : tolerance_(0), interval_(0),
+            has_depth_timestamp_(false), depth_timestamp_(0)
+    {
+        clear();
+    }
+
+    void FrameSync::set_tolerance(uint32_t const tolerance)
+    {
+        tolerance_ = tolerance;
+    }
+
+    uint32_t FrameSync::tolerance() const
+    {
+        // Unless set, accept frames up to half a depth frame apart.
+        return tolerance_ > 0 ? tolerance_ : interval_ / 2;
+    }
+
+    void FrameSync::clear()
+    {
+        for (Stream *const stream : { &depth_, &video_ })
+        {
+            for (auto &frame : stream->frames)
+            {
+                frame.timestamp = 0;
+                frame.time = 0;
+                frame.is_used = true;
+            }
+            stream->next = 0;
+        }
+
+        has_depth_timestamp_ = false;
+    }
+
+    uint8_t *FrameSync::push_depth(uint8_t const *const data,
+            size_t const bytes, size_t const capacity,
+            uint32_t const timestamp, uint64_t const time)
+    {
+        if (has_depth_timestamp_ && difference(timestamp, depth_timestamp_) > 0)
+        {
+            interval_ = timestamp - depth_timestamp_;
+        }
+
+        has_depth_timestamp_ = true;
+        depth_timestamp_ = timestamp;
+
+        return push(depth_, data, bytes, capacity, timestamp, time);
+    }
+
+    void FrameSync::push_video(uint8_t const *const data, size_t const bytes,
+            size_t const capacity, uint32_t const timestamp)
+    {
+        push(video_, data, bytes, capacity, timestamp, 0);
+    }
+
+    bool FrameSync::match(Frame *&depth, Frame *&video)
+    {
+        if (interval_ == 0 && tolerance_ == 0)
+        {
+            // Need two depth frames to know the frame interval.
+            return false;
+        }
+
+        uint32_t const tolerance = this->tolerance();
+        bool is_matched = false;
+
+        for (auto &d : depth_.frames)
+        {
+            if (d.is_used)
+            {
+                continue;
+            }
+
+            for (auto &v : video_.frames)
+            {
+                if (v.is_used || distance(d.timestamp, v.timestamp) > tolerance)
+                {
+                    continue;
+                }
+
+                // Prefer the pair whose older frame is the most recent.
+                uint32_t const oldest =
+                    difference(d.timestamp, v.timestamp) < 0
+                    ? d.timestamp : v.timestamp;
+
+                if (is_matched)
+                {
+                    uint32_t const best =
+                        difference(depth->timestamp, video->timestamp) < 0
+                        ? depth->timestamp : video->timestamp;
+
+                    if (difference(oldest, best) <= 0)
+                    {
+                        continue;
+                    }
+                }
+
+                depth = &d;
+                video = &v;
+                is_matched = true;
+            }
+        }
+
+        return is_matched;
+    }
+
+    void FrameSync::consume(Frame const &depth, Frame const &video)
+    {
+        consume(depth_, depth.timestamp);
+        consume(video_, video.timestamp);
+    }
+
+    uint8_t *FrameSync::push(Stream &stream, uint8_t const *const data,
+            size_t const bytes, size_t const capacity,
+            uint32_t const timestamp, uint64_t const time)
+    {
+        Frame &frame = stream.frames[stream.next];
+        stream.next = (stream.next + 1) % HISTORY;
+
+        if (frame.data.size() != capacity)
+        {
+            frame.data.resize(capacity);
+        }
+
+        memcpy(frame.data.data(), data, bytes);
+        frame.timestamp = timestamp;
+        frame.time = time;
+        frame.is_used = false;
+        return frame.data.data();
+    }
+
+    void FrameSync::consume(Stream &stream, uint32_t const timestamp)
+    {
+        for (auto &frame : stream.frames)
+        {
+            if (difference(frame.timestamp, timestamp) <= 0)
+            {
+                frame.is_used = true;
+            }
+        }
+    }
+}
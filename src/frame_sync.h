@@ -0,0 +1,69 @@
+#ifndef FRAME_SYNC_H
+#define FRAME_SYNC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace kinect
+{
+    // Keeps the last few depth and video frames and pairs them by their
+    // libfreenect timestamps, so each pair is registered once.
+    class FrameSync
+    {
+        public:
+            static size_t const HISTORY = 4;
+
+            struct Frame
+            {
+                std::vector<uint8_t> data;
+                uint32_t timestamp;
+
+                // When a depth frame was published, 0 for video
+                uint64_t time;
+                bool is_used;
+            };
+
+            FrameSync();
+            void set_tolerance(uint32_t tolerance);
+            uint32_t tolerance() const;
+            void clear();
+
+            // Returns the copy of the frame kept.
+            uint8_t *push_depth(uint8_t const *data, size_t bytes,
+                    size_t capacity, uint32_t timestamp, uint64_t time);
+            void push_video(uint8_t const *data, size_t bytes,
+                    size_t capacity, uint32_t timestamp);
+
+            // Finds the most recent pair of unused frames whose timestamps
+            // are within the tolerance.
+            bool match(Frame *&depth, Frame *&video);
+
+            // Marks a matched pair and every older frame as used.
+            void consume(Frame const &depth, Frame const &video);
+
+        private:
+            struct Stream
+            {
+                Frame frames[HISTORY];
+                size_t next;
+            };
+
+            FrameSync(FrameSync const &that) = delete;
+            static uint8_t *push(Stream &stream, uint8_t const *data,
+                    size_t bytes, size_t capacity, uint32_t timestamp,
+                    uint64_t time);
+            static void consume(Stream &stream, uint32_t timestamp);
+
+            Stream depth_;
+            Stream video_;
+            uint32_t tolerance_;
+            uint32_t interval_;
+            bool has_depth_timestamp_;
+            uint32_t depth_timestamp_;
+    };
+}
+
+
+#endif  // FRAME_SYNC_H
@@ -0,0 +1,202 @@
+#include <cassert>
+
+#include "frame_mode.h"
+#include "frame_view.h"
+
+
+using node::Buffer;
+using v8::Handle;
+using v8::Persistent;
+using v8::Value;
+
+
+namespace kinect
+{
+    FrameView::FrameView(bool const is_depth) : is_depth_(is_depth),
+            width_(0), height_(0), pixel_bytes_(0), has_depth_unit_(false),
+            depth_unit_(DepthUnit::RAW), has_region_(false),
+            region_width_(0), region_height_(0),
+            has_depth_range_(false), depth_min_(0), depth_max_(0),
+            invalid_depth_(0), can_decimate_(false), level_(0),
+            decimation_(DepthDecimation::NEAREST), buffer_(nullptr)
+    {
+        // Empty
+    }
+
+    FrameView::~FrameView()
+    {
+        release();
+    }
+
+    void FrameView::set_mode(freenect_frame_mode const &mode)
+    {
+        width_ = mode.width;
+        height_ = mode.height;
+        pixel_bytes_ = pixel_bytes(mode);
+        has_depth_unit_ = is_depth_ && find_depth_unit(mode, depth_unit_);
+        update_depth_mask();
+
+        // Without a known invalid value every depth value counts.
+        invalid_depth_ = has_depth_unit_ ? invalid_depth(depth_unit_)
+                : mode.depth_format == FREENECT_DEPTH_10BIT ? 1023 : 0xffff;
+
+        // Interleaved YUV does not average per byte.
+        can_decimate_ = pixel_bytes_ > 0 && (is_depth_
+                || mode.video_format != FREENECT_VIDEO_YUV_RAW);
+    }
+
+    void FrameView::set_region(Region const &region, size_t const width,
+            size_t const height)
+    {
+        assert(is_region_inside(region, width, height));
+        region_ = region;
+        region_width_ = width;
+        region_height_ = height;
+        has_region_ = true;
+    }
+
+    void FrameView::clear_region()
+    {
+        has_region_ = false;
+    }
+
+    void FrameView::set_depth_range(double const min, double const max)
+    {
+        depth_min_ = min;
+        depth_max_ = max;
+        has_depth_range_ = true;
+        update_depth_mask();
+    }
+
+    void FrameView::clear_depth_range()
+    {
+        has_depth_range_ = false;
+    }
+
+    void FrameView::set_level(size_t const level,
+            DepthDecimation const decimation)
+    {
+        level_ = level < MAX_LEVEL ? level : MAX_LEVEL;
+        decimation_ = decimation;
+    }
+
+    Handle<Value> FrameView::view(uint8_t const *const frame,
+            Handle<Value> const frame_handle)
+    {
+        bool const is_masked = has_depth_unit_ && has_depth_range_;
+        size_t const levels = can_decimate_ ? level_ : 0;
+
+        Region const region = has_region_
+                ? scale_region(region_, region_width_, region_height_,
+                        width_, height_)
+                : full_region(width_, height_);
+        bool const is_cropped = is_masked
+                || !is_full_region(region, width_, height_);
+
+        if (pixel_bytes_ == 0 || (!is_cropped && levels == 0))
+        {
+            release();
+            return frame_handle;
+        }
+
+        size_t width = region.width;
+        size_t height = region.height;
+        allocate((width >> levels) * (height >> levels) * pixel_bytes_);
+
+        uint8_t *const data = (uint8_t *) Buffer::Data(buffer_);
+        uint8_t const *src = frame;
+
+        // Each stage writes the delivered buffer if it is the last and
+        // otherwise alternates between the scratch buffers.
+        if (is_cropped)
+        {
+            uint8_t *dst = data;
+
+            if (levels > 0)
+            {
+                scratch_[0].resize(width * height * pixel_bytes_);
+                dst = scratch_[0].data();
+            }
+
+            if (is_masked)
+            {
+                crop_depth(frame, width_, region, depth_mask_,
+                        invalid_depth_, dst);
+            }
+            else
+            {
+                crop_frame(frame, width_, pixel_bytes_, region, dst);
+            }
+
+            src = dst;
+        }
+
+        for (size_t level = 1; level <= levels; ++level)
+        {
+            uint8_t *dst = data;
+
+            if (level < levels)
+            {
+                std::vector<uint8_t> &scratch = scratch_[level % 2];
+                scratch.resize((width / 2) * (height / 2) * pixel_bytes_);
+                dst = scratch.data();
+            }
+
+            decimate(src, width, height, dst);
+            src = dst;
+            width /= 2;
+            height /= 2;
+        }
+
+        return buffer_->handle_;
+    }
+
+    void FrameView::decimate(uint8_t const *const src, size_t const width,
+            size_t const height, uint8_t *const dst) const
+    {
+        if (is_depth_)
+        {
+            decimate_depth(decimation_, src, width, height, invalid_depth_,
+                    dst);
+        }
+        else if (pixel_bytes_ == 2)
+        {
+            decimate_words(src, width, height, dst);
+        }
+        else
+        {
+            decimate_bytes(src, width, height, pixel_bytes_, dst);
+        }
+    }
+
+    void FrameView::update_depth_mask()
+    {
+        if (has_depth_unit_ && has_depth_range_)
+        {
+            build_depth_mask(depth_unit_, depth_min_, depth_max_,
+                    depth_mask_);
+        }
+    }
+
+    void FrameView::allocate(size_t const bytes)
+    {
+        if (buffer_ != nullptr && Buffer::Length(buffer_) == bytes)
+        {
+            return;
+        }
+
+        release();
+        buffer_ = Buffer::New(bytes);
+        handle_ = Persistent<Value>::New(buffer_->handle_);
+    }
+
+    void FrameView::release()
+    {
+        if (buffer_ != nullptr)
+        {
+            handle_.Dispose();
+            handle_.Clear();
+            buffer_ = nullptr;
+        }
+    }
+}
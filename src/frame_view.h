@@ -0,0 +1,76 @@
+#ifndef FRAME_VIEW_H
+#define FRAME_VIEW_H
+
+#include <cstdint>
+#include <vector>
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include <libfreenect.h>
+
+#include "decimate.h"
+#include "region.h"
+
+
+namespace kinect
+{
+    // What the depth or video callback receives: the frame in the ring
+    // as is, or a copy cropped to a region of interest, for depth masked
+    // to a depth range, and halved level times. The copy is reused from
+    // frame to frame and only reallocated when its size changes. Packed
+    // frames are always delivered as they are, and depth without a known
+    // unit is not masked.
+    class FrameView
+    {
+        public:
+            explicit FrameView(bool is_depth);
+            ~FrameView();
+            void set_mode(freenect_frame_mode const &mode);
+            // The region is given in a frame of width x height and
+            // scaled to the mode of each frame.
+            void set_region(Region const &region, size_t width,
+                    size_t height);
+            void clear_region();
+            void set_depth_range(double min, double max);
+            void clear_depth_range();
+            void set_level(size_t level, DepthDecimation decimation);
+            v8::Handle<v8::Value> view(uint8_t const *frame,
+                    v8::Handle<v8::Value> frame_handle);
+
+            static size_t const MAX_LEVEL = 4;
+
+        private:
+            FrameView(FrameView const &that) = delete;
+            bool const is_depth_;
+            size_t width_;
+            size_t height_;
+            size_t pixel_bytes_;
+            bool has_depth_unit_;
+            DepthUnit depth_unit_;
+            bool has_region_;
+            Region region_;
+            size_t region_width_;
+            size_t region_height_;
+            bool has_depth_range_;
+            double depth_min_;
+            double depth_max_;
+            std::vector<uint8_t> depth_mask_;
+            uint16_t invalid_depth_;
+            bool can_decimate_;
+            size_t level_;
+            DepthDecimation decimation_;
+            std::vector<uint8_t> scratch_[2];
+            node::Buffer *buffer_;
+            v8::Persistent<v8::Value> handle_;
+
+            void update_depth_mask();
+            void decimate(uint8_t const *src, size_t width, size_t height,
+                    uint8_t *dst) const;
+            void allocate(size_t bytes);
+            void release();
+    };
+}
+
+
+#endif  // FRAME_VIEW_H
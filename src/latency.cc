@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "latency.h"
+
+
+namespace kinect
+{
+    LatencyHistogram::LatencyHistogram()
+    {
+        reset();
+    }
+
+    void LatencyHistogram::record(uint64_t const nanoseconds)
+    {
+        counts_[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+        uint64_t min = min_.load(std::memory_order_relaxed);
+
+        while (nanoseconds < min && !min_.compare_exchange_weak(min,
+                    nanoseconds, std::memory_order_relaxed))
+        {
+            // Retry with the updated min
+        }
+
+        uint64_t max = max_.load(std::memory_order_relaxed);
+
+        while (nanoseconds > max && !max_.compare_exchange_weak(max,
+                    nanoseconds, std::memory_order_relaxed))
+        {
+            // Retry with the updated max
+        }
+
+        count_.fetch_add(1, std::memory_order_release);
+    }
+
+    LatencyHistogram::Summary LatencyHistogram::summary() const
+    {
+        Summary summary = Summary();
+        summary.count = count_.load(std::memory_order_acquire);
+
+        if (summary.count == 0)
+        {
+            return summary;
+        }
+
+        summary.min = min_.load(std::memory_order_relaxed);
+        summary.max = max_.load(std::memory_order_relaxed);
+        summary.mean = sum_.load(std::memory_order_relaxed)
+            / double(summary.count);
+        summary.p50 = percentile(0.5, summary.count);
+        summary.p90 = percentile(0.9, summary.count);
+        summary.p99 = percentile(0.99, summary.count);
+        summary.p999 = percentile(0.999, summary.count);
+        return summary;
+    }
+
+    void LatencyHistogram::reset()
+    {
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        min_.store(std::numeric_limits<uint64_t>::max(),
+                std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            counts_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Values below SUB_BUCKETS have a bucket each. Above, the bucket is the
+    // power of two and the next SUB_BUCKET_BITS bits below the top one.
+    size_t LatencyHistogram::bucket(uint64_t const nanoseconds)
+    {
+        if (nanoseconds < SUB_BUCKETS)
+        {
+            return size_t(nanoseconds);
+        }
+
+        size_t const magnitude = 63 - __builtin_clzll(nanoseconds);
+
+        if (magnitude >= MAX_BITS)
+        {
+            return BUCKETS - 1;
+        }
+
+        size_t const shift = magnitude - SUB_BUCKET_BITS;
+        size_t const sub = size_t(nanoseconds >> shift) - SUB_BUCKETS;
+        return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+    }
+
+    // The middle of the bucket
+    uint64_t LatencyHistogram::bucket_value(size_t const bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+        {
+            return bucket;
+        }
+
+        size_t const shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+        size_t const sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+        uint64_t const lower = uint64_t(SUB_BUCKETS + sub) << shift;
+        return lower + ((uint64_t(1) << shift) >> 1);
+    }
+
+    uint64_t LatencyHistogram::percentile(double const fraction,
+            uint64_t const count) const
+    {
+        uint64_t const rank = std::max<uint64_t>(1,
+                uint64_t(std::ceil(fraction * count)));
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += counts_[i].load(std::memory_order_relaxed);
+
+            if (seen >= rank)
+            {
+                // Never outside what was recorded
+                return std::min(std::max(bucket_value(i),
+                            min_.load(std::memory_order_relaxed)),
+                        max_.load(std::memory_order_relaxed));
+            }
+        }
+
+        return max_.load(std::memory_order_relaxed);
+    }
+
+
+    void StreamLatency::reset()
+    {
+        dispatch.reset();
+        callback.reset();
+        total.reset();
+    }
+
+    void WorldLatency::reset()
+    {
+        update.reset();
+        process.reset();
+        callback.reset();
+        total.reset();
+    }
+}
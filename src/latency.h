@@ -0,0 +1,84 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace kinect
+{
+    // A lock-free histogram of durations in nanoseconds, in log-linear
+    // buckets like HdrHistogram: each power of two is split in 32, so a
+    // percentile is within about 1.6% of the true value. Any thread may
+    // record while another reads.
+    class LatencyHistogram
+    {
+        public:
+            struct Summary
+            {
+                uint64_t count;
+                uint64_t min;
+                uint64_t max;
+                double mean;
+                uint64_t p50;
+                uint64_t p90;
+                uint64_t p99;
+                uint64_t p999;
+            };
+
+            LatencyHistogram();
+            void record(uint64_t nanoseconds);
+            Summary summary() const;
+
+            // Not atomic with record(), a duration recorded meanwhile may
+            // be partly kept.
+            void reset();
+
+        private:
+            static size_t const SUB_BUCKET_BITS = 5;
+            static size_t const SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+
+            // Up to 2^40 ns, about 18 minutes. Longer durations land in
+            // the last bucket.
+            static size_t const MAX_BITS = 40;
+            static size_t const BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1)
+                * SUB_BUCKETS;
+
+            LatencyHistogram(LatencyHistogram const &that) = delete;
+            static size_t bucket(uint64_t nanoseconds);
+            static uint64_t bucket_value(size_t bucket);
+            uint64_t percentile(double fraction, uint64_t count) const;
+
+            std::atomic<uint64_t> counts_[BUCKETS];
+            std::atomic<uint64_t> count_;
+            std::atomic<uint64_t> sum_;
+            std::atomic<uint64_t> min_;
+            std::atomic<uint64_t> max_;
+    };
+
+    // Where the frames of a stream spend their time between the libfreenect
+    // callback on the event thread and the return of the JS callback.
+    struct StreamLatency
+    {
+        LatencyHistogram dispatch;  // To the async callback
+        LatencyHistogram callback;  // In the JS callback
+        LatencyHistogram total;     // To the JS callback returning
+
+        void reset();
+    };
+
+    struct WorldLatency
+    {
+        LatencyHistogram update;    // Pairing and queueing, loop thread
+        LatencyHistogram process;   // The kernel, worker thread
+        LatencyHistogram callback;  // In the JS callbacks
+        LatencyHistogram total;     // From publishing the depth frame to
+                                    // the JS callbacks returning
+
+        void reset();
+    };
+}
+
+
+#endif  // LATENCY_H
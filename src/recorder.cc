@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "recorder.h"
+
+
+namespace
+{
+    kinect::capture::ModeInfo mode_info(freenect_frame_mode const &,
+            int32_t);
+    size_t stream_index(kinect::capture::Stream);
+}
+
+
+namespace kinect
+{
+    Recorder::Recorder() : fd_(-1), offset_(0), has_failed_(false),
+            is_recording_(false), is_stopping_(false), queued_bytes_(0),
+            max_queue_bytes_(DEFAULT_MAX_QUEUE_BYTES), sequence_(0),
+            written_bytes_(0)
+    {
+        for (size_t stream = 0; stream < capture::STREAMS; ++stream)
+        {
+            written_[stream].store(0);
+            dropped_[stream].store(0);
+        }
+
+        uv_mutex_init(&mutex_);
+        uv_cond_init(&queued_);
+    }
+
+    Recorder::~Recorder()
+    {
+        stop();
+        uv_cond_destroy(&queued_);
+        uv_mutex_destroy(&mutex_);
+    }
+
+    bool Recorder::start(char const *const path,
+            freenect_frame_mode const &depth, freenect_frame_mode const &video,
+            size_t const max_queue_bytes)
+    {
+        if (is_recording())
+        {
+            error_ = "Already recording";
+            return false;
+        }
+
+        fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if (fd_ < 0)
+        {
+            error_ = std::string("Could not open ") + path + ": "
+                + strerror(errno);
+            return false;
+        }
+
+        offset_ = 0;
+        index_.clear();
+        has_failed_ = false;
+
+        capture::FileHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = capture::FILE_MAGIC;
+        header.version = capture::VERSION;
+        header.page_bytes = capture::PAGE_BYTES;
+        header.depth = mode_info(depth, depth.depth_format);
+        header.video = mode_info(video, video.video_format);
+
+        if (!write(&header, sizeof(header)) || !pad())
+        {
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+
+        for (size_t stream = 0; stream < capture::STREAMS; ++stream)
+        {
+            written_[stream].store(0);
+            dropped_[stream].store(0);
+        }
+        written_bytes_.store(offset_);
+
+        uv_mutex_lock(&mutex_);
+        records_.clear();
+        queued_bytes_ = 0;
+        max_queue_bytes_ = max_queue_bytes;
+        sequence_ = 0;
+        is_stopping_ = false;
+        is_recording_ = true;
+        uv_mutex_unlock(&mutex_);
+
+        uv_thread_create(&thread_, call_write, this);
+        return true;
+    }
+
+    // Writes out the queue and the index. Returns false if any write
+    // failed, in which case the file has no index.
+    bool Recorder::stop()
+    {
+        if (!is_recording())
+        {
+            return true;
+        }
+
+        uv_mutex_lock(&mutex_);
+        is_stopping_ = true;
+        uv_cond_signal(&queued_);
+        uv_mutex_unlock(&mutex_);
+
+        uv_thread_join(&thread_);
+
+        bool const is_finished = !has_failed_ && finish();
+        close(fd_);
+        fd_ = -1;
+        index_.clear();
+        index_.shrink_to_fit();
+
+        uv_mutex_lock(&mutex_);
+        is_recording_ = false;
+        records_.clear();
+        queued_bytes_ = 0;
+        uv_mutex_unlock(&mutex_);
+
+        return is_finished;
+    }
+
+    bool Recorder::is_recording() const
+    {
+        uv_mutex_lock(const_cast<uv_mutex_t *>(&mutex_));
+        bool const is_recording = is_recording_;
+        uv_mutex_unlock(const_cast<uv_mutex_t *>(&mutex_));
+        return is_recording;
+    }
+
+    std::string const &Recorder::error() const
+    {
+        return error_;
+    }
+
+    void Recorder::push(capture::Stream const stream, void const *const frame,
+            size_t const bytes, uint32_t const timestamp)
+    {
+        size_t const index = stream_index(stream);
+        std::vector<uint8_t> buffer;
+
+        uv_mutex_lock(&mutex_);
+
+        if (!is_recording_ || is_stopping_)
+        {
+            uv_mutex_unlock(&mutex_);
+            return;
+        }
+
+        if (queued_bytes_ + bytes > max_queue_bytes_)
+        {
+            uv_mutex_unlock(&mutex_);
+            dropped_[index].fetch_add(1);
+            return;
+        }
+
+        // Reserve the space, then copy outside the lock so the writer is
+        // not held up.
+        queued_bytes_ += bytes;
+
+        if (!free_frames_.empty())
+        {
+            buffer.swap(free_frames_.back());
+            free_frames_.pop_back();
+        }
+
+        uv_mutex_unlock(&mutex_);
+
+        buffer.resize(bytes);
+        memcpy(buffer.data(), frame, bytes);
+
+        Record record;
+        memset(&record.header, 0, sizeof(record.header));
+        record.header.magic = capture::RECORD_MAGIC;
+        record.header.stream = static_cast<uint32_t>(stream);
+        record.header.timestamp = timestamp;
+        record.header.host_time = uv_hrtime();
+        record.header.bytes = bytes;
+        record.frame.swap(buffer);
+
+        uv_mutex_lock(&mutex_);
+
+        if (is_stopping_)
+        {
+            // Too late for the writer, which is draining the queue.
+            uv_mutex_unlock(&mutex_);
+            dropped_[index].fetch_add(1);
+            return;
+        }
+
+        record.header.sequence = sequence_++;
+        records_.push_back(std::move(record));
+        uv_cond_signal(&queued_);
+        uv_mutex_unlock(&mutex_);
+    }
+
+    uint64_t Recorder::written(capture::Stream const stream) const
+    {
+        return written_[stream_index(stream)].load();
+    }
+
+    uint64_t Recorder::dropped(capture::Stream const stream) const
+    {
+        return dropped_[stream_index(stream)].load();
+    }
+
+    uint64_t Recorder::written_bytes() const
+    {
+        return written_bytes_.load();
+    }
+
+    size_t Recorder::queued_bytes() const
+    {
+        uv_mutex_lock(const_cast<uv_mutex_t *>(&mutex_));
+        size_t const bytes = queued_bytes_;
+        uv_mutex_unlock(const_cast<uv_mutex_t *>(&mutex_));
+        return bytes;
+    }
+
+    void Recorder::call_write(void *const recorder)
+    {
+        static_cast<Recorder *>(recorder)->write_records();
+    }
+
+    void Recorder::write_records()
+    {
+        uv_mutex_lock(&mutex_);
+
+        for (;;)
+        {
+            while (records_.empty() && !is_stopping_)
+            {
+                uv_cond_wait(&queued_, &mutex_);
+            }
+
+            if (records_.empty())
+            {
+                break;
+            }
+
+            Record record = std::move(records_.front());
+            records_.pop_front();
+            uv_mutex_unlock(&mutex_);
+
+            size_t const index = stream_index(
+                    static_cast<capture::Stream>(record.header.stream));
+
+            if (has_failed_)
+            {
+                dropped_[index].fetch_add(1);
+            }
+            else
+            {
+                capture::IndexEntry const entry = {
+                    offset_,
+                    record.header.bytes,
+                    record.header.host_time,
+                    record.header.timestamp,
+                    record.header.stream
+                };
+
+                has_failed_ = !write(&record.header, sizeof(record.header))
+                    || !write(nullptr,
+                              capture::RECORD_HEADER_BYTES
+                              - sizeof(record.header))
+                    || !write(record.frame.data(), record.frame.size())
+                    || !pad();
+
+                if (has_failed_)
+                {
+                    dropped_[index].fetch_add(1);
+                }
+                else
+                {
+                    index_.push_back(entry);
+                    written_[index].fetch_add(1);
+                    written_bytes_.store(offset_);
+                }
+            }
+
+            uv_mutex_lock(&mutex_);
+            queued_bytes_ -= record.frame.size();
+            free_frames_.push_back(std::move(record.frame));
+        }
+
+        uv_mutex_unlock(&mutex_);
+    }
+
+    // Writes zeros if data is null.
+    bool Recorder::write(void const *const data, size_t const bytes)
+    {
+        static uint8_t const zeros[capture::PAGE_BYTES] = {};
+        auto source = static_cast<uint8_t const *>(data);
+        size_t remaining = bytes;
+
+        while (remaining > 0)
+        {
+            size_t const chunk = source != nullptr ? remaining
+                : std::min<size_t>(remaining, sizeof(zeros));
+            ssize_t const written = ::write(fd_,
+                    source != nullptr ? source : zeros, chunk);
+
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (written <= 0)
+            {
+                error_ = std::string("Could not write recording: ")
+                    + strerror(errno);
+                return false;
+            }
+
+            if (source != nullptr)
+            {
+                source += written;
+            }
+            remaining -= written;
+            offset_ += written;
+        }
+
+        return true;
+    }
+
+    bool Recorder::pad()
+    {
+        return write(nullptr, capture::page_align(offset_) - offset_);
+    }
+
+    bool Recorder::finish()
+    {
+        capture::IndexTrailer const trailer = {
+            capture::INDEX_MAGIC,
+            capture::VERSION,
+            offset_,
+            index_.size()
+        };
+
+        if (!write(index_.data(), index_.size() * sizeof(index_[0]))
+                || !write(&trailer, sizeof(trailer)))
+        {
+            return false;
+        }
+
+        written_bytes_.store(offset_);
+        return true;
+    }
+}
+
+
+namespace
+{
+    kinect::capture::ModeInfo mode_info(freenect_frame_mode const &mode,
+            int32_t const format)
+    {
+        kinect::capture::ModeInfo info;
+        memset(&info, 0, sizeof(info));
+        info.resolution = mode.resolution;
+        info.format = format;
+        info.width = mode.width;
+        info.height = mode.height;
+        info.bytes = mode.bytes;
+        return info;
+    }
+
+    size_t stream_index(kinect::capture::Stream const stream)
+    {
+        return static_cast<size_t>(stream) < kinect::capture::STREAMS
+            ? static_cast<size_t>(stream) : 0;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <uv.h>
+
+#include <libfreenect.h>
+
+#include "capture_format.h"
+
+
+namespace kinect
+{
+    // Appends frames to a capture file from a writer thread. push() copies
+    // the frame into a queue bounded to max_queue_bytes and drops it when
+    // the disk falls that far behind, so the capture path never waits on
+    // I/O.
+    class Recorder
+    {
+        public:
+            static size_t const DEFAULT_MAX_QUEUE_BYTES = 64 << 20;
+
+            Recorder();
+            ~Recorder();
+
+            // Loop thread
+            bool start(char const *path, freenect_frame_mode const &depth,
+                    freenect_frame_mode const &video, size_t max_queue_bytes);
+            bool stop();
+            bool is_recording() const;
+            std::string const &error() const;
+
+            // Any thread
+            void push(capture::Stream stream, void const *frame, size_t bytes,
+                    uint32_t timestamp);
+
+            uint64_t written(capture::Stream stream) const;
+            uint64_t dropped(capture::Stream stream) const;
+            uint64_t written_bytes() const;
+            size_t queued_bytes() const;
+
+        private:
+            struct Record
+            {
+                capture::RecordHeader header;
+                std::vector<uint8_t> frame;
+            };
+
+            Recorder(Recorder const &that) = delete;
+            static void call_write(void *recorder);
+            void write_records();
+            bool write(void const *data, size_t bytes);
+            bool pad();
+            bool finish();
+
+            // Writer thread
+            int fd_;
+            uint64_t offset_;
+            std::vector<capture::IndexEntry> index_;
+            bool has_failed_;
+
+            // Shared, under mutex_
+            uv_mutex_t mutex_;
+            uv_cond_t queued_;
+            uv_thread_t thread_;
+            bool is_recording_;
+            bool is_stopping_;
+            std::deque<Record> records_;
+            std::vector<std::vector<uint8_t>> free_frames_;
+            size_t queued_bytes_;
+            size_t max_queue_bytes_;
+            uint64_t sequence_;
+
+            std::atomic<uint64_t> written_[capture::STREAMS];
+            std::atomic<uint64_t> dropped_[capture::STREAMS];
+            std::atomic<uint64_t> written_bytes_;
+            std::string error_;
+    };
+}
+
+
+#endif  // RECORDER_H
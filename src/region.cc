@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cstring>
+
+#include "region.h"
+
+
+namespace kinect
+{
+    bool operator==(Region const &a, Region const &b)
+    {
+        return a.x == b.x && a.y == b.y && a.width == b.width
+            && a.height == b.height;
+    }
+
+    bool operator!=(Region const &a, Region const &b)
+    {
+        return !(a == b);
+    }
+
+    Region full_region(size_t const width, size_t const height)
+    {
+        Region const region = { 0, 0, width, height };
+        return region;
+    }
+
+    bool is_full_region(Region const &region, size_t const width,
+            size_t const height)
+    {
+        return region.x == 0 && region.y == 0 && region.width == width
+            && region.height == height;
+    }
+
+    bool is_region_inside(Region const &region, size_t const width,
+            size_t const height)
+    {
+        return region.width > 0 && region.height > 0
+            && region.x < width && region.width <= width - region.x
+            && region.y < height && region.height <= height - region.y;
+    }
+
+    Region scale_region(Region const &region, size_t const width,
+            size_t const height, size_t const to_width,
+            size_t const to_height)
+    {
+        if (width == to_width && height == to_height)
+        {
+            return region;
+        }
+
+        size_t const x = region.x * to_width / width;
+        size_t const y = region.y * to_height / height;
+        size_t const right = ((region.x + region.width) * to_width
+                + width - 1) / width;
+        size_t const bottom = ((region.y + region.height) * to_height
+                + height - 1) / height;
+        Region const scaled = { x, y, right - x, bottom - y };
+        return scaled;
+    }
+
+    void crop_frame(uint8_t const *const src, size_t const width,
+            size_t const pixel_bytes, Region const &region, uint8_t *dst)
+    {
+        size_t const row_bytes = region.width * pixel_bytes;
+        uint8_t const *row = src + (width * region.y + region.x) * pixel_bytes;
+
+        for (size_t y = 0; y < region.height; ++y)
+        {
+            memcpy(dst, row, row_bytes);
+            row += width * pixel_bytes;
+            dst += row_bytes;
+        }
+    }
+
+    void crop_depth(uint8_t const *const src, size_t const width,
+            Region const &region, std::vector<uint8_t> const &mask,
+            uint16_t const invalid, uint8_t *dst)
+    {
+        size_t const value_max = mask.size() - 1;
+        uint8_t const *row = src + 2 * (width * region.y + region.x);
+
+        for (size_t y = 0; y < region.height; ++y)
+        {
+            for (size_t x = 0; x < region.width; ++x)
+            {
+                uint16_t const value = row[2 * x] | (row[2 * x + 1] << 8);
+                uint16_t const masked = mask[std::min<size_t>(value, value_max)]
+                    ? value : invalid;
+                dst[0] = masked & 0xff;
+                dst[1] = masked >> 8;
+                dst += 2;
+            }
+
+            row += 2 * width;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "depth.h"
+
+
+namespace kinect
+{
+    // A rectangle of pixels.
+    struct Region
+    {
+        size_t x;
+        size_t y;
+        size_t width;
+        size_t height;
+    };
+
+    bool operator==(Region const &a, Region const &b);
+    bool operator!=(Region const &a, Region const &b);
+
+    Region full_region(size_t width, size_t height);
+    bool is_full_region(Region const &region, size_t width, size_t height);
+    bool is_region_inside(Region const &region, size_t width, size_t height);
+
+    // Maps a region inside a frame of width x height onto one of
+    // to_width x to_height, widened to whole pixels so that it stays
+    // inside and never becomes empty.
+    Region scale_region(Region const &region, size_t width, size_t height,
+            size_t to_width, size_t to_height);
+
+    // Copies region out of a frame of the given width, packed rows of
+    // pixel_bytes pixels, into dst.
+    void crop_frame(uint8_t const *src, size_t width, size_t pixel_bytes,
+            Region const &region, uint8_t *dst);
+
+    // Same for 16-bit depth, replacing the values mask rejects with
+    // invalid.
+    void crop_depth(uint8_t const *src, size_t width, Region const &region,
+            std::vector<uint8_t> const &mask, uint16_t invalid,
+            uint8_t *dst);
+}
+
+
+#endif  // REGION_H
@@ -0,0 +1,282 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "replay.h"
+
+
+namespace kinect
+{
+    Replay::Replay() : data_(nullptr), size_(0), speed_(1),
+            is_looping_(false)
+    {
+        // Empty
+    }
+
+    Replay::~Replay()
+    {
+        close();
+    }
+
+    bool Replay::open(char const *const path)
+    {
+        close();
+
+        int const fd = ::open(path, O_RDONLY);
+
+        if (fd < 0)
+        {
+            error_ = std::string("Could not open ") + path + ": "
+                + strerror(errno);
+            return false;
+        }
+
+        struct stat status;
+
+        if (fstat(fd, &status) != 0
+                || size_t(status.st_size) < capture::PAGE_BYTES)
+        {
+            ::close(fd);
+            error_ = std::string("Not a recording: ") + path;
+            return false;
+        }
+
+        void *const data = mmap(nullptr, status.st_size, PROT_READ,
+                MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            error_ = std::string("Could not map ") + path + ": "
+                + strerror(errno);
+            return false;
+        }
+
+        madvise(data, status.st_size, MADV_SEQUENTIAL);
+        data_ = static_cast<uint8_t const *>(data);
+        size_ = status.st_size;
+
+        capture::FileHeader header;
+        memcpy(&header, data_, sizeof(header));
+
+        if (header.magic != capture::FILE_MAGIC
+                || header.version != capture::VERSION
+                || header.page_bytes != capture::PAGE_BYTES)
+        {
+            close();
+            error_ = std::string("Not a recording: ") + path;
+            return false;
+        }
+
+        depth_mode_ = freenect_find_depth_mode(
+                (freenect_resolution) header.depth.resolution,
+                (freenect_depth_format) header.depth.format);
+        video_mode_ = freenect_find_video_mode(
+                (freenect_resolution) header.video.resolution,
+                (freenect_video_format) header.video.format);
+
+        if (!depth_mode_.is_valid || !video_mode_.is_valid)
+        {
+            close();
+            error_ = "Unsupported modes in recording";
+            return false;
+        }
+
+        // A recording that was not stopped has no index.
+        if (!read_index() && !scan_records())
+        {
+            close();
+            error_ = "Corrupt recording";
+            return false;
+        }
+
+        if (index_.empty())
+        {
+            close();
+            error_ = "Empty recording";
+            return false;
+        }
+
+        return true;
+    }
+
+    void Replay::close()
+    {
+        stop();
+
+        if (data_ != nullptr)
+        {
+            munmap(const_cast<uint8_t *>(data_), size_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+
+        index_.clear();
+        index_.shrink_to_fit();
+    }
+
+    bool Replay::is_open() const
+    {
+        return data_ != nullptr;
+    }
+
+    std::string const &Replay::error() const
+    {
+        return error_;
+    }
+
+    freenect_frame_mode const &Replay::depth_mode() const
+    {
+        return depth_mode_;
+    }
+
+    freenect_frame_mode const &Replay::video_mode() const
+    {
+        return video_mode_;
+    }
+
+    size_t Replay::frames() const
+    {
+        return index_.size();
+    }
+
+    void Replay::set_speed(double const speed)
+    {
+        speed_ = speed;
+    }
+
+    void Replay::set_loop(bool const is_looping)
+    {
+        is_looping_ = is_looping;
+    }
+
+    // Frames are due at their recorded host times, scaled by the speed,
+    // counted from the start of each pass. As fast as possible, the thread
+    // waits for a stream rather than spinning through the recording.
+    void Replay::run()
+    {
+        if (index_.empty())
+        {
+            return;
+        }
+
+        do
+        {
+            uint64_t const start = uv_hrtime();
+            uint64_t const first = index_.front().host_time;
+
+            for (auto const &entry : index_)
+            {
+                bool const is_due = speed_ > 0
+                    ? wait_until(start + uint64_t(
+                                (entry.host_time - first) / speed_))
+                    : wait_for_streams();
+
+                if (!is_due)
+                {
+                    break;
+                }
+
+                if (is_stopping())
+                {
+                    break;
+                }
+
+                emit(static_cast<capture::Stream>(entry.stream),
+                        data_ + entry.offset + capture::RECORD_HEADER_BYTES,
+                        entry.bytes, entry.timestamp);
+            }
+        }
+        while (is_looping_ && !is_stopping());
+    }
+
+    bool Replay::read_index()
+    {
+        capture::IndexTrailer trailer;
+
+        if (size_ < capture::PAGE_BYTES + sizeof(trailer))
+        {
+            return false;
+        }
+
+        memcpy(&trailer, data_ + size_ - sizeof(trailer), sizeof(trailer));
+
+        if (trailer.magic != capture::INDEX_MAGIC
+                || trailer.version != capture::VERSION
+                || trailer.index_offset > size_ - sizeof(trailer)
+                || trailer.entries != (size_ - sizeof(trailer)
+                                       - trailer.index_offset)
+                                      / sizeof(capture::IndexEntry))
+        {
+            return false;
+        }
+
+        index_.resize(trailer.entries);
+        memcpy(index_.data(), data_ + trailer.index_offset,
+                index_.size() * sizeof(index_[0]));
+
+        for (auto const &entry : index_)
+        {
+            if (!is_record_valid(entry.offset, entry.bytes, entry.stream))
+            {
+                index_.clear();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Rebuilds the index from the records, up to the first one that is
+    // missing or cut short.
+    bool Replay::scan_records()
+    {
+        index_.clear();
+        uint64_t offset = capture::PAGE_BYTES;
+
+        while (offset + capture::RECORD_HEADER_BYTES <= size_)
+        {
+            capture::RecordHeader header;
+            memcpy(&header, data_ + offset, sizeof(header));
+
+            if (header.magic != capture::RECORD_MAGIC
+                    || !is_record_valid(offset, header.bytes, header.stream))
+            {
+                break;
+            }
+
+            capture::IndexEntry const entry = {
+                offset,
+                header.bytes,
+                header.host_time,
+                header.timestamp,
+                header.stream
+            };
+
+            index_.push_back(entry);
+            offset += capture::record_bytes(header.bytes);
+        }
+
+        return true;
+    }
+
+    bool Replay::is_record_valid(uint64_t const offset, uint64_t const bytes,
+            uint32_t const stream) const
+    {
+        if (stream >= capture::STREAMS || offset % capture::PAGE_BYTES != 0
+                || offset + capture::RECORD_HEADER_BYTES > size_
+                || bytes > size_ - offset - capture::RECORD_HEADER_BYTES)
+        {
+            return false;
+        }
+
+        freenect_frame_mode const &mode =
+            stream == static_cast<uint32_t>(capture::Stream::DEPTH)
+            ? depth_mode_ : video_mode_;
+        return bytes == uint64_t(mode.bytes);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame_source.h"
+
+
+namespace kinect
+{
+    // Plays a capture file back. The file is mapped and the frames are
+    // handed to the sink where they lie.
+    class Replay : public FrameSource
+    {
+        public:
+            Replay();
+            ~Replay();
+
+            // Loop thread
+            bool open(char const *path);
+            void close();
+            bool is_open() const;
+            std::string const &error() const;
+            freenect_frame_mode const &depth_mode() const;
+            freenect_frame_mode const &video_mode() const;
+            size_t frames() const;
+
+            // Multiple of the recorded speed, 0 for as fast as possible.
+            void set_speed(double speed);
+            void set_loop(bool is_looping);
+
+        protected:
+            void run();
+
+        private:
+            bool read_index();
+            bool scan_records();
+            bool is_record_valid(uint64_t offset, uint64_t bytes,
+                    uint32_t stream) const;
+
+            uint8_t const *data_;
+            size_t size_;
+            std::vector<capture::IndexEntry> index_;
+            freenect_frame_mode depth_mode_;
+            freenect_frame_mode video_mode_;
+            std::string error_;
+            double speed_;
+            bool is_looping_;
+    };
+}
+
+
+#endif  // REPLAY_H
@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "calibration.h"
+#include "synthetic.h"
+
+
+namespace
+{
+    // Frame rate for the animation when running as fast as possible.
+    double const NOMINAL_FPS = 30;
+
+    freenect_resolution find_resolution(size_t, size_t);
+    double dot(double const *, double const *);
+    void cross(double const *, double const *, double *);
+    uint32_t band_seed(uint32_t, uint64_t, size_t);
+    float gaussian(uint32_t &);
+}
+
+
+namespace kinect
+{
+    struct Synthetic::Scene
+    {
+        // Plane z = plane_z + plane_slope * y
+        double plane_z;
+        double plane_slope;
+        size_t spheres;
+        double centres[MAX_SPHERES][3];
+        double radii[MAX_SPHERES];
+
+        // Depth pixels, x, y, width, height
+        size_t holes;
+        double rects[2][4];
+
+        // Spheres a row of rays may hit, by distance to the plane of the
+        // row.
+        size_t row_spheres(Camera const &camera, double v,
+                size_t *hits) const;
+    };
+
+    size_t Synthetic::Scene::row_spheres(Camera const &camera,
+            double const v, size_t *const hits) const
+    {
+        double const *const m = camera.rotation;
+        double const across[3] = { m[0], m[3], m[6] };
+        double const down[3] = { m[1] * v + m[2], m[4] * v + m[5],
+            m[7] * v + m[8] };
+        double normal[3];
+        cross(across, down, normal);
+        double const length = std::sqrt(dot(normal, normal));
+        size_t count = 0;
+
+        for (size_t i = 0; i < spheres; ++i)
+        {
+            double const offset[3] = {
+                centres[i][0] - camera.origin[0],
+                centres[i][1] - camera.origin[1],
+                centres[i][2] - camera.origin[2]
+            };
+
+            if (std::abs(dot(normal, offset)) < radii[i] * length)
+            {
+                hits[count++] = i;
+            }
+        }
+
+        return count;
+    }
+
+    Synthetic::Options Synthetic::default_options()
+    {
+        Options options;
+        options.width = 640;
+        options.height = 480;
+        options.fps = 30;
+        options.noise = 0;
+        options.unit = DepthUnit::RAW;
+        options.spheres = 2;
+        options.has_holes = true;
+        options.seed = 1;
+        return options;
+    }
+
+    Synthetic::Synthetic(Options const &options) : options_(options)
+    {
+        options_.spheres = std::min(options_.spheres, MAX_SPHERES);
+
+        size_t const width = options_.width;
+        size_t const height = options_.height;
+        int8_t const framerate = int8_t(std::min(options_.fps, 127.0));
+
+        depth_mode_ = freenect_frame_mode();
+        depth_mode_.resolution = find_resolution(width, height);
+        depth_mode_.depth_format = options_.unit == DepthUnit::RAW
+            ? FREENECT_DEPTH_11BIT : FREENECT_DEPTH_MM;
+        depth_mode_.bytes = width * height * 2;
+        depth_mode_.width = width;
+        depth_mode_.height = height;
+        depth_mode_.data_bits_per_pixel =
+            options_.unit == DepthUnit::RAW ? 11 : 16;
+        depth_mode_.padding_bits_per_pixel =
+            options_.unit == DepthUnit::RAW ? 5 : 0;
+        depth_mode_.framerate = framerate;
+        depth_mode_.is_valid = 1;
+
+        video_mode_ = freenect_frame_mode();
+        video_mode_.resolution = depth_mode_.resolution;
+        video_mode_.video_format = FREENECT_VIDEO_RGB;
+        video_mode_.bytes = width * height * 3;
+        video_mode_.width = width;
+        video_mode_.height = height;
+        video_mode_.data_bits_per_pixel = 24;
+        video_mode_.framerate = framerate;
+        video_mode_.is_valid = 1;
+
+        // The default calibration, as the world frame uses it, so the video
+        // registers onto the depth.
+        Calibration const calibration = default_calibration();
+        double const scale = width / 640.0;
+        Intrinsics const *const intrinsics[2] = {
+            &calibration.depth, &calibration.video
+        };
+        Camera *const cameras[2] = { &depth_camera_, &video_camera_ };
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            cameras[i]->fx = intrinsics[i]->fx * scale;
+            cameras[i]->fy = intrinsics[i]->fy * scale;
+            cameras[i]->cx = intrinsics[i]->cx * scale;
+            cameras[i]->cy = intrinsics[i]->cy * scale;
+        }
+
+        // A video point p is R^T (p - t) in the depth camera.
+        Eigen::Matrix3d const R = calibration.R.transpose();
+        Eigen::Vector3d const origin = -R * calibration.t;
+
+        for (size_t row = 0; row < 3; ++row)
+        {
+            depth_camera_.origin[row] = 0;
+            video_camera_.origin[row] = origin(row);
+
+            for (size_t col = 0; col < 3; ++col)
+            {
+                depth_camera_.rotation[row * 3 + col] = row == col;
+                video_camera_.rotation[row * 3 + col] = R(row, col);
+            }
+        }
+
+        depth_.resize(depth_mode_.bytes);
+        video_.resize(video_mode_.bytes);
+        pool_.resize(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    Synthetic::~Synthetic()
+    {
+        stop();
+    }
+
+    freenect_frame_mode const &Synthetic::depth_mode() const
+    {
+        return depth_mode_;
+    }
+
+    freenect_frame_mode const &Synthetic::video_mode() const
+    {
+        return video_mode_;
+    }
+
+    void Synthetic::run()
+    {
+        double const fps = options_.fps > 0 ? options_.fps : NOMINAL_FPS;
+        uint64_t start = uv_hrtime();
+
+        for (uint64_t frame = 0; !is_stopping(); ++frame)
+        {
+            // Idle until a stream is enabled, then carry on from now
+            // rather than catching up on the frames missed.
+            uint64_t const idle = uv_hrtime();
+
+            if (!wait_for_streams())
+            {
+                break;
+            }
+
+            start += uv_hrtime() - idle;
+
+            if (options_.fps > 0
+                    && !wait_until(start + uint64_t(frame * 1e9 / fps)))
+            {
+                break;
+            }
+
+            // Microseconds, wrapping like the Kinect clock.
+            uint32_t const timestamp = uint32_t(uint64_t(
+                        frame_time(frame) * 1e6));
+
+            if (is_enabled(capture::Stream::DEPTH))
+            {
+                render_depth(frame, reinterpret_cast<uint16_t *>(
+                            depth_.data()));
+                emit(capture::Stream::DEPTH, depth_.data(), depth_.size(),
+                        timestamp);
+            }
+
+            if (is_enabled(capture::Stream::VIDEO))
+            {
+                render_video(frame, video_.data());
+                emit(capture::Stream::VIDEO, video_.data(), video_.size(),
+                        timestamp);
+            }
+        }
+    }
+
+    void Synthetic::render_depth(uint64_t const frame, uint16_t *const depth)
+    {
+        Scene const scene = this->scene(frame_time(frame));
+        size_t const height = options_.height;
+
+        pool_.run(BANDS, [&](size_t const band)
+                {
+                    render_depth_rows(scene,
+                            band_seed(options_.seed, frame, band), depth,
+                            height * band / BANDS,
+                            height * (band + 1) / BANDS);
+                });
+    }
+
+    void Synthetic::render_video(uint64_t const frame, uint8_t *const video)
+    {
+        Scene const scene = this->scene(frame_time(frame));
+        size_t const height = options_.height;
+
+        pool_.run(BANDS, [&](size_t const band)
+                {
+                    render_video_rows(scene, video, height * band / BANDS,
+                            height * (band + 1) / BANDS);
+                });
+    }
+
+    double Synthetic::frame_time(uint64_t const frame) const
+    {
+        return frame / (options_.fps > 0 ? options_.fps : NOMINAL_FPS);
+    }
+
+    Synthetic::Scene Synthetic::scene(double const time) const
+    {
+        double const pi = 3.14159265358979323846;
+        Scene scene;
+
+        // 2 to 3 metres, every 4 seconds
+        scene.plane_z = 2.5 + 0.5 * std::sin(2 * pi * time / 4);
+        scene.plane_slope = 0.3;
+
+        scene.spheres = options_.spheres;
+
+        for (size_t i = 0; i < scene.spheres; ++i)
+        {
+            double const angle = (0.8 + 0.4 * i) * time
+                + 2 * pi * i / scene.spheres;
+            scene.centres[i][0] = 0.5 * std::cos(angle);
+            scene.centres[i][1] = 0.25 * std::sin(angle);
+            scene.centres[i][2] = 1.2 + 0.25 * i;
+            scene.radii[i] = 0.12 + 0.03 * i;
+        }
+
+        // An eighth of the frame, sliding across every 5 seconds
+        scene.holes = options_.has_holes ? 2 : 0;
+        double const width = options_.width / 8.0;
+        double const height = options_.height / 8.0;
+
+        for (size_t i = 0; i < scene.holes; ++i)
+        {
+            double const position = std::fmod(0.2 * time + 0.5 * i, 1.0);
+            scene.rects[i][0] = position * (options_.width + width) - width;
+            scene.rects[i][1] = options_.height * (1 + 2 * i) / 4.0
+                - height / 2;
+            scene.rects[i][2] = width;
+            scene.rects[i][3] = height;
+        }
+
+        return scene;
+    }
+
+    // Depth is the z of the nearest surface along the ray of each pixel.
+    void Synthetic::render_depth_rows(Scene const &scene, uint32_t random,
+            uint16_t *const depth, size_t const begin, size_t const end) const
+    {
+        Camera const &camera = depth_camera_;
+        size_t const width = options_.width;
+        uint16_t const invalid = invalid_depth(options_.unit);
+        size_t hits[MAX_SPHERES];
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            uint16_t *const row = depth + y * width;
+            double const v = (y - camera.cy) / camera.fy;
+
+            // The plane, z = plane_z + slope * v * z, is level along a row.
+            double const facing = 1 - scene.plane_slope * v;
+            double const plane = facing > 0 ? scene.plane_z / facing
+                : INFINITY;
+            size_t const count = scene.row_spheres(camera, v, hits);
+
+            if (count == 0 && options_.noise == 0)
+            {
+                std::fill(row, row + width, std::isfinite(plane)
+                        ? metres_to_depth(options_.unit, plane) : invalid);
+            }
+            else
+            {
+                for (size_t x = 0; x < width; ++x)
+                {
+                    double const ray[3] = {
+                        (x - camera.cx) / camera.fx, v, 1
+                    };
+                    double const ray_dot = dot(ray, ray);
+                    double z = plane;
+
+                    for (size_t hit = 0; hit < count; ++hit)
+                    {
+                        size_t const i = hits[hit];
+                        double const *const c = scene.centres[i];
+                        double const b = dot(ray, c);
+                        double const disc = b * b
+                            - ray_dot * (dot(c, c) - scene.radii[i]
+                                         * scene.radii[i]);
+
+                        if (disc >= 0)
+                        {
+                            double const t = (b - std::sqrt(disc)) / ray_dot;
+                            z = t > 0 && t < z ? t : z;
+                        }
+                    }
+
+                    if (options_.noise > 0)
+                    {
+                        z += options_.noise * gaussian(random);
+                    }
+
+                    row[x] = std::isfinite(z)
+                        ? metres_to_depth(options_.unit, z) : invalid;
+                }
+            }
+
+            for (size_t i = 0; i < scene.holes; ++i)
+            {
+                double const *const rect = scene.rects[i];
+
+                if (y >= rect[1] && y < rect[1] + rect[3])
+                {
+                    size_t const first = size_t(std::max(0.0,
+                                std::ceil(rect[0])));
+                    size_t const last = size_t(std::max(0.0, std::min(
+                                    double(width), std::ceil(rect[0]
+                                                             + rect[2]))));
+                    std::fill(row + std::min(first, last), row + last,
+                            invalid);
+                }
+            }
+        }
+    }
+
+    // A checkerboard on the plane and shaded spheres, seen by the video
+    // camera.
+    void Synthetic::render_video_rows(Scene const &scene,
+            uint8_t *const video, size_t const begin, size_t const end) const
+    {
+        static uint8_t const colours[MAX_SPHERES][3] = {
+            { 230, 60, 50 }, { 60, 200, 80 }, { 60, 110, 230 },
+            { 240, 200, 40 }, { 200, 70, 210 }, { 60, 210, 210 },
+            { 250, 140, 40 }, { 240, 240, 240 }
+        };
+
+        // Squares of 20 cm, offset so the cell index is never negative.
+        double const cells = 1 / 0.2;
+        int const offset = 1 << 16;
+
+        Camera const &camera = video_camera_;
+        double const *const o = camera.origin;
+        double const *const m = camera.rotation;
+        double const normal[3] = { 0, -scene.plane_slope, 1 };
+        double const plane = scene.plane_z - dot(normal, o);
+        size_t hits[MAX_SPHERES];
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            uint8_t *pixel = video + y * options_.width * 3;
+            double const v = (y - camera.cy) / camera.fy;
+            size_t const count = scene.row_spheres(camera, v, hits);
+
+            for (size_t x = 0; x < options_.width; ++x, pixel += 3)
+            {
+                double const u = (x - camera.cx) / camera.fx;
+                double const ray[3] = {
+                    m[0] * u + m[1] * v + m[2],
+                    m[3] * u + m[4] * v + m[5],
+                    m[6] * u + m[7] * v + m[8]
+                };
+                double const facing = dot(normal, ray);
+                double nearest = facing > 0 && plane > 0 ? plane / facing
+                    : INFINITY;
+                size_t nearest_sphere = MAX_SPHERES;
+                double ray_dot = 0;
+
+                for (size_t hit = 0; hit < count; ++hit)
+                {
+                    size_t const i = hits[hit];
+                    double const *const c = scene.centres[i];
+                    double const oc[3] = { o[0] - c[0], o[1] - c[1],
+                        o[2] - c[2] };
+                    double const b = dot(oc, ray);
+                    ray_dot = dot(ray, ray);
+                    double const disc = b * b
+                        - ray_dot * (dot(oc, oc) - scene.radii[i]
+                                     * scene.radii[i]);
+
+                    if (disc >= 0)
+                    {
+                        double const t = (-b - std::sqrt(disc)) / ray_dot;
+
+                        if (t > 0 && t < nearest)
+                        {
+                            nearest = t;
+                            nearest_sphere = i;
+                        }
+                    }
+                }
+
+                if (!std::isfinite(nearest))
+                {
+                    pixel[0] = pixel[1] = pixel[2] = 0;
+                    continue;
+                }
+
+                double const p[3] = {
+                    o[0] + nearest * ray[0],
+                    o[1] + nearest * ray[1],
+                    o[2] + nearest * ray[2]
+                };
+
+                if (nearest_sphere == MAX_SPHERES)
+                {
+                    int const cell = int(p[0] * cells + offset)
+                        + int(p[1] * cells + offset);
+                    uint8_t const grey = cell & 1 ? 180 : 90;
+                    pixel[0] = grey;
+                    pixel[1] = grey;
+                    pixel[2] = uint8_t(grey * 4 / 5);
+                    continue;
+                }
+
+                // Lit from the camera
+                size_t const i = nearest_sphere;
+                double const *const c = scene.centres[i];
+                double const n[3] = {
+                    (p[0] - c[0]) / scene.radii[i],
+                    (p[1] - c[1]) / scene.radii[i],
+                    (p[2] - c[2]) / scene.radii[i]
+                };
+                double const shade = 0.25 + 0.75
+                    * std::max(0.0, -dot(n, ray) / std::sqrt(ray_dot));
+
+                for (size_t channel = 0; channel < 3; ++channel)
+                {
+                    pixel[channel] = uint8_t(colours[i][channel] * shade);
+                }
+            }
+        }
+    }
+}
+
+
+namespace
+{
+    freenect_resolution find_resolution(size_t const width,
+            size_t const height)
+    {
+        if (width == 320 && height == 240)
+        {
+            return FREENECT_RESOLUTION_LOW;
+        }
+
+        if (width == 640 && height == 480)
+        {
+            return FREENECT_RESOLUTION_MEDIUM;
+        }
+
+        if (width == 1280 && height == 1024)
+        {
+            return FREENECT_RESOLUTION_HIGH;
+        }
+
+        return FREENECT_RESOLUTION_DUMMY;
+    }
+
+    double dot(double const *const a, double const *const b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    void cross(double const *const a, double const *const b,
+            double *const out)
+    {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    // Mixes the seed, frame and band into a nonzero xorshift state.
+    uint32_t band_seed(uint32_t const seed, uint64_t const frame,
+            size_t const band)
+    {
+        uint64_t x = (uint64_t(seed) << 32) ^ (frame * 0x9e3779b97f4a7c15ull)
+            ^ band;
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        uint32_t const state = uint32_t(x);
+        return state != 0 ? state : 1;
+    }
+
+    // Sum of 4 xorshift32 uniforms, scaled to unit variance.
+    float gaussian(uint32_t &state)
+    {
+        float sum = 0;
+
+        for (size_t i = 0; i < 4; ++i)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            sum += state * (1.0f / 4294967296.0f);
+        }
+
+        return (sum - 2.0f) * 1.7320508f;
+    }
+}
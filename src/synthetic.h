@@ -0,0 +1,86 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "depth.h"
+#include "frame_source.h"
+#include "thread_pool.h"
+
+
+namespace kinect
+{
+    // Renders an animated scene whose depth is known exactly: a tilted
+    // plane moving back and forth, spheres orbiting in front of it and
+    // rectangular holes of invalid depth sliding across the frame. Any
+    // resolution and frame rate, with optional Gaussian depth noise.
+    class Synthetic : public FrameSource
+    {
+        public:
+            struct Options
+            {
+                size_t width;
+                size_t height;
+                double fps;
+                double noise;       // Standard deviation, metres
+                DepthUnit unit;
+                size_t spheres;
+                bool has_holes;
+                uint32_t seed;
+            };
+
+            static size_t const MAX_SPHERES = 8;
+
+            static Options default_options();
+
+            explicit Synthetic(Options const &options);
+            ~Synthetic();
+
+            freenect_frame_mode const &depth_mode() const;
+            freenect_frame_mode const &video_mode() const;
+
+            // Frames are numbered from 0 at the frame rate, or 30 fps when
+            // running as fast as possible. The noise depends on the frame
+            // only, not on the number of threads.
+            void render_depth(uint64_t frame, uint16_t *depth);
+            void render_video(uint64_t frame, uint8_t *video);
+
+        protected:
+            void run();
+
+        private:
+            struct Camera
+            {
+                double fx, fy, cx, cy;
+                double origin[3];
+                double rotation[9];  // Camera to depth camera
+            };
+
+            struct Scene;
+
+            // Rows are rendered in this many bands, on as many threads as
+            // there are CPUs.
+            static size_t const BANDS = 16;
+
+            double frame_time(uint64_t frame) const;
+            Scene scene(double time) const;
+            void render_depth_rows(Scene const &scene, uint32_t random,
+                    uint16_t *depth, size_t begin, size_t end) const;
+            void render_video_rows(Scene const &scene, uint8_t *video,
+                    size_t begin, size_t end) const;
+
+            Options options_;
+            freenect_frame_mode depth_mode_;
+            freenect_frame_mode video_mode_;
+            Camera depth_camera_;
+            Camera video_camera_;
+            std::vector<uint8_t> depth_;
+            std::vector<uint8_t> video_;
+            ThreadPool pool_;
+    };
+}
+
+
+#endif  // SYNTHETIC_H
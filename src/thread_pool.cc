@@ -0,0 +1,141 @@
+#include "thread_pool.h"
+
+
+namespace kinect
+{
+    ThreadPool::ThreadPool() : is_stopping_(false), generation_(0),
+            start_generation_(0), active_(0),
+            task_(nullptr), bands_(0), next_band_(0)
+    {
+        uv_mutex_init(&mutex_);
+        uv_cond_init(&started_);
+        uv_cond_init(&finished_);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        stop();
+        uv_cond_destroy(&finished_);
+        uv_cond_destroy(&started_);
+        uv_mutex_destroy(&mutex_);
+    }
+
+    void ThreadPool::resize(size_t const threads)
+    {
+        // The calling thread counts as one of the threads.
+        size_t const helpers = threads > 0 ? threads - 1 : 0;
+
+        if (helpers == threads_.size())
+        {
+            return;
+        }
+
+        stop();
+
+        is_stopping_ = false;
+        start_generation_ = generation_;
+        threads_.resize(helpers);
+
+        for (auto &thread : threads_)
+        {
+            uv_thread_create(&thread, call_work, this);
+        }
+    }
+
+    size_t ThreadPool::size() const
+    {
+        return threads_.size() + 1;
+    }
+
+    void ThreadPool::run(size_t const bands, Task const &task)
+    {
+        if (threads_.empty() || bands < 2)
+        {
+            for (size_t band = 0; band < bands; ++band)
+            {
+                task(band);
+            }
+            return;
+        }
+
+        uv_mutex_lock(&mutex_);
+        task_ = &task;
+        bands_ = bands;
+        next_band_.store(0);
+        active_ = threads_.size();
+        ++generation_;
+        uv_cond_broadcast(&started_);
+        uv_mutex_unlock(&mutex_);
+
+        drain();
+
+        uv_mutex_lock(&mutex_);
+        while (active_ > 0)
+        {
+            uv_cond_wait(&finished_, &mutex_);
+        }
+        task_ = nullptr;
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void ThreadPool::call_work(void *const pool)
+    {
+        static_cast<ThreadPool *>(pool)->work();
+    }
+
+    void ThreadPool::work()
+    {
+        uv_mutex_lock(&mutex_);
+        uint64_t seen = start_generation_;
+
+        for (;;)
+        {
+            while (!is_stopping_ && generation_ == seen)
+            {
+                uv_cond_wait(&started_, &mutex_);
+            }
+
+            if (is_stopping_)
+            {
+                break;
+            }
+
+            seen = generation_;
+            uv_mutex_unlock(&mutex_);
+
+            drain();
+
+            uv_mutex_lock(&mutex_);
+            if (--active_ == 0)
+            {
+                uv_cond_signal(&finished_);
+            }
+        }
+
+        uv_mutex_unlock(&mutex_);
+    }
+
+    void ThreadPool::drain()
+    {
+        size_t band;
+        while ((band = next_band_.fetch_add(1)) < bands_)
+        {
+            (*task_)(band);
+        }
+    }
+
+    void ThreadPool::stop()
+    {
+        uv_mutex_lock(&mutex_);
+        is_stopping_ = true;
+        uv_cond_broadcast(&started_);
+        uv_mutex_unlock(&mutex_);
+
+        for (auto &thread : threads_)
+        {
+            uv_thread_join(&thread);
+        }
+
+        threads_.clear();
+    }
+}
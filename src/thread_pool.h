@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <uv.h>
+
+
+namespace kinect
+{
+    // A fixed set of threads that split a task into bands. The calling
+    // thread works on bands too and run() returns once all are done.
+    class ThreadPool
+    {
+        public:
+            typedef std::function<void(size_t band)> Task;
+
+            ThreadPool();
+            ~ThreadPool();
+            void resize(size_t threads);
+            size_t size() const;
+            void run(size_t bands, Task const &task);
+
+        private:
+            ThreadPool(ThreadPool const &that) = delete;
+            static void call_work(void *pool);
+            void work();
+            void drain();
+            void stop();
+
+            std::vector<uv_thread_t> threads_;
+            uv_mutex_t mutex_;
+            uv_cond_t started_;
+            uv_cond_t finished_;
+            bool is_stopping_;
+            uint64_t generation_;
+            uint64_t start_generation_;
+            size_t active_;
+            Task const *task_;
+            size_t bands_;
+            std::atomic<size_t> next_band_;
+    };
+}
+
+
+#endif  // THREAD_POOL_H
@@ -0,0 +1,243 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "video_codec.h"
+
+
+namespace
+{
+    // QOI ops and sizes
+    uint8_t const QOI_OP_INDEX = 0x00;
+    uint8_t const QOI_OP_DIFF = 0x40;
+    uint8_t const QOI_OP_LUMA = 0x80;
+    uint8_t const QOI_OP_RUN = 0xc0;
+    uint8_t const QOI_OP_RGB = 0xfe;
+    size_t const QOI_HEADER_BYTES = 14;
+    size_t const QOI_PADDING_BYTES = 8;
+    size_t const QOI_MAX_RUN = 62;
+
+    void write_u32_be(uint8_t *, uint32_t);
+}
+
+
+namespace kinect
+{
+    // =====================================================================
+    // = JPEG                                                              =
+    // =====================================================================
+
+    JpegEncoder::JpegEncoder()
+    {
+        info_.err = jpeg_std_error(&error_.manager);
+        error_.manager.error_exit = exit_on_error;
+        jpeg_create_compress(&info_);
+    }
+
+    JpegEncoder::~JpegEncoder()
+    {
+        jpeg_destroy_compress(&info_);
+    }
+
+    bool JpegEncoder::encode(uint8_t const *const rgb, size_t const width,
+            size_t const height, int const quality,
+            ChromaSubsampling const subsampling, std::vector<uint8_t> &out)
+    {
+        // libjpeg writes into out while it fits, and only allocates a
+        // bigger buffer of its own for frames that are hard to compress.
+        if (out.size() < width * height * 3 + 1024)
+        {
+            out.resize(width * height * 3 + 1024);
+        }
+
+        unsigned char *buffer = out.data();
+        unsigned long bytes = out.size();
+
+        if (setjmp(error_.jump) != 0)
+        {
+            jpeg_abort_compress(&info_);
+
+            if (buffer != out.data())
+            {
+                std::free(buffer);
+            }
+
+            return false;
+        }
+
+        jpeg_mem_dest(&info_, &buffer, &bytes);
+
+        info_.image_width = JDIMENSION(width);
+        info_.image_height = JDIMENSION(height);
+        info_.input_components = 3;
+        info_.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&info_);
+        jpeg_set_quality(&info_, quality, TRUE);
+        info_.dct_method = JDCT_IFAST;
+
+        info_.comp_info[0].h_samp_factor =
+            subsampling == ChromaSubsampling::FULL ? 1 : 2;
+        info_.comp_info[0].v_samp_factor =
+            subsampling == ChromaSubsampling::BOTH ? 2 : 1;
+
+        rows_.resize(height);
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            rows_[y] = const_cast<JSAMPROW>(rgb + y * width * 3);
+        }
+
+        jpeg_start_compress(&info_, TRUE);
+        jpeg_write_scanlines(&info_, rows_.data(), JDIMENSION(height));
+        jpeg_finish_compress(&info_);
+
+        if (buffer != out.data())
+        {
+            out.assign(buffer, buffer + bytes);
+            std::free(buffer);
+        }
+        else
+        {
+            out.resize(bytes);
+        }
+
+        return true;
+    }
+
+    void JpegEncoder::exit_on_error(j_common_ptr const info)
+    {
+        Error *const error = reinterpret_cast<Error *>(info->err);
+        std::longjmp(error->jump, 1);
+    }
+
+
+    // =====================================================================
+    // = QOI                                                               =
+    // =====================================================================
+
+    void encode_qoi(uint8_t const *const rgb, size_t const width,
+            size_t const height, std::vector<uint8_t> &out)
+    {
+        size_t const pixels = width * height;
+        out.resize(QOI_HEADER_BYTES + pixels * 4 + QOI_PADDING_BYTES);
+
+        uint8_t *const begin = out.data();
+        std::memcpy(begin, "qoif", 4);
+        write_u32_be(begin + 4, uint32_t(width));
+        write_u32_be(begin + 8, uint32_t(height));
+        begin[12] = 3;  // RGB
+        begin[13] = 0;  // sRGB
+
+        // Indexed by hash, 4 bytes per colour, the 4th the opaque alpha
+        uint8_t seen[64 * 4] = {};
+        uint8_t *o = begin + QOI_HEADER_BYTES;
+        uint8_t pr = 0;
+        uint8_t pg = 0;
+        uint8_t pb = 0;
+        size_t run = 0;
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            uint8_t const r = rgb[i * 3];
+            uint8_t const g = rgb[i * 3 + 1];
+            uint8_t const b = rgb[i * 3 + 2];
+
+            if (r == pr && g == pg && b == pb)
+            {
+                if (++run == QOI_MAX_RUN)
+                {
+                    *o++ = uint8_t(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+
+                continue;
+            }
+
+            if (run > 0)
+            {
+                *o++ = uint8_t(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            size_t const hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+            uint8_t *const entry = seen + hash * 4;
+
+            if (entry[0] == r && entry[1] == g && entry[2] == b
+                    && entry[3] == 255)
+            {
+                *o++ = uint8_t(QOI_OP_INDEX | hash);
+            }
+            else
+            {
+                entry[0] = r;
+                entry[1] = g;
+                entry[2] = b;
+                entry[3] = 255;
+
+                int8_t const dr = int8_t(r - pr);
+                int8_t const dg = int8_t(g - pg);
+                int8_t const db = int8_t(b - pb);
+                int8_t const dr_dg = int8_t(dr - dg);
+                int8_t const db_dg = int8_t(db - dg);
+
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2
+                        && db <= 1)
+                {
+                    *o++ = uint8_t(QOI_OP_DIFF | (dr + 2) << 4
+                            | (dg + 2) << 2 | (db + 2));
+                }
+                else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7
+                        && db_dg >= -8 && db_dg <= 7)
+                {
+                    *o++ = uint8_t(QOI_OP_LUMA | (dg + 32));
+                    *o++ = uint8_t((dr_dg + 8) << 4 | (db_dg + 8));
+                }
+                else
+                {
+                    *o++ = QOI_OP_RGB;
+                    *o++ = r;
+                    *o++ = g;
+                    *o++ = b;
+                }
+            }
+
+            pr = r;
+            pg = g;
+            pb = b;
+        }
+
+        if (run > 0)
+        {
+            *o++ = uint8_t(QOI_OP_RUN | (run - 1));
+        }
+
+        std::memset(o, 0, QOI_PADDING_BYTES - 1);
+        o[QOI_PADDING_BYTES - 1] = 1;
+        out.resize(o + QOI_PADDING_BYTES - begin);
+    }
+
+    bool encode_video(VideoEncoding const &encoding, JpegEncoder &jpeg,
+            uint8_t const *const rgb, size_t const width,
+            size_t const height, std::vector<uint8_t> &out)
+    {
+        if (encoding.codec == VideoCodec::QOI)
+        {
+            encode_qoi(rgb, width, height, out);
+            return true;
+        }
+
+        return jpeg.encode(rgb, width, height, encoding.quality,
+                encoding.subsampling, out);
+    }
+}
+
+
+namespace
+{
+    void write_u32_be(uint8_t *const data, uint32_t const value)
+    {
+        data[0] = uint8_t(value >> 24);
+        data[1] = uint8_t(value >> 16);
+        data[2] = uint8_t(value >> 8);
+        data[3] = uint8_t(value);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef VIDEO_CODEC_H
+#define VIDEO_CODEC_H
+
+#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <jpeglib.h>
+
+
+namespace kinect
+{
+    enum class VideoCodec
+    {
+        JPEG,
+        QOI   // Lossless, https://qoiformat.org
+    };
+
+    // Chroma resolution of a JPEG
+    enum class ChromaSubsampling
+    {
+        FULL,        // 4:4:4
+        HORIZONTAL,  // 4:2:2
+        BOTH         // 4:2:0
+    };
+
+    struct VideoEncoding
+    {
+        VideoCodec codec;
+        int quality;  // JPEG, 1 to 100
+        ChromaSubsampling subsampling;
+    };
+
+    // Compresses packed RGB frames to JPEG with libjpeg, reusing its state
+    // and output buffer from frame to frame. One per thread.
+    class JpegEncoder
+    {
+        public:
+            JpegEncoder();
+            ~JpegEncoder();
+
+            // Replaces out with the JPEG, false on a libjpeg error.
+            bool encode(uint8_t const *rgb, size_t width, size_t height,
+                    int quality, ChromaSubsampling subsampling,
+                    std::vector<uint8_t> &out);
+
+        private:
+            struct Error
+            {
+                jpeg_error_mgr manager;
+                jmp_buf jump;
+            };
+
+            JpegEncoder(JpegEncoder const &that) = delete;
+            static void exit_on_error(j_common_ptr info);
+
+            jpeg_compress_struct info_;
+            Error error_;
+            std::vector<JSAMPROW> rows_;
+    };
+
+    // Replaces out with the QOI image of a packed RGB frame.
+    void encode_qoi(uint8_t const *rgb, size_t width, size_t height,
+            std::vector<uint8_t> &out);
+
+    // Encodes with the codec, JpegEncoder for JPEG.
+    bool encode_video(VideoEncoding const &encoding, JpegEncoder &jpeg,
+            uint8_t const *rgb, size_t width, size_t height,
+            std::vector<uint8_t> &out);
+}
+
+
+#endif  // VIDEO_CODEC_H
@@ -0,0 +1,133 @@
+#include <algorithm>
+
+#include <uv.h>
+
+#include "video_encoder.h"
+
+
+using node::Buffer;
+using v8::Handle;
+using v8::HandleScope;
+using v8::Value;
+
+
+namespace kinect
+{
+    VideoEncoder::Slot::Slot() : is_encoded(false), sequence(0), queued(0),
+            timestamp(0)
+    {
+        // Empty
+    }
+
+    VideoEncoder::VideoEncoder() : workers_(2), sequence_(0),
+            delivered_sequence_(0), encoded_frames_(0), skipped_frames_(0)
+    {
+        encoding_.codec = VideoCodec::JPEG;
+        encoding_.quality = 80;
+        encoding_.subsampling = ChromaSubsampling::BOTH;
+    }
+
+    void VideoEncoder::set_owner(WorkerOwner *const owner)
+    {
+        for (Slot &slot : slots_)
+        {
+            slot.worker.set_owner(owner);
+        }
+    }
+
+    // Takes effect from the next frame queued.
+    void VideoEncoder::set_encoding(VideoEncoding const &encoding,
+            size_t const workers)
+    {
+        encoding_ = encoding;
+        workers_ = std::min(std::max<size_t>(workers, 1), MAX_WORKERS);
+    }
+
+    bool VideoEncoder::queue(uint8_t const *const frame,
+            freenect_frame_mode const &mode, uint32_t const timestamp,
+            std::function<void(size_t)> done)
+    {
+        size_t worker = 0;
+
+        while (worker < workers_ && slots_[worker].worker.is_busy())
+        {
+            ++worker;
+        }
+
+        if (worker == workers_)
+        {
+            ++skipped_frames_;
+            return false;
+        }
+
+        // The ring slot may be reused as soon as the next frame is
+        // acquired, so the worker reads a copy.
+        Slot &slot = slots_[worker];
+        size_t const width = mode.width;
+        size_t const height = mode.height;
+        slot.rgb.assign(frame, frame + width * height * 3);
+        slot.sequence = ++sequence_;
+        slot.queued = uv_hrtime();
+        slot.timestamp = timestamp;
+
+        VideoEncoding const encoding = encoding_;
+
+        return slot.worker.queue(
+            [&slot, encoding, width, height]()
+            {
+                slot.is_encoded = encode_video(encoding, slot.jpeg,
+                        slot.rgb.data(), width, height, slot.encoded);
+            },
+            [this, worker, done]()
+            {
+                finish(worker, done);
+            });
+    }
+
+    void VideoEncoder::finish(size_t const worker,
+            std::function<void(size_t)> const &done)
+    {
+        Slot const &slot = slots_[worker];
+
+        if (!slot.is_encoded || slot.sequence < delivered_sequence_)
+        {
+            ++skipped_frames_;
+            return;
+        }
+
+        delivered_sequence_ = slot.sequence;
+        ++encoded_frames_;
+        latency_.record(uv_hrtime() - slot.queued);
+        done(worker);
+    }
+
+    Handle<Value> VideoEncoder::encoded(size_t const worker) const
+    {
+        HandleScope scope;
+        std::vector<uint8_t> const &encoded = slots_[worker].encoded;
+        Buffer *const buffer = Buffer::New(
+                reinterpret_cast<char const *>(encoded.data()),
+                encoded.size());
+        return scope.Close(buffer->handle_);
+    }
+
+    uint32_t VideoEncoder::timestamp(size_t const worker) const
+    {
+        return slots_[worker].timestamp;
+    }
+
+    uint64_t VideoEncoder::encoded_frames() const
+    {
+        return encoded_frames_;
+    }
+
+    uint64_t VideoEncoder::skipped_frames() const
+    {
+        return skipped_frames_;
+    }
+
+    LatencyHistogram &VideoEncoder::latency()
+    {
+        return latency_;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef VIDEO_ENCODER_H
+#define VIDEO_ENCODER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <node.h>
+#include <node_buffer.h>
+
+#include <libfreenect.h>
+
+#include "latency.h"
+#include "video_codec.h"
+#include "worker.h"
+
+
+namespace kinect
+{
+    // Compresses RGB video frames on the libuv thread pool, one frame per
+    // worker, for the encoded video callback. Frames arriving while every
+    // worker is busy are skipped, as are frames that finish after a newer
+    // one, so the callback always moves forward in time.
+    class VideoEncoder
+    {
+        public:
+            static size_t const MAX_WORKERS = 4;
+
+            VideoEncoder();
+            void set_owner(WorkerOwner *owner);
+            void set_encoding(VideoEncoding const &encoding, size_t workers);
+
+            // Copies frame, an RGB frame of mode, encodes it on a free
+            // worker and then calls done with the worker on the loop
+            // thread. Fails if every worker is busy.
+            bool queue(uint8_t const *frame, freenect_frame_mode const &mode,
+                    uint32_t timestamp, std::function<void(size_t)> done);
+
+            // A new Buffer of the frame a worker encoded
+            v8::Handle<v8::Value> encoded(size_t worker) const;
+            uint32_t timestamp(size_t worker) const;
+
+            uint64_t encoded_frames() const;
+            uint64_t skipped_frames() const;
+
+            // From queueing a frame to its encoding being ready
+            LatencyHistogram &latency();
+
+        private:
+            struct Slot
+            {
+                Slot();
+
+                Worker worker;
+                JpegEncoder jpeg;
+                std::vector<uint8_t> rgb;
+                std::vector<uint8_t> encoded;
+                bool is_encoded;
+                uint64_t sequence;
+                uint64_t queued;
+                uint32_t timestamp;
+            };
+
+            VideoEncoder(VideoEncoder const &that) = delete;
+            void finish(size_t worker, std::function<void(size_t)> const &done);
+
+            VideoEncoding encoding_;
+            size_t workers_;
+            Slot slots_[MAX_WORKERS];
+            uint64_t sequence_;
+            uint64_t delivered_sequence_;
+            uint64_t encoded_frames_;
+            uint64_t skipped_frames_;
+            LatencyHistogram latency_;
+    };
+}
+
+
+#endif  // VIDEO_ENCODER_H
@@ -0,0 +1,68 @@
+#include <cassert>
+#include <utility>
+
+#include "worker.h"
+
+
+namespace kinect
+{
+    Worker::Worker() : owner_(nullptr), is_busy_(false)
+    {
+        request_.data = this;
+    }
+
+    void Worker::set_owner(WorkerOwner *const owner)
+    {
+        assert(!is_busy_);
+        owner_ = owner;
+    }
+
+    bool Worker::is_busy() const
+    {
+        return is_busy_;
+    }
+
+    bool Worker::queue(std::function<void()> work, std::function<void()> done)
+    {
+        if (is_busy_)
+        {
+            return false;
+        }
+
+        work_ = std::move(work);
+        done_ = std::move(done);
+
+        is_busy_ = uv_queue_work(uv_default_loop(), &request_, run, after_run)
+                == 0;
+
+        if (is_busy_ && owner_ != nullptr)
+        {
+            owner_->hold();
+        }
+
+        return is_busy_;
+    }
+
+    void Worker::run(uv_work_t *const request)
+    {
+        static_cast<Worker *>(request->data)->work_();
+    }
+
+    void Worker::after_run(uv_work_t *const request, int const status)
+    {
+        auto const worker = static_cast<Worker *>(request->data);
+        assert(worker->is_busy_);
+        worker->is_busy_ = false;
+
+        // Move the done function out first, it may queue the next job. The
+        // owner is released last, as done may use it.
+        std::function<void()> done = std::move(worker->done_);
+        WorkerOwner *const owner = worker->owner_;
+        done();
+
+        if (owner != nullptr)
+        {
+            owner->release();
+        }
+    }
+}
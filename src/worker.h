@@ -0,0 +1,47 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <functional>
+
+#include <uv.h>
+
+
+namespace kinect
+{
+    // Kept alive by the workers given it while they have a job in flight,
+    // as the jobs point into it. Called on the loop thread.
+    class WorkerOwner
+    {
+        public:
+            virtual void hold() = 0;
+            virtual void release() = 0;
+
+        protected:
+            ~WorkerOwner() {}
+    };
+
+    // Runs one job at a time on the libuv thread pool. The work function
+    // runs on a pool thread and the done function back on the loop thread.
+    class Worker
+    {
+        public:
+            Worker();
+            void set_owner(WorkerOwner *owner);
+            bool is_busy() const;
+            bool queue(std::function<void()> work, std::function<void()> done);
+
+        private:
+            Worker(Worker const &that) = delete;
+            static void run(uv_work_t *request);
+            static void after_run(uv_work_t *request, int status);
+
+            WorkerOwner *owner_;
+            bool is_busy_;
+            uv_work_t request_;
+            std::function<void()> work_;
+            std::function<void()> done_;
+    };
+}
+
+
+#endif  // WORKER_H
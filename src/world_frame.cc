@@ -1,141 +1,590 @@
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <thread>
 
 #include <Eigen/Dense>
 
+#include "frame_mode.h"
 #include "world_frame.h"
 #include "util.h"
 
 
-using Eigen::Matrix3d;
-using Eigen::Vector2i;
-using Eigen::Vector3d;
 using node::Buffer;
 using v8::Arguments;
+using v8::Array;
 using v8::Context;
 using v8::Function;
 using v8::Handle;
+using v8::HandleScope;
 using v8::Local;
+using v8::Number;
+using v8::Object;
 using v8::Persistent;
+using v8::String;
 using v8::Value;
 
 
 namespace
 {
+    // Size of the default modes, and of the frames the calibration refers
+    // to.
     constexpr size_t WIDTH = 640;
     constexpr size_t HEIGHT = 480;
+
     constexpr size_t CHANNELS = 4;
-    constexpr size_t SIZE = WIDTH * HEIGHT * CHANNELS;
+    constexpr size_t DEPTH_PIXEL_BYTES = 2;
+    constexpr size_t VIDEO_PIXEL_BYTES = 3;
+
+    // Rows per band handed to the thread pool, small enough to balance
+    // the load across threads.
+    constexpr size_t BAND_HEIGHT = 16;
+
+    constexpr char const *UNSUPPORTED_MODES = "The world frame needs RGB "
+            "video and 11-bit, millimetre or registered depth";
 
+    // Depth window until the context sets one.
     constexpr double DEPTH_MIN = 0.5;
     constexpr double DEPTH_MAX = 0.8;
 
-    constexpr double FX_DEPTH = 5.9421434211923247e+02;
-    constexpr double FY_DEPTH = 5.9104053696870778e+02;
-    constexpr double CX_DEPTH = 3.3930780975300314e+02;
-    constexpr double CY_DEPTH = 2.4273913761751615e+02;
-
-    constexpr double FX_VIDEO = 5.2921508098293293e+02;
-    constexpr double FY_VIDEO = 5.2556393630057437e+02;
-    constexpr double CX_VIDEO = 3.2894272028759258e+02;
-    constexpr double CY_VIDEO = 2.6748068171871557e+02;
-
-    void depth_to_world(double, double, double, Vector3d &);
-    void world_to_video(Vector3d &, Vector2i &);
-    int w2v(double, double, double, double, int);
-    int bound(int, int, int);
-    double raw_depth_to_meters(uint16_t);
+    // Depth window while the foreground mask selects the pixels, metres
+    constexpr double FOREGROUND_MAX = 100.0;
+
+    void allocate_buffers(node::Buffer **, Persistent<Value> *, size_t,
+            size_t);
+    void release_buffers(node::Buffer **, Persistent<Value> *, size_t);
+    bool get_intrinsics(Local<Object>, char const *, kinect::Intrinsics &);
+    bool get_numbers(Local<Object>, char const *, double *, size_t);
+    Local<Object> intrinsics_to_object(kinect::Intrinsics const &);
 }
 
 
 namespace kinect
 {
-    WorldFrame::WorldFrame()
+    WorldFrame::WorldFrame() : front_(0), point_stride_(0),
+            point_buffer_stride_(0), is_supported_(true),
+            depth_bytes_(WIDTH * HEIGHT * DEPTH_PIXEL_BYTES),
+            video_bytes_(WIDTH * HEIGHT * VIDEO_PIXEL_BYTES),
+            depth_(depth_bytes_), video_(video_bytes_ + WORLD_VIDEO_PADDING),
+            threads_(std::max(1u, std::thread::hardware_concurrency())),
+            kernel_(best_world_kernel()), has_pending_settings_(false)
     {
-        // Rotation Matrix
+        settings_.calibration = default_calibration();
+        settings_.depth_min = DEPTH_MIN;
+        settings_.depth_max = DEPTH_MAX;
+        settings_.uses_foreground = false;
+        settings_.region = full_region(WIDTH, HEIGHT);
+        settings_.width = WIDTH;
+        settings_.height = HEIGHT;
+        settings_.video_width = WIDTH;
+        settings_.video_height = HEIGHT;
+        settings_.depth_unit = DepthUnit::RAW;
+        settings_.is_registered = false;
+        buffer_region_ = full_region(0, 0);
+        update_params();
+
+        for (size_t i = 0; i < BUFFERS; ++i)
+        {
+            buffers_[i] = nullptr;
+            point_buffers_[i] = nullptr;
+        }
+    }
 
-        // Row 0
-        R_(0, 0) =  9.9984628826577793e-01;
-        R_(0, 1) =  1.2635359098409581e-03;
-        R_(0, 2) = -1.7487233004436643e-02;
+    WorldFrame::~WorldFrame()
+    {
+        unset_callback();
+        unset_point_callback();
+        release_buffers(buffers_, buffer_handles_, BUFFERS);
+        release_buffers(point_buffers_, point_handles_, BUFFERS);
+    }
 
-        // Row 1
-        R_(1, 0) = -1.4779096108364480e-03;
-        R_(1, 1) =  9.9992385683542895e-01;
-        R_(1, 2) = -1.2251380107679535e-02;
+    void WorldFrame::set_owner(WorkerOwner *const owner)
+    {
+        worker_.set_owner(owner);
+    }
 
-        // Row 2
-        R_(2, 0) = 1.7470421412464927e-02;
-        R_(2, 1) = 1.2275341476520762e-02;
-        R_(2, 2) = 9.9977202419716948e-01;
 
-        // Translation Vector
-        t_(0) =  1.9985242312092553e-02;
-        t_(1) = -7.4423738761617583e-04;
-        t_(2) = -1.0916736334336222e-02;
+    // == Frame ============================================================
 
-        buffer_ = Buffer::New(SIZE);
-        buffer_handle_ = Persistent<Value>::New(buffer_->handle_);
+    bool WorldFrame::has_callbacks() const
+    {
+        return !callback_.IsEmpty() || !point_callback_.IsEmpty();
     }
 
-    WorldFrame::~WorldFrame()
+    void WorldFrame::push_depth(uint8_t const *const depth,
+            uint8_t const *const foreground, uint32_t const timestamp,
+            uint64_t const time)
     {
-        unset_callback();
-        buffer_handle_.Dispose();
-        buffer_handle_.Clear();
+        if (is_supported_ && has_callbacks())
+        {
+            uint64_t const start = uv_hrtime();
+            uint8_t *const copy = sync_.push_depth(depth, depth_bytes_,
+                    depth_bytes_, timestamp, time);
+            Settings const &settings = latest_settings();
+
+            // The background becomes invalid depth, which the kernels
+            // leave out.
+            if (settings.uses_foreground && foreground != nullptr)
+            {
+                uint16_t *const values = reinterpret_cast<uint16_t *>(copy);
+                uint16_t const invalid = invalid_depth(settings.depth_unit);
+                size_t const pixels = depth_bytes_ / DEPTH_PIXEL_BYTES;
+
+                for (size_t i = 0; i < pixels; ++i)
+                {
+                    values[i] = foreground[i] != 0 ? values[i] : invalid;
+                }
+            }
+
+            update();
+            latency_.update.record(uv_hrtime() - start);
+        }
+    }
+
+    void WorldFrame::push_video(uint8_t const *const video,
+            uint32_t const timestamp)
+    {
+        if (is_supported_ && has_callbacks())
+        {
+            uint64_t const start = uv_hrtime();
+            sync_.push_video(video, video_bytes_,
+                    video_bytes_ + WORLD_VIDEO_PADDING, timestamp);
+            update();
+            latency_.update.record(uv_hrtime() - start);
+        }
     }
 
+    void WorldFrame::update()
+    {
+        // While the worker is busy, matched pairs wait in sync_ and are
+        // superseded by newer pairs.
+        FrameSync::Frame *depth;
+        FrameSync::Frame *video;
 
-    // == Frame ============================================================
+        if (worker_.is_busy())
+        {
+            return;
+        }
+
+        apply_settings();
+
+        if (!sync_.match(depth, video))
+        {
+            return;
+        }
+
+        sync_.consume(*depth, *video);
 
-    void WorldFrame::update(uint8_t *const depth, uint8_t *const video)
+        // The pool and the output buffers only change while the worker is
+        // idle.
+        pool_.resize(threads_);
+        allocate_outputs();
+
+        depth_.swap(depth->data);
+        video_.swap(video->data);
+
+        size_t const back = (front_ + 1) % BUFFERS;
+        WorldOutput out = { buffer_region_, nullptr, nullptr,
+                point_buffer_stride_, depth->time };
+
+        if (!callback_.IsEmpty())
+        {
+            out.rgba = (uint8_t *) Buffer::Data(buffers_[back]);
+        }
+
+        if (!point_callback_.IsEmpty())
+        {
+            out.points = (float *) Buffer::Data(point_buffers_[back]);
+        }
+
+        WorldKernel const kernel = kernel_;
+
+        worker_.queue(
+            [this, kernel, out]() { process(kernel, out); },
+            [this, back, out]()
+            {
+                front_ = back;
+                call_callbacks(out);
+            });
+    }
+
+    void WorldFrame::process(WorldKernel const kernel, WorldOutput const &out)
+    {
+        uint64_t const start = uv_hrtime();
+        Region const &region = out.region;
+        size_t const bands = (region.height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+        size_t const end = region.y + region.height;
+
+        pool_.run(bands, [this, kernel, &out, end](size_t const band)
+        {
+            size_t const begin = out.region.y + band * BAND_HEIGHT;
+            world_rows(kernel, params_, tables_, depth_.data(), video_.data(),
+                    out, begin, std::min(begin + BAND_HEIGHT, end));
+        });
+
+        latency_.process.record(uv_hrtime() - start);
+    }
+
+    void WorldFrame::allocate_outputs()
     {
-        uint8_t *data = (uint8_t *) Buffer::Data(buffer_);
+        Region const &region = settings_.region;
+        size_t const pixels = region.width * region.height;
 
-        memset(data, 255, SIZE);
+        if (region != buffer_region_)
+        {
+            allocate_buffers(buffers_, buffer_handles_, BUFFERS,
+                    pixels * CHANNELS);
+            buffer_region_ = region;
+            point_buffer_stride_ = 0;
+        }
 
-        Vector3d world_point;
-        Vector2i video_point;
+        if (point_stride_ != point_buffer_stride_)
+        {
+            allocate_buffers(point_buffers_, point_handles_, BUFFERS,
+                    pixels * point_stride_ * sizeof(float));
+            point_buffer_stride_ = point_stride_;
+        }
+    }
 
-        for (size_t y = 0; y < HEIGHT; ++y)
+    void WorldFrame::update_params()
+    {
+        Calibration const &calibration = settings_.calibration;
+
+        params_.width = settings_.width;
+        params_.height = settings_.height;
+        params_.video_width = settings_.video_width;
+        params_.video_height = settings_.video_height;
+
+        params_.depth_unit = settings_.depth_unit;
+        params_.depth_min = settings_.uses_foreground ? 0.0
+            : settings_.depth_min;
+        params_.depth_max = settings_.uses_foreground ? FOREGROUND_MAX
+            : settings_.depth_max;
+
+        // The calibration is for 640 x 480 frames, scale it to the modes.
+        double const video_scale = settings_.video_width / double(WIDTH);
+        params_.fx_video = calibration.video.fx * video_scale;
+        params_.fy_video = calibration.video.fy * video_scale;
+        params_.cx_video = calibration.video.cx * video_scale;
+        params_.cy_video = calibration.video.cy * video_scale;
+
+        if (settings_.is_registered)
         {
-            for (size_t x = 0; x < WIDTH; ++x)
+            // libfreenect already registered the depth to the 640 x 480
+            // video frame, so the video pixel is the depth pixel.
+            params_.fx_depth = calibration.video.fx;
+            params_.fy_depth = calibration.video.fy;
+            params_.cx_depth = calibration.video.cx;
+            params_.cy_depth = calibration.video.cy;
+        }
+        else
+        {
+            double const depth_scale = settings_.width / double(WIDTH);
+            params_.fx_depth = calibration.depth.fx * depth_scale;
+            params_.fy_depth = calibration.depth.fy * depth_scale;
+            params_.cx_depth = calibration.depth.cx * depth_scale;
+            params_.cy_depth = calibration.depth.cy * depth_scale;
+        }
+
+        for (size_t row = 0; row < 3; ++row)
+        {
+            for (size_t col = 0; col < 3; ++col)
             {
-                // Pixel index
-                size_t const pi = WIDTH * y + x;
-
-                // Depth
-                size_t const di = 2 * pi;
-                uint16_t const l = static_cast<uint16_t>(depth[di]);
-                uint16_t const u = static_cast<uint16_t>(depth[di + 1]) << 8;
-                double const d = raw_depth_to_meters(u | l);
-                size_t const i = 4 * pi;
-
-                if (d < DEPTH_MIN || d > DEPTH_MAX)
-                    data[i + 3] = 0;
-                    continue;
-
-                // World
-                depth_to_world(x, y, d, world_point);
-                world_to_video(world_point, video_point);
-
-                // Video
-                size_t const v = 3 * (WIDTH * video_point(1) + video_point(0));
-                data[i] = video[v];
-                data[i + 1] = video[v + 1];
-                data[i + 2] = video[v + 2];
+                params_.R[3 * row + col] = settings_.is_registered
+                        ? (row == col) : calibration.R(row, col);
             }
+            params_.t[row] = settings_.is_registered ? 0 : calibration.t(row);
+        }
+
+        build_world_tables(params_, tables_);
+    }
+
+
+    // == Calibration ======================================================
+
+    void WorldFrame::set_calibration(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsObject())
+        {
+            throw_error("Expected 1 object");
+            return;
+        }
+
+        Local<Object> const object = args[0]->ToObject();
+        Calibration calibration = pending_settings().calibration;
+
+        if (!get_intrinsics(object, "depth", calibration.depth)
+                || !get_intrinsics(object, "video", calibration.video))
+        {
+            throw_error("Expected depth and video to be objects of numbers "
+                        "fx, fy, cx and cy");
+            return;
+        }
+
+        double R[9];
+        double t[3];
+
+        if (!get_numbers(object, "rotation", R, 9)
+                || !get_numbers(object, "translation", t, 3))
+        {
+            throw_error("Expected rotation to be an array of 9 numbers and "
+                        "translation an array of 3 numbers");
+            return;
+        }
+
+        if (object->Has(String::NewSymbol("rotation")))
+        {
+            for (size_t i = 0; i < 9; ++i)
+            {
+                calibration.R(i / 3, i % 3) = R[i];
+            }
+        }
+
+        if (object->Has(String::NewSymbol("translation")))
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                calibration.t(i) = t[i];
+            }
+        }
+
+        pending_settings().calibration = calibration;
+        apply_settings();
+    }
+
+    void WorldFrame::load_calibration(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsString())
+        {
+            throw_error("Expected 1 string");
+            return;
+        }
+
+        String::Utf8Value const path(args[0]);
+        Calibration calibration;
+        std::string error;
+
+        if (!kinect::load_calibration(*path, calibration, error))
+        {
+            throw_error(error.c_str());
+            return;
+        }
+
+        pending_settings().calibration = calibration;
+        apply_settings();
+    }
+
+    // The latest calibration, in the form setCalibration() takes.
+    Handle<Value> WorldFrame::get_calibration() const
+    {
+        HandleScope scope;
+        Calibration const &calibration = latest_settings().calibration;
+        Local<Object> const object = Object::New();
+        object->Set(String::NewSymbol("depth"),
+                intrinsics_to_object(calibration.depth));
+        object->Set(String::NewSymbol("video"),
+                intrinsics_to_object(calibration.video));
+
+        Local<Array> const rotation = Array::New(9);
+
+        for (size_t i = 0; i < 9; ++i)
+        {
+            rotation->Set(i, Number::New(calibration.R(i / 3, i % 3)));
+        }
+
+        Local<Array> const translation = Array::New(3);
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            translation->Set(i, Number::New(calibration.t(i)));
+        }
+
+        object->Set(String::NewSymbol("rotation"), rotation);
+        object->Set(String::NewSymbol("translation"), translation);
+        return scope.Close(object);
+    }
+
+
+    // == Depth range and region ===========================================
+
+    void WorldFrame::set_depth_range(double const min, double const max)
+    {
+        pending_settings().depth_min = min;
+        pending_settings().depth_max = max;
+        apply_settings();
+    }
+
+    void WorldFrame::clear_depth_range()
+    {
+        set_depth_range(DEPTH_MIN, DEPTH_MAX);
+    }
+
+    // Takes true to keep the foreground of the background model instead of
+    // the depth range, false to go back to the depth range.
+    void WorldFrame::set_foreground(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsBoolean())
+        {
+            throw_error("Expected 1 boolean");
+            return;
+        }
+
+        pending_settings().uses_foreground = args[0]->BooleanValue();
+        apply_settings();
+    }
+
+    void WorldFrame::set_region(Region const &region)
+    {
+        pending_settings().region = region;
+        apply_settings();
+    }
+
+    void WorldFrame::clear_region()
+    {
+        Settings const &settings = latest_settings();
+        set_region(full_region(settings.width, settings.height));
+    }
+
+    bool WorldFrame::is_region_valid(Region const &region) const
+    {
+        Settings const &settings = latest_settings();
+        return is_region_inside(region, settings.width, settings.height);
+    }
+
+
+    // == Modes ============================================================
+
+    void WorldFrame::set_modes(freenect_frame_mode const &depth,
+            freenect_frame_mode const &video)
+    {
+        Settings &settings = pending_settings();
+        DepthUnit unit = DepthUnit::RAW;
+
+        is_supported_ = find_depth_unit(depth, unit)
+                && pixel_bytes(depth) == DEPTH_PIXEL_BYTES
+                && video.video_format == FREENECT_VIDEO_RGB;
+
+        settings.width = depth.width;
+        settings.height = depth.height;
+        settings.video_width = video.width;
+        settings.video_height = video.height;
+        settings.depth_unit = unit;
+        settings.is_registered = is_registered_depth(depth);
+
+        if (!is_region_inside(settings.region, depth.width, depth.height))
+        {
+            settings.region = full_region(depth.width, depth.height);
+        }
+
+        // Frames of the previous modes are dropped, the worker keeps its
+        // own copies.
+        depth_bytes_ = depth.width * depth.height * DEPTH_PIXEL_BYTES;
+        video_bytes_ = video.width * video.height * VIDEO_PIXEL_BYTES;
+        sync_.clear();
+        apply_settings();
+    }
+
+    bool WorldFrame::is_supported() const
+    {
+        return is_supported_;
+    }
+
+
+    // == Settings =========================================================
+
+    // Settings changed since the last frame, applied by update() while the
+    // worker is idle.
+    WorldFrame::Settings &WorldFrame::pending_settings()
+    {
+        if (!has_pending_settings_)
+        {
+            pending_settings_ = settings_;
+            has_pending_settings_ = true;
+        }
+
+        return pending_settings_;
+    }
+
+    WorldFrame::Settings const &WorldFrame::latest_settings() const
+    {
+        return has_pending_settings_ ? pending_settings_ : settings_;
+    }
+
+    void WorldFrame::apply_settings()
+    {
+        if (has_pending_settings_ && !worker_.is_busy())
+        {
+            settings_ = pending_settings_;
+            has_pending_settings_ = false;
+            update_params();
+        }
+    }
+
+
+    // == Sync =============================================================
+
+    void WorldFrame::set_sync_tolerance(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsUint32())
+        {
+            throw_error("Expected 1 unsigned integer");
+            return;
+        }
+
+        sync_.set_tolerance(args[0]->Uint32Value());
+    }
+
+
+    // == Threads ==========================================================
+
+    void WorldFrame::set_threads(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsUint32()
+                || args[0]->Uint32Value() == 0)
+        {
+            throw_error("Expected 1 positive integer");
+            return;
+        }
+
+        threads_ = args[0]->Uint32Value();
+    }
+
+
+    // == Kernel ===========================================================
+
+    void WorldFrame::set_kernel(Arguments const &args)
+    {
+        if (args.Length() != 1 || !args[0]->IsString())
+        {
+            throw_error("Expected 1 string");
+            return;
+        }
+
+        String::Utf8Value const name(args[0]);
+        WorldKernel kernel;
+
+        if (strcmp(*name, "auto") == 0)
+        {
+            kernel = best_world_kernel();
+        }
+        else if (!find_world_kernel(*name, kernel))
+        {
+            throw_error("Unknown world kernel");
+            return;
+        }
+        else if (!is_world_kernel_supported(kernel))
+        {
+            throw_error("World kernel not supported by this CPU");
+            return;
         }
 
-        call_callback();
+        kernel_ = kernel;
     }
 
-    void WorldFrame::world_to_video(Vector3d const &world, Vector2i &video)
-            const
+    Handle<Value> WorldFrame::get_kernel() const
     {
-        auto const tmp = R_ * world + t_;
-        video(0) = w2v(tmp(0), tmp(2), FX_VIDEO, CX_VIDEO, WIDTH);
-        video(1) = w2v(tmp(1), tmp(2), FY_VIDEO, CY_VIDEO, HEIGHT);
+        HandleScope scope;
+        return scope.Close(String::New(world_kernel_name(kernel_)));
     }
 
 
@@ -149,6 +598,12 @@ namespace kinect
             return;
         }
 
+        if (!is_supported_)
+        {
+            throw_error(UNSUPPORTED_MODES);
+            return;
+        }
+
         callback_ = Persistent<Function>::New(Local<Function>::Cast(args[0]));
     }
 
@@ -156,51 +611,215 @@ namespace kinect
     {
         callback_.Dispose();
         callback_.Clear();
+
+        if (!has_callbacks())
+        {
+            sync_.clear();
+        }
     }
 
-    void WorldFrame::call_callback()
+    void WorldFrame::set_point_callback(Arguments const &args)
     {
-        if (!callback_.IsEmpty())
+        int const argc = args.Length();
+
+        if (argc < 1 || argc > 2 || !args[0]->IsFunction()
+                || (argc == 2 && !args[1]->IsObject()))
+        {
+            throw_error("Expected 1 function and an optional options object");
+            return;
+        }
+
+        if (!is_supported_)
+        {
+            throw_error(UNSUPPORTED_MODES);
+            return;
+        }
+
+        bool rgb = false;
+
+        if (argc == 2)
+        {
+            Local<Value> const value = args[1]->ToObject()->Get(
+                    String::NewSymbol("rgb"));
+            rgb = value->BooleanValue();
+        }
+
+        point_stride_ = rgb ? 4 : 3;
+        point_callback_ = Persistent<Function>::New(
+                Local<Function>::Cast(args[0]));
+    }
+
+    void WorldFrame::unset_point_callback()
+    {
+        point_callback_.Dispose();
+        point_callback_.Clear();
+
+        if (!has_callbacks())
+        {
+            sync_.clear();
+        }
+    }
+
+    void WorldFrame::call_callbacks(WorldOutput const &out)
+    {
+        HandleScope scope;
+        uint64_t const start = uv_hrtime();
+
+        // The callbacks may have been set, unset or the point layout changed
+        // while the worker was running.
+        if (out.rgba != nullptr && !callback_.IsEmpty())
         {
             unsigned const argc = 1;
-            Handle<Value> argv[1] = { buffer_->handle_ };
+            Handle<Value> argv[1] = { buffers_[front_]->handle_ };
             callback_->Call(Context::GetCurrent()->Global(), argc, argv);
         }
+
+        if (out.points != nullptr && !point_callback_.IsEmpty()
+                && point_stride_ == point_buffer_stride_)
+        {
+            unsigned const argc = 1;
+            Handle<Value> argv[1] = { point_buffers_[front_]->handle_ };
+            point_callback_->Call(Context::GetCurrent()->Global(), argc, argv);
+        }
+
+        uint64_t const end = uv_hrtime();
+        latency_.callback.record(end - start);
+        latency_.total.record(end - out.depth_time);
+    }
+
+    WorldLatency &WorldFrame::latency()
+    {
+        return latency_;
     }
 }
 
 
 namespace
 {
-    void depth_to_world(double const x, double const y, double const z,
-            Vector3d &world)
+    void allocate_buffers(node::Buffer **const buffers,
+            Persistent<Value> *const handles, size_t const count,
+            size_t const bytes)
     {
-        world(0) = (x - CX_DEPTH) * z / FX_DEPTH;
-        world(1) = (y - CY_DEPTH) * z / FY_DEPTH;
-        world(2) = z;
-    }
-
+        release_buffers(buffers, handles, count);
 
+        for (size_t i = 0; i < count; ++i)
+        {
+            buffers[i] = Buffer::New(bytes);
+            handles[i] = Persistent<Value>::New(buffers[i]->handle_);
+        }
+    }
 
-    int w2v(double const u, double const z, double const f, double const c,
-            int const max)
+    void release_buffers(node::Buffer **const buffers,
+            Persistent<Value> *const handles, size_t const count)
     {
-        return bound(round(u * f / z + c), 0, max - 1);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (buffers[i] != nullptr)
+            {
+                handles[i].Dispose();
+                handles[i].Clear();
+                buffers[i] = nullptr;
+            }
+        }
     }
 
-    int bound(int const x, int const min, int const max)
+    // Leaves the intrinsics alone if the key is missing and fails if it is
+    // not an object of numbers.
+    bool get_intrinsics(Local<Object> const object, char const *const key,
+            kinect::Intrinsics &intrinsics)
     {
-        return (x < min) ? min : ((x > max) ? max : x);
+        Handle<String> const name = String::NewSymbol(key);
+
+        if (!object->Has(name))
+        {
+            return true;
+        }
+
+        Local<Value> const value = object->Get(name);
+
+        if (!value->IsObject())
+        {
+            return false;
+        }
+
+        Local<Object> const fields = value->ToObject();
+
+        struct { char const *name; double *value; } const parameters[] = {
+            { "fx", &intrinsics.fx },
+            { "fy", &intrinsics.fy },
+            { "cx", &intrinsics.cx },
+            { "cy", &intrinsics.cy }
+        };
+
+        for (auto const &parameter : parameters)
+        {
+            Handle<String> const field = String::NewSymbol(parameter.name);
+
+            if (!fields->Has(field))
+            {
+                continue;
+            }
+
+            Local<Value> const number = fields->Get(field);
+
+            if (!number->IsNumber())
+            {
+                return false;
+            }
+
+            *parameter.value = number->NumberValue();
+        }
+
+        return true;
     }
 
-    double raw_depth_to_meters(uint16_t const raw_depth)
+    // Succeeds if the key is missing or holds an array of count numbers.
+    bool get_numbers(Local<Object> const object, char const *const key,
+            double *const numbers, size_t const count)
     {
-        if (raw_depth == 2047)
+        Handle<String> const name = String::NewSymbol(key);
+
+        if (!object->Has(name))
         {
-            return 0.0;
+            return true;
         }
 
-        return 1.0 / (raw_depth * -0.0030711016 + 3.3309495161);
+        Local<Value> const value = object->Get(name);
+
+        if (!value->IsArray())
+        {
+            return false;
+        }
+
+        Local<Array> const array = Local<Array>::Cast(value);
+
+        if (array->Length() != count)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            Local<Value> const number = array->Get(i);
+
+            if (!number->IsNumber())
+            {
+                return false;
+            }
+
+            numbers[i] = number->NumberValue();
+        }
+
+        return true;
     }
-}
 
+    Local<Object> intrinsics_to_object(kinect::Intrinsics const &intrinsics)
+    {
+        Local<Object> const object = Object::New();
+        object->Set(String::NewSymbol("fx"), Number::New(intrinsics.fx));
+        object->Set(String::NewSymbol("fy"), Number::New(intrinsics.fy));
+        object->Set(String::NewSymbol("cx"), Number::New(intrinsics.cx));
+        object->Set(String::NewSymbol("cy"), Number::New(intrinsics.cy));
+        return object;
+    }
+}
@@ -3,12 +3,20 @@
 
 
 #include <cstdint>
-
-#include <Eigen/Dense>
+#include <vector>
 
 #include <node.h>
 #include <node_buffer.h>
 
+#include <libfreenect.h>
+
+#include "calibration.h"
+#include "frame_sync.h"
+#include "latency.h"
+#include "thread_pool.h"
+#include "worker.h"
+#include "world_kernel.h"
+
 
 namespace kinect
 {
@@ -17,24 +25,103 @@ namespace kinect
         public:
             WorldFrame();
             ~WorldFrame();
-            void update(uint8_t *depth, uint8_t *video);
+            void set_owner(WorkerOwner *owner);
+            // foreground, if not null, is the mask of the frame, and time
+            // when it was published.
+            void push_depth(uint8_t const *depth, uint8_t const *foreground,
+                    uint32_t timestamp, uint64_t time);
+            void push_video(uint8_t const *video, uint32_t timestamp);
+            void set_sync_tolerance(v8::Arguments const &args);
+            void set_calibration(v8::Arguments const &args);
+            void load_calibration(v8::Arguments const &args);
+            v8::Handle<v8::Value> get_calibration() const;
+            void set_depth_range(double min, double max);
+            void clear_depth_range();
+            void set_foreground(v8::Arguments const &args);
+            void set_region(Region const &region);
+            void clear_region();
+            bool is_region_valid(Region const &region) const;
+            void set_modes(freenect_frame_mode const &depth,
+                    freenect_frame_mode const &video);
+            bool is_supported() const;
+            void set_threads(v8::Arguments const &args);
+            void set_kernel(v8::Arguments const &args);
+            v8::Handle<v8::Value> get_kernel() const;
             void set_callback(v8::Arguments const &args);
             void unset_callback();
-            void call_callback();
+            void set_point_callback(v8::Arguments const &args);
+            void unset_point_callback();
+            void call_callbacks(WorldOutput const &out);
+            WorldLatency &latency();
 
         private:
-            node::Buffer *buffer_;
-            v8::Persistent<v8::Value> buffer_handle_;
+            struct Settings
+            {
+                Calibration calibration;
+                double depth_min;
+                double depth_max;
+                bool uses_foreground;
+                Region region;
+
+                // From the depth and video modes
+                size_t width;
+                size_t height;
+                size_t video_width;
+                size_t video_height;
+                DepthUnit depth_unit;
+                bool is_registered;
+            };
+
+            static size_t const BUFFERS = 2;
+
+            // Double-buffered so the worker never writes the buffer most
+            // recently handed to JS. Allocated by update() for
+            // buffer_region_.
+            node::Buffer *buffers_[BUFFERS];
+            v8::Persistent<v8::Value> buffer_handles_[BUFFERS];
+            Region buffer_region_;
+            size_t front_;
             v8::Persistent<v8::Function> callback_;
 
-            Eigen::Matrix3d R_;  // Rotation
-            Eigen::Vector3d t_;  // Translation
+            // Point clouds, allocated along with buffers_ with
+            // point_stride_ floats per point.
+            node::Buffer *point_buffers_[BUFFERS];
+            v8::Persistent<v8::Value> point_handles_[BUFFERS];
+            size_t point_stride_;
+            size_t point_buffer_stride_;
+            v8::Persistent<v8::Function> point_callback_;
+
+            // Frames the worker reads, swapped in from sync_ on the loop
+            // thread.
+            bool is_supported_;
+            size_t depth_bytes_;
+            size_t video_bytes_;
+            FrameSync sync_;
+            std::vector<uint8_t> depth_;
+            std::vector<uint8_t> video_;
+            Worker worker_;
+            ThreadPool pool_;
+            size_t threads_;
+            WorldKernel kernel_;
+            WorldParams params_;
+            WorldTables tables_;
+            WorldLatency latency_;
 
-            void world_to_video(Eigen::Vector3d const &world,
-                    Eigen::Vector2i &video) const;
+            // Applied by update() between frames, while the worker is idle.
+            Settings settings_;
+            Settings pending_settings_;
+            bool has_pending_settings_;
+
+            bool has_callbacks() const;
+            void update();
+            void allocate_outputs();
+            Settings &pending_settings();
+            Settings const &latest_settings() const;
+            void apply_settings();
+            void process(WorldKernel kernel, WorldOutput const &out);
+            void update_params();
     };
 }
 
 
 #endif  // WORLD_FRAME_H
-
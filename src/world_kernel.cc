@@ -0,0 +1,522 @@
+#include <cmath>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "world_kernel.h"
+
+
+using kinect::WorldKernel;
+using kinect::WorldOutput;
+using kinect::WorldParams;
+using kinect::WorldTables;
+
+
+namespace
+{
+    constexpr uint32_t TRANSPARENT = 0x00ffffff;
+    constexpr uint32_t OPAQUE = 0xff000000;
+    constexpr uint32_t RGB_MASK = 0x00ffffff;
+
+    void rows_scalar(WorldParams const &, WorldTables const &,
+            uint8_t const *, uint8_t const *, WorldOutput const &, size_t,
+            size_t);
+    void rows_sse41(WorldParams const &, WorldTables const &,
+            uint8_t const *, uint8_t const *, WorldOutput const &, size_t,
+            size_t);
+    void rows_avx2(WorldParams const &, WorldTables const &,
+            uint8_t const *, uint8_t const *, WorldOutput const &, size_t,
+            size_t);
+    void pixel(WorldParams const &, WorldTables const &, uint8_t const *,
+            WorldOutput const &, size_t, size_t, uint16_t);
+    size_t output_index(WorldOutput const &, size_t, size_t);
+    void store_points(WorldOutput const &, size_t, size_t, float const *,
+            float const *, float const *, uint32_t const *);
+    uint16_t load_raw(uint8_t const *, size_t);
+    float clamp(float, float, float);
+}
+
+
+namespace kinect
+{
+    void build_world_tables(WorldParams const &p, WorldTables &tables)
+    {
+        size_t const values = depth_values(p.depth_unit);
+        tables.depth.resize(values);
+
+        for (size_t value = 0; value < values; ++value)
+        {
+            float const d = depth_to_metres(p.depth_unit, value);
+            tables.depth[value] = d > 0 && d >= p.depth_min
+                    && d <= p.depth_max ? d : 0;
+        }
+
+        tables.ray_x.resize(p.width);
+        tables.column_x.resize(p.width);
+        tables.column_y.resize(p.width);
+        tables.column_z.resize(p.width);
+
+        for (size_t x = 0; x < p.width; ++x)
+        {
+            float const ray = (x - p.cx_depth) / p.fx_depth;
+            tables.ray_x[x] = ray;
+            tables.column_x[x] = ray * p.R[0];
+            tables.column_y[x] = ray * p.R[3];
+            tables.column_z[x] = ray * p.R[6];
+        }
+
+        tables.ray_y.resize(p.height);
+        tables.row_x.resize(p.height);
+        tables.row_y.resize(p.height);
+        tables.row_z.resize(p.height);
+
+        for (size_t y = 0; y < p.height; ++y)
+        {
+            float const ray = (y - p.cy_depth) / p.fy_depth;
+            tables.ray_y[y] = ray;
+            tables.row_x[y] = ray * p.R[1] + p.R[2];
+            tables.row_y[y] = ray * p.R[4] + p.R[5];
+            tables.row_z[y] = ray * p.R[7] + p.R[8];
+        }
+    }
+
+    bool is_world_kernel_supported(WorldKernel const kernel)
+    {
+        switch (kernel)
+        {
+            case WorldKernel::SCALAR:
+                return true;
+            case WorldKernel::SSE41:
+                return __builtin_cpu_supports("sse4.1");
+            case WorldKernel::AVX2:
+                return __builtin_cpu_supports("avx2");
+        }
+
+        return false;
+    }
+
+    WorldKernel best_world_kernel()
+    {
+        if (is_world_kernel_supported(WorldKernel::AVX2))
+        {
+            return WorldKernel::AVX2;
+        }
+
+        if (is_world_kernel_supported(WorldKernel::SSE41))
+        {
+            return WorldKernel::SSE41;
+        }
+
+        return WorldKernel::SCALAR;
+    }
+
+    char const *world_kernel_name(WorldKernel const kernel)
+    {
+        switch (kernel)
+        {
+            case WorldKernel::SCALAR:
+                return "scalar";
+            case WorldKernel::SSE41:
+                return "sse4.1";
+            case WorldKernel::AVX2:
+                return "avx2";
+        }
+
+        return "unknown";
+    }
+
+    bool find_world_kernel(char const *const name, WorldKernel &kernel)
+    {
+        WorldKernel const kernels[] = {
+            WorldKernel::SCALAR,
+            WorldKernel::SSE41,
+            WorldKernel::AVX2
+        };
+
+        for (auto const candidate : kernels)
+        {
+            if (strcmp(name, world_kernel_name(candidate)) == 0)
+            {
+                kernel = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void world_rows(WorldKernel const kernel, WorldParams const &params,
+            WorldTables const &tables, uint8_t const *const depth,
+            uint8_t const *const video, WorldOutput const &out,
+            size_t const begin, size_t const end)
+    {
+        switch (kernel)
+        {
+            case WorldKernel::SCALAR:
+                rows_scalar(params, tables, depth, video, out, begin, end);
+                break;
+            case WorldKernel::SSE41:
+                rows_sse41(params, tables, depth, video, out, begin, end);
+                break;
+            case WorldKernel::AVX2:
+                rows_avx2(params, tables, depth, video, out, begin, end);
+                break;
+        }
+    }
+}
+
+
+namespace
+{
+    // = Scalar ============================================================
+
+    // The reference implementation, every vectorized kernel performs the
+    // same operations in the same order.
+    void pixel(WorldParams const &p, WorldTables const &tables,
+            uint8_t const *const video, WorldOutput const &out,
+            size_t const x, size_t const y, uint16_t const raw)
+    {
+        size_t const oi = output_index(out, x, y);
+        size_t const value_max = tables.depth.size() - 1;
+        float const d = tables.depth[raw < value_max ? raw : value_max];
+        bool const valid = d > 0.0f;
+        uint32_t rgba = TRANSPARENT;
+
+        if (valid && (out.rgba != nullptr || out.point_stride == 4))
+        {
+            // Depth camera to video camera
+            float const cx = d * (tables.column_x[x] + tables.row_x[y])
+                    + p.t[0];
+            float const cy = d * (tables.column_y[x] + tables.row_y[y])
+                    + p.t[1];
+            float const cz = d * (tables.column_z[x] + tables.row_z[y])
+                    + p.t[2];
+
+            // Project and clamp
+            float const u = cx * p.fx_video / cz + p.cx_video;
+            float const v = cy * p.fy_video / cz + p.cy_video;
+
+            int const ui = static_cast<int>(std::nearbyint(
+                    clamp(u, 0.0f, p.video_width - 1.0f)));
+            int const vi = static_cast<int>(std::nearbyint(
+                    clamp(v, 0.0f, p.video_height - 1.0f)));
+
+            uint8_t const *const rgb = video + 3 * (p.video_width * vi + ui);
+            rgba = rgb[0] | (rgb[1] << 8) | (rgb[2] << 16) | OPAQUE;
+        }
+
+        if (out.rgba != nullptr)
+        {
+            memcpy(out.rgba + 4 * oi, &rgba, 4);
+        }
+
+        if (out.points != nullptr)
+        {
+            float const nan = NAN;
+            float const px = valid ? d * tables.ray_x[x] : nan;
+            float const py = valid ? d * tables.ray_y[y] : nan;
+            float const pz = valid ? d : nan;
+            store_points(out, oi, 1, &px, &py, &pz, &rgba);
+        }
+    }
+
+    void rows_scalar(WorldParams const &p, WorldTables const &tables,
+            uint8_t const *const depth, uint8_t const *const video,
+            WorldOutput const &out, size_t const begin, size_t const end)
+    {
+        size_t const x_end = out.region.x + out.region.width;
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            for (size_t x = out.region.x; x < x_end; ++x)
+            {
+                pixel(p, tables, video, out, x, y,
+                        load_raw(depth, p.width * y + x));
+            }
+        }
+    }
+
+    // Interleaves count points starting at output pixel oi.
+    void store_points(WorldOutput const &out, size_t const oi,
+            size_t const count, float const *const x, float const *const y,
+            float const *const z, uint32_t const *const rgba)
+    {
+        float *point = out.points + out.point_stride * oi;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            point[0] = x[i];
+            point[1] = y[i];
+            point[2] = z[i];
+
+            if (out.point_stride == 4)
+            {
+                memcpy(&point[3], &rgba[i], 4);
+            }
+
+            point += out.point_stride;
+        }
+    }
+
+    size_t output_index(WorldOutput const &out, size_t const x,
+            size_t const y)
+    {
+        return out.region.width * (y - out.region.y) + x - out.region.x;
+    }
+
+    uint16_t load_raw(uint8_t const *const depth, size_t const pi)
+    {
+        return depth[2 * pi] | (depth[2 * pi + 1] << 8);
+    }
+
+    // NaN clamps to min, like the vectorized max/min below.
+    float clamp(float const x, float const min, float const max)
+    {
+        return x > min ? (x < max ? x : max) : min;
+    }
+
+
+    // = SSE4.1 ============================================================
+
+    __attribute__((target("sse4.1")))
+    void rows_sse41(WorldParams const &p, WorldTables const &tables,
+            uint8_t const *const depth, uint8_t const *const video,
+            WorldOutput const &out, size_t const begin, size_t const end)
+    {
+        __m128i const raw_max = _mm_set1_epi32(tables.depth.size() - 1);
+        __m128 const zero = _mm_setzero_ps();
+        __m128 const nan = _mm_set1_ps(NAN);
+        __m128 const fx_video = _mm_set1_ps(p.fx_video);
+        __m128 const fy_video = _mm_set1_ps(p.fy_video);
+        __m128 const cx_video = _mm_set1_ps(p.cx_video);
+        __m128 const cy_video = _mm_set1_ps(p.cy_video);
+        __m128 const u_max = _mm_set1_ps(p.video_width - 1.0f);
+        __m128 const v_max = _mm_set1_ps(p.video_height - 1.0f);
+        __m128i const stride = _mm_set1_epi32(p.video_width);
+        __m128i const three = _mm_set1_epi32(3);
+        __m128i const transparent = _mm_set1_epi32(TRANSPARENT);
+        __m128 const t0 = _mm_set1_ps(p.t[0]);
+        __m128 const t1 = _mm_set1_ps(p.t[1]);
+        __m128 const t2 = _mm_set1_ps(p.t[2]);
+        float const *const lut = tables.depth.data();
+        bool const needs_colour = out.rgba != nullptr || out.point_stride == 4;
+        size_t const x_end = out.region.x + out.region.width;
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            __m128 const row_x = _mm_set1_ps(tables.row_x[y]);
+            __m128 const row_y = _mm_set1_ps(tables.row_y[y]);
+            __m128 const row_z = _mm_set1_ps(tables.row_z[y]);
+            __m128 const ray_y = _mm_set1_ps(tables.ray_y[y]);
+            size_t x = out.region.x;
+
+            for (; x + 4 <= x_end; x += 4)
+            {
+                size_t const pi = p.width * y + x;
+                size_t const oi = output_index(out, x, y);
+
+                // Unpack and look up depth, 0 when out of range
+                alignas(16) uint32_t raw[4];
+                _mm_store_si128((__m128i *) raw, _mm_min_epu32(raw_max,
+                        _mm_cvtepu16_epi32(_mm_loadl_epi64(
+                            (__m128i const *) (depth + 2 * pi)))));
+                __m128 const d = _mm_setr_ps(lut[raw[0]], lut[raw[1]],
+                        lut[raw[2]], lut[raw[3]]);
+                __m128 const valid = _mm_cmpgt_ps(d, zero);
+                bool const any_valid = _mm_movemask_ps(valid) != 0;
+
+                alignas(16) uint32_t rgba[4];
+                _mm_store_si128((__m128i *) rgba, transparent);
+
+                if (any_valid && needs_colour)
+                {
+                    // Depth camera to video camera
+                    __m128 const cx = _mm_add_ps(_mm_mul_ps(d, _mm_add_ps(
+                            _mm_loadu_ps(&tables.column_x[x]), row_x)), t0);
+                    __m128 const cy = _mm_add_ps(_mm_mul_ps(d, _mm_add_ps(
+                            _mm_loadu_ps(&tables.column_y[x]), row_y)), t1);
+                    __m128 const cz = _mm_add_ps(_mm_mul_ps(d, _mm_add_ps(
+                            _mm_loadu_ps(&tables.column_z[x]), row_z)), t2);
+
+                    // Project and clamp
+                    __m128 const u = _mm_add_ps(_mm_div_ps(
+                            _mm_mul_ps(cx, fx_video), cz), cx_video);
+                    __m128 const v = _mm_add_ps(_mm_div_ps(
+                            _mm_mul_ps(cy, fy_video), cz), cy_video);
+                    __m128i const ui = _mm_cvtps_epi32(_mm_round_ps(
+                            _mm_min_ps(_mm_max_ps(u, zero), u_max),
+                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+                    __m128i const vi = _mm_cvtps_epi32(_mm_round_ps(
+                            _mm_min_ps(_mm_max_ps(v, zero), v_max),
+                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+
+                    // Gather RGB
+                    alignas(16) uint32_t index[4];
+                    _mm_store_si128((__m128i *) index, _mm_mullo_epi32(three,
+                            _mm_add_epi32(_mm_mullo_epi32(vi, stride), ui)));
+
+                    alignas(16) uint32_t rgb[4];
+                    for (size_t i = 0; i < 4; ++i)
+                    {
+                        memcpy(&rgb[i], video + index[i], 4);
+                    }
+
+                    __m128i const opaque = _mm_or_si128(_mm_and_si128(
+                            _mm_load_si128((__m128i const *) rgb),
+                            _mm_set1_epi32(RGB_MASK)),
+                            _mm_set1_epi32(OPAQUE));
+
+                    _mm_store_si128((__m128i *) rgba,
+                            _mm_castps_si128(_mm_blendv_ps(
+                                _mm_castsi128_ps(transparent),
+                                _mm_castsi128_ps(opaque), valid)));
+                }
+
+                if (out.rgba != nullptr)
+                {
+                    _mm_storeu_si128((__m128i *) (out.rgba + 4 * oi),
+                            _mm_load_si128((__m128i const *) rgba));
+                }
+
+                if (out.points != nullptr)
+                {
+                    alignas(16) float px[4];
+                    alignas(16) float py[4];
+                    alignas(16) float pz[4];
+                    _mm_store_ps(px, _mm_blendv_ps(nan, _mm_mul_ps(d,
+                            _mm_loadu_ps(&tables.ray_x[x])), valid));
+                    _mm_store_ps(py, _mm_blendv_ps(nan,
+                            _mm_mul_ps(d, ray_y), valid));
+                    _mm_store_ps(pz, _mm_blendv_ps(nan, d, valid));
+                    store_points(out, oi, 4, px, py, pz, rgba);
+                }
+            }
+
+            for (; x < x_end; ++x)
+            {
+                pixel(p, tables, video, out, x, y,
+                        load_raw(depth, p.width * y + x));
+            }
+        }
+    }
+
+
+    // = AVX2 ==============================================================
+
+    __attribute__((target("avx2")))
+    void rows_avx2(WorldParams const &p, WorldTables const &tables,
+            uint8_t const *const depth, uint8_t const *const video,
+            WorldOutput const &out, size_t const begin, size_t const end)
+    {
+        __m256i const raw_max = _mm256_set1_epi32(tables.depth.size() - 1);
+        __m256 const zero = _mm256_setzero_ps();
+        __m256 const nan = _mm256_set1_ps(NAN);
+        __m256 const fx_video = _mm256_set1_ps(p.fx_video);
+        __m256 const fy_video = _mm256_set1_ps(p.fy_video);
+        __m256 const cx_video = _mm256_set1_ps(p.cx_video);
+        __m256 const cy_video = _mm256_set1_ps(p.cy_video);
+        __m256 const u_max = _mm256_set1_ps(p.video_width - 1.0f);
+        __m256 const v_max = _mm256_set1_ps(p.video_height - 1.0f);
+        __m256i const stride = _mm256_set1_epi32(p.video_width);
+        __m256i const three = _mm256_set1_epi32(3);
+        __m256i const rgb_mask = _mm256_set1_epi32(RGB_MASK);
+        __m256i const opaque = _mm256_set1_epi32(OPAQUE);
+        __m256i const transparent = _mm256_set1_epi32(TRANSPARENT);
+        __m256 const t0 = _mm256_set1_ps(p.t[0]);
+        __m256 const t1 = _mm256_set1_ps(p.t[1]);
+        __m256 const t2 = _mm256_set1_ps(p.t[2]);
+        float const *const lut = tables.depth.data();
+        bool const needs_colour = out.rgba != nullptr || out.point_stride == 4;
+        size_t const x_end = out.region.x + out.region.width;
+
+        for (size_t y = begin; y < end; ++y)
+        {
+            __m256 const row_x = _mm256_set1_ps(tables.row_x[y]);
+            __m256 const row_y = _mm256_set1_ps(tables.row_y[y]);
+            __m256 const row_z = _mm256_set1_ps(tables.row_z[y]);
+            __m256 const ray_y = _mm256_set1_ps(tables.ray_y[y]);
+            size_t x = out.region.x;
+
+            for (; x + 8 <= x_end; x += 8)
+            {
+                size_t const pi = p.width * y + x;
+                size_t const oi = output_index(out, x, y);
+
+                // Unpack and look up depth, 0 when out of range
+                __m256i const raw = _mm256_min_epu32(raw_max,
+                        _mm256_cvtepu16_epi32(_mm_loadu_si128(
+                            (__m128i const *) (depth + 2 * pi))));
+                __m256 const d = _mm256_i32gather_ps(lut, raw, 4);
+                __m256 const valid = _mm256_cmp_ps(d, zero, _CMP_GT_OQ);
+                bool const any_valid = _mm256_movemask_ps(valid) != 0;
+                __m256i rgba = transparent;
+
+                if (any_valid && needs_colour)
+                {
+                    // Depth camera to video camera
+                    __m256 const cx = _mm256_add_ps(_mm256_mul_ps(d,
+                            _mm256_add_ps(_mm256_loadu_ps(&tables.column_x[x]),
+                                          row_x)), t0);
+                    __m256 const cy = _mm256_add_ps(_mm256_mul_ps(d,
+                            _mm256_add_ps(_mm256_loadu_ps(&tables.column_y[x]),
+                                          row_y)), t1);
+                    __m256 const cz = _mm256_add_ps(_mm256_mul_ps(d,
+                            _mm256_add_ps(_mm256_loadu_ps(&tables.column_z[x]),
+                                          row_z)), t2);
+
+                    // Project and clamp
+                    __m256 const u = _mm256_add_ps(_mm256_div_ps(
+                            _mm256_mul_ps(cx, fx_video), cz), cx_video);
+                    __m256 const v = _mm256_add_ps(_mm256_div_ps(
+                            _mm256_mul_ps(cy, fy_video), cz), cy_video);
+                    __m256i const ui = _mm256_cvtps_epi32(_mm256_round_ps(
+                            _mm256_min_ps(_mm256_max_ps(u, zero), u_max),
+                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+                    __m256i const vi = _mm256_cvtps_epi32(_mm256_round_ps(
+                            _mm256_min_ps(_mm256_max_ps(v, zero), v_max),
+                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+
+                    // Gather RGB, masked lanes keep the transparent colour
+                    __m256i const index = _mm256_mullo_epi32(three,
+                            _mm256_add_epi32(_mm256_mullo_epi32(vi, stride),
+                                             ui));
+                    __m256i const rgb = _mm256_mask_i32gather_epi32(
+                            transparent, (int const *) video, index,
+                            _mm256_castps_si256(valid), 1);
+
+                    rgba = _mm256_castps_si256(_mm256_blendv_ps(
+                            _mm256_castsi256_ps(transparent),
+                            _mm256_castsi256_ps(_mm256_or_si256(
+                                _mm256_and_si256(rgb, rgb_mask), opaque)),
+                            valid));
+                }
+
+                if (out.rgba != nullptr)
+                {
+                    _mm256_storeu_si256((__m256i *) (out.rgba + 4 * oi), rgba);
+                }
+
+                if (out.points != nullptr)
+                {
+                    alignas(32) float px[8];
+                    alignas(32) float py[8];
+                    alignas(32) float pz[8];
+                    alignas(32) uint32_t colours[8];
+                    _mm256_store_ps(px, _mm256_blendv_ps(nan, _mm256_mul_ps(d,
+                            _mm256_loadu_ps(&tables.ray_x[x])), valid));
+                    _mm256_store_ps(py, _mm256_blendv_ps(nan,
+                            _mm256_mul_ps(d, ray_y), valid));
+                    _mm256_store_ps(pz, _mm256_blendv_ps(nan, d, valid));
+                    _mm256_store_si256((__m256i *) colours, rgba);
+                    store_points(out, oi, 8, px, py, pz, colours);
+                }
+            }
+
+            for (; x < x_end; ++x)
+            {
+                pixel(p, tables, video, out, x, y,
+                        load_raw(depth, p.width * y + x));
+            }
+        }
+    }
+}
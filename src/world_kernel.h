@@ -0,0 +1,114 @@
+#ifndef WORLD_KERNEL_H
+#define WORLD_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "depth.h"
+#include "region.h"
+
+
+namespace kinect
+{
+    // Everything the kernel needs to register a video frame onto a depth
+    // frame, in single precision.
+    struct WorldParams
+    {
+        size_t width;
+        size_t height;
+        size_t video_width;
+        size_t video_height;
+
+        DepthUnit depth_unit;
+        float depth_min;
+        float depth_max;
+
+        float fx_depth;
+        float fy_depth;
+        float cx_depth;
+        float cy_depth;
+
+        float fx_video;
+        float fy_video;
+        float cx_video;
+        float cy_video;
+
+        float R[9];  // Rotation, row-major
+        float t[3];  // Translation
+    };
+
+    // Per-frame invariants derived from WorldParams, rebuilt only when the
+    // parameters change. A depth camera pixel (x, y) with depth d lands in
+    // the video camera at d * (column(x) + row(y)) + t.
+    struct WorldTables
+    {
+        // Depth value to metres, 0 where invalid or out of range, with
+        // depth_values() entries
+        std::vector<float> depth;
+
+        // Ray through each column and row of the depth camera at 1 metre
+        std::vector<float> ray_x;
+        std::vector<float> ray_y;
+
+        // Ray through each column rotated by the first column of R
+        std::vector<float> column_x;
+        std::vector<float> column_y;
+        std::vector<float> column_z;
+
+        // Ray through each row rotated by the second column of R, plus the
+        // third column of R
+        std::vector<float> row_x;
+        std::vector<float> row_y;
+        std::vector<float> row_z;
+    };
+
+    // Where the kernel writes. Either output may be null. Only the pixels
+    // in region are written, packed as a region-sized frame.
+    struct WorldOutput
+    {
+        Region region;
+
+        // RGBA world frame, transparent white where the depth is invalid
+        uint8_t *rgba;
+
+        // Organized point cloud in metres in the depth camera frame, NaN
+        // where the depth is invalid. With a stride of 4 the fourth float
+        // holds the RGBA colour of the point.
+        float *points;
+        size_t point_stride;
+
+        // When the depth frame was published, for the latency stats
+        uint64_t depth_time;
+    };
+
+    enum class WorldKernel
+    {
+        SCALAR,
+        SSE41,
+        AVX2
+    };
+
+    // Bytes read past the end of the video frame by the vectorized
+    // kernels, which load each RGB triple as one 32-bit word.
+    size_t const WORLD_VIDEO_PADDING = 4;
+
+    void build_world_tables(WorldParams const &params, WorldTables &tables);
+
+    bool is_world_kernel_supported(WorldKernel kernel);
+    WorldKernel best_world_kernel();
+    char const *world_kernel_name(WorldKernel kernel);
+    bool find_world_kernel(char const *name, WorldKernel &kernel);
+
+    // Writes rows [begin, end) of the outputs, which must lie within the
+    // output region. depth holds 16-bit
+    // little-endian depth values and video packed RGB, padded by
+    // WORLD_VIDEO_PADDING bytes.
+    void world_rows(WorldKernel kernel, WorldParams const &params,
+            WorldTables const &tables, uint8_t const *depth,
+            uint8_t const *video, WorldOutput const &out, size_t begin,
+            size_t end);
+}
+
+
+#endif  // WORLD_KERNEL_H
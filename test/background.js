@@ -0,0 +1,85 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Background", function() {
+  var context = null;
+
+  afterEach(function() {
+    if (context) {
+      context.stopProcessingEvents();
+      context.disable();
+      context = null;
+    }
+  });
+
+  it("delivers 8-bit masks while learning", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic();
+    context.learnBackground({frames: 3});
+    context.setForegroundCallback(function (mask) {
+      assert.equal(mask.length, 640 * 480);
+
+      for (var i = 0; i < mask.length; i++) {
+        assert(mask[i] == 0 || mask[i] == 255);
+      }
+
+      var stats = context.getStats().background;
+      assert(stats.frames > 0);
+
+      if (stats.frames >= 3) {
+        assert(!stats.learning);
+        context.stopDepth();
+        done();
+      }
+    });
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("packs masks into bits", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic();
+    context.learnBackground({frames: 1});
+    context.setForegroundCallback(function (mask) {
+      assert.equal(mask.length, 640 * 480 / 8);
+      context.stopDepth();
+      done();
+    }, {bits: 1});
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("can be frozen and reset", function () {
+    context = new Kinect.Context;
+    context.enableSynthetic();
+    context.learnBackground({continuous: true});
+    assert(context.getStats().background.learning);
+    context.freezeBackground();
+    assert(!context.getStats().background.learning);
+    context.resetBackground();
+    assert.equal(context.getStats().background.frames, 0);
+    context.setWorldForeground(true);
+    context.setWorldForeground(false);
+  });
+
+  it("rejects invalid options", function () {
+    context = new Kinect.Context;
+    context.enableSynthetic();
+
+    [{frames: 0}, {frames: 65536}, {deviations: -1}, {margin: -1}]
+        .forEach(function (options) {
+      assert.throws(function () {
+        context.learnBackground(options);
+      });
+    });
+
+    assert.throws(function () {
+      context.setForegroundCallback(function () {}, {bits: 4});
+    });
+    assert.throws(function () {
+      context.setWorldForeground(1);
+    });
+  });
+});
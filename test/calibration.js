@@ -0,0 +1,121 @@
+var Kinect = require('..');
+var assert = require('assert');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+describe("Calibration", function () {
+  var context;
+
+  beforeEach(function () {
+    context = new Kinect.Context;
+  });
+
+  it("accepts a partial calibration", function () {
+    var before = context.getCalibration();
+    context.setCalibration({
+      depth: {fx: 594.2, cx: 339.3},
+      translation: [0.02, 0, -0.01]
+    });
+
+    var calibration = context.getCalibration();
+    assert.equal(calibration.depth.fx, 594.2);
+    assert.equal(calibration.depth.cx, 339.3);
+    assert.equal(calibration.depth.fy, before.depth.fy);
+    assert.deepEqual(calibration.video, before.video);
+    assert.deepEqual(calibration.rotation, before.rotation);
+    assert.deepEqual(calibration.translation, [0.02, 0, -0.01]);
+  });
+
+  it("throws an error when an intrinsic is not a number", function () {
+    assert.throws(function () {
+      context.setCalibration({video: {fx: 'wide'}});
+    });
+  });
+
+  it("throws an error when the rotation does not have 9 numbers", function () {
+    assert.throws(function () {
+      context.setCalibration({rotation: [1, 0, 0]});
+    });
+  });
+
+  it("loads an OpenCV YAML calibration file", function () {
+    var file = path.join(os.tmpdir(), 'kinect_calibration.yml');
+    fs.writeFileSync(file, [
+      '%YAML:1.0',
+      'rgb_intrinsics: !!opencv-matrix',
+      '   rows: 3',
+      '   cols: 3',
+      '   dt: d',
+      '   data: [ 529.2, 0., 328.9, 0., 525.6, 267.5, 0., 0., 1. ]',
+      'depth_intrinsics: !!opencv-matrix',
+      '   rows: 3',
+      '   cols: 3',
+      '   dt: d',
+      '   data: [ 594.2, 0., 339.3, 0., 591.0, 242.7, 0., 0., 1. ]',
+      'R: !!opencv-matrix',
+      '   rows: 3',
+      '   cols: 3',
+      '   dt: d',
+      '   data: [ 1., 0., 0., 0., 1., 0., 0., 0., 1. ]',
+      'T: !!opencv-matrix',
+      '   rows: 3',
+      '   cols: 1',
+      '   dt: d',
+      '   data: [ 0.02, 0., -0.01 ]',
+      ''
+    ].join('\n'));
+    context.loadCalibration(file);
+    fs.unlinkSync(file);
+
+    var calibration = context.getCalibration();
+    assert.deepEqual(calibration.depth,
+                     {fx: 594.2, fy: 591.0, cx: 339.3, cy: 242.7});
+    assert.deepEqual(calibration.video,
+                     {fx: 529.2, fy: 525.6, cx: 328.9, cy: 267.5});
+    assert.deepEqual(calibration.rotation, [1, 0, 0, 0, 1, 0, 0, 0, 1]);
+    assert.deepEqual(calibration.translation, [0.02, 0, -0.01]);
+  });
+
+  it("loads an OpenCV XML calibration file", function () {
+    var file = path.join(os.tmpdir(), 'kinect_calibration.xml');
+    function matrix(name, rows, cols, data) {
+      return [
+        '<' + name + ' type_id="opencv-matrix">',
+        '  <rows>' + rows + '</rows>',
+        '  <cols>' + cols + '</cols>',
+        '  <dt>d</dt>',
+        '  <data>',
+        '    ' + data + '</data></' + name + '>'
+      ].join('\n');
+    }
+    fs.writeFileSync(file, [
+      '<?xml version="1.0"?>',
+      '<opencv_storage>',
+      matrix('rgb_intrinsics', 3, 3,
+             '529.2 0. 328.9 0. 525.6 267.5 0. 0. 1.'),
+      matrix('depth_intrinsics', 3, 3,
+             '594.2 0. 339.3 0. 591.0 242.7 0. 0. 1.'),
+      matrix('R', 3, 3, '0. -1. 0. 1. 0. 0. 0. 0. 1.'),
+      matrix('T', 3, 1, '0.03 0.001 -0.02'),
+      '</opencv_storage>',
+      ''
+    ].join('\n'));
+    context.loadCalibration(file);
+    fs.unlinkSync(file);
+
+    var calibration = context.getCalibration();
+    assert.deepEqual(calibration.depth,
+                     {fx: 594.2, fy: 591.0, cx: 339.3, cy: 242.7});
+    assert.deepEqual(calibration.video,
+                     {fx: 529.2, fy: 525.6, cx: 328.9, cy: 267.5});
+    assert.deepEqual(calibration.rotation, [0, -1, 0, 1, 0, 0, 0, 0, 1]);
+    assert.deepEqual(calibration.translation, [0.03, 0.001, -0.02]);
+  });
+
+  it("throws an error when the calibration file does not exist", function () {
+    assert.throws(function () {
+      context.loadCalibration('/does/not/exist.yml');
+    });
+  });
+});
@@ -0,0 +1,102 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Compressed depth", function() {
+  var context = null;
+
+  afterEach(function() {
+    if (context) {
+      context.stopProcessingEvents();
+      context.disable();
+      context = null;
+    }
+  });
+
+  it("round-trips raw depth", function () {
+    var depth = new Buffer(64 * 48 * 2);
+
+    for (var i = 0; i < 64 * 48; i++) {
+      depth.writeUInt16LE(i % 7 == 0 ? 2047 : (i * 13) % 2047, i * 2);
+    }
+
+    var encoded = Kinect.encodeDepth(depth, {width: 64, height: 48});
+    var frame = Kinect.decodeDepth(encoded);
+    assert.equal(frame.width, 64);
+    assert.equal(frame.height, 48);
+    assert.equal(frame.depthFormat, Kinect.DEPTH_11BIT);
+    assert.equal(frame.depth.toString('hex'), depth.toString('hex'));
+  });
+
+  it("round-trips millimetre depth", function () {
+    var depth = new Buffer(640 * 480 * 2);
+    depth.fill(0);
+
+    for (var i = 0; i < 640 * 480; i += 3) {
+      depth.writeUInt16LE(500 + i % 4000, i * 2);
+    }
+
+    var encoded = Kinect.encodeDepth(depth, {depthFormat: Kinect.DEPTH_MM});
+    var frame = Kinect.decodeDepth(encoded);
+    assert.equal(frame.depthFormat, Kinect.DEPTH_MM);
+    assert.equal(frame.depth.toString('hex'), depth.toString('hex'));
+  });
+
+  it("rejects invalid frames", function () {
+    assert.throws(function () {
+      Kinect.encodeDepth(new Buffer(10));
+    });
+    assert.throws(function () {
+      Kinect.decodeDepth(new Buffer(100));
+    });
+
+    var depth = new Buffer(640 * 480 * 2);
+    depth.fill(0);
+    var encoded = Kinect.encodeDepth(depth);
+    assert.throws(function () {
+      Kinect.decodeDepth(encoded.slice(0, encoded.length - 4));
+    });
+
+    // A header asking for a 65535 x 65535 frame
+    var huge = new Buffer(encoded);
+    huge.writeUInt16LE(65535, 4);
+    huge.writeUInt16LE(65535, 6);
+    assert.throws(function () {
+      Kinect.decodeDepth(huge);
+    });
+
+    // Words past the end of the Buffer
+    var long = new Buffer(encoded);
+    long.writeUInt32LE(encoded.length, 12);
+    assert.throws(function () {
+      Kinect.decodeDepth(long);
+    });
+  });
+
+  it("rejects raw values beyond 11 bits", function () {
+    var depth = new Buffer(64 * 48 * 2);
+    depth.fill(0);
+    depth.writeUInt16LE(2048, 100);
+    assert.throws(function () {
+      Kinect.encodeDepth(depth, {width: 64, height: 48});
+    });
+    Kinect.encodeDepth(depth, {width: 64, height: 48,
+        depthFormat: Kinect.DEPTH_MM});
+  });
+
+  it("delivers compressed frames", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic({noise: 0.002});
+    context.startDepth();
+
+    context.setCompressedDepthCallback(function (encoded) {
+      assert(encoded.length < 640 * 480 * 2 / 2);
+      assert.equal(Kinect.decodeDepth(encoded).depth.length, 640 * 480 * 2);
+      context.unsetCompressedDepthCallback();
+      context.stopDepth();
+      done();
+    });
+
+    context.startProcessingEvents();
+  });
+});
@@ -20,6 +20,16 @@ describe("Context", function () {
     });
   });
 
+  it('throws when a device that is not open is started', function () {
+    var device = new Kinect.Device;
+    assert.throws(function () {
+      device.startDepth();
+    });
+    assert.throws(function () {
+      device.startVideo();
+    });
+  });
+
   afterEach(function () {
     if (context) {
       context.disable();
@@ -28,3 +38,44 @@ describe("Context", function () {
   });
 });
 
+
+describe("Modes", function () {
+  var context;
+
+  beforeEach(function () {
+    context = new Kinect.Context;
+  });
+
+  afterEach(function () {
+    context.stopProcessingEvents();
+    context.stopDepth();
+    context.unsetDepthCallback();
+    context.disable();
+  });
+
+  it('exports the formats and resolutions', function () {
+    assert.equal(typeof Kinect.VIDEO_IR_8BIT, 'number');
+    assert.equal(typeof Kinect.DEPTH_MM, 'number');
+    assert.equal(typeof Kinect.RESOLUTION_HIGH, 'number');
+    context.enable(0);
+  });
+
+  it('rejects a combination libfreenect does not support', function () {
+    assert.throws(function () {
+      context.enable(0, {depthFormat: Kinect.DEPTH_MM,
+                         depthResolution: Kinect.RESOLUTION_HIGH});
+    });
+    context.enable(0);
+  });
+
+  it('sizes depth frames for millimetre depth', function (done) {
+    this.timeout(60000);
+    context.enable(0, {depthFormat: Kinect.DEPTH_MM});
+    context.setDepthCallback(function (buf) {
+      assert.equal(buf.length, 640 * 480 * 2);
+      done();
+    });
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+});
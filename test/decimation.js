@@ -0,0 +1,50 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Decimation", function() {
+  var context;
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+    context.enable(0);
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.stopDepth();
+    context.stopVideo();
+    context.unsetDepthCallback();
+    context.unsetVideoCallback();
+    context.disable();
+  });
+
+  it("rejects an invalid level or decimation", function () {
+    assert.throws(function () {
+      context.setDepthCallback(function () {}, {level: 5});
+    });
+    assert.throws(function () {
+      context.setDepthCallback(function () {}, {decimation: 'max'});
+    });
+    context.startProcessingEvents();
+  });
+
+  it("halves depth frames per level", function(done) {
+    this.timeout(60000);
+    context.setDepthCallback(function (buf) {
+      assert.equal(buf.length, 160 * 120 * 2);
+      done();
+    }, {level: 2, decimation: 'median'});
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("halves video frames per level", function(done) {
+    this.timeout(60000);
+    context.setVideoCallback(function (buf) {
+      assert.equal(buf.length, 320 * 240 * 3);
+      done();
+    }, {level: 1});
+    context.startVideo();
+    context.startProcessingEvents();
+  });
+});
@@ -0,0 +1,47 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Demosaic", function() {
+  var context;
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+    context.enable(0, {videoFormat: Kinect.VIDEO_BAYER});
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.stopVideo();
+    context.unsetVideoCallback();
+    context.disable();
+  });
+
+  it("rejects an unknown resolution", function () {
+    assert.throws(function () {
+      context.setDemosaic('quarter');
+    });
+    context.startProcessingEvents();
+  });
+
+  it("delivers full resolution RGB frames", function(done) {
+    this.timeout(60000);
+    context.setDemosaic('full');
+    context.setVideoCallback(function (buf) {
+      assert.equal(buf.length, 640 * 480 * 3);
+      done();
+    });
+    context.startVideo();
+    context.startProcessingEvents();
+  });
+
+  it("delivers half resolution RGB frames", function(done) {
+    this.timeout(60000);
+    context.setDemosaic('half');
+    context.setVideoCallback(function (buf) {
+      assert.equal(buf.length, 320 * 240 * 3);
+      done();
+    });
+    context.startVideo();
+    context.startProcessingEvents();
+  });
+});
@@ -0,0 +1,55 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Devices", function () {
+  var context;
+
+  beforeEach(function () {
+    context = new Kinect.Context;
+    context.enable(0);
+  });
+
+  afterEach(function () {
+    context.disable();
+    context = null;
+  });
+
+  it('counts the connected devices', function () {
+    assert.ok(context.getDeviceCount() >= 1);
+  });
+
+  it('throws an error if the passed device index does not exist', function () {
+    assert.throws(function () {
+      context.openDevice(100);
+    });
+  });
+
+  it('delivers depth from every device', function (done) {
+    this.timeout(60000);
+
+    var count = context.getDeviceCount();
+    var devices = [context];
+    var pending = count;
+
+    for (var i = 1; i < count; i++) {
+      devices.push(context.openDevice(i));
+    }
+
+    devices.forEach(function (device) {
+      var called = false;
+      device.setDepthCallback(function (buf) {
+        assert.equal(buf.length, 640 * 480 * 2);
+        if (called) return;
+        called = true;
+        if (--pending === 0) {
+          context.stopProcessingEvents();
+          devices.forEach(function (device) { device.stopDepth(); });
+          done();
+        }
+      });
+      device.startDepth();
+    });
+
+    context.startProcessingEvents();
+  });
+});
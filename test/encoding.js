@@ -0,0 +1,69 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Encoded video", function() {
+  var context = null;
+
+  afterEach(function() {
+    if (context) {
+      context.stopProcessingEvents();
+      context.disable();
+      context = null;
+    }
+  });
+
+  function encode(options, check, done) {
+    context = new Kinect.Context;
+    context.enableSynthetic();
+    context.startVideo();
+
+    context.setEncodedVideoCallback(function (encoded) {
+      check(encoded);
+      context.unsetEncodedVideoCallback();
+      context.stopVideo();
+      done();
+    }, options);
+
+    context.startProcessingEvents();
+  }
+
+  it("delivers JPEG frames", function (done) {
+    this.timeout(10000);
+    encode({quality: 60, subsampling: '422'}, function (encoded) {
+      assert.equal(encoded.readUInt16BE(0), 0xffd8);
+      assert.equal(encoded.readUInt16BE(encoded.length - 2), 0xffd9);
+      assert(encoded.length < 640 * 480 * 3 / 4);
+    }, done);
+  });
+
+  it("delivers QOI frames", function (done) {
+    this.timeout(10000);
+    encode({format: 'qoi', workers: 1}, function (encoded) {
+      assert.equal(encoded.toString('ascii', 0, 4), 'qoif');
+      assert.equal(encoded.readUInt32BE(4), 640);
+      assert.equal(encoded.readUInt32BE(8), 480);
+    }, done);
+  });
+
+  it("counts encoded frames", function (done) {
+    this.timeout(10000);
+    encode({}, function () {
+      var stats = context.getStats().videoEncoder;
+      assert.equal(stats.encoded, 1);
+      assert(context.getLatencyStats().video.encode.count >= 1);
+    }, done);
+  });
+
+  it("rejects invalid options", function () {
+    context = new Kinect.Context;
+    context.enableSynthetic();
+    var callback = function () {};
+
+    [{format: 'png'}, {quality: 0}, {quality: 101}, {subsampling: '411'},
+        {workers: 0}, {workers: 5}].forEach(function (options) {
+      assert.throws(function () {
+        context.setEncodedVideoCallback(callback, options);
+      });
+    });
+  });
+});
@@ -0,0 +1,243 @@
+var Kinect = require('..');
+var assert = require('assert');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+// Writes a recording of one DEPTH_11BIT / RESOLUTION_MEDIUM frame, to be
+// replayed in a loop.
+function writeFrame(file, frame) {
+  var page = 4096;
+  var bytes = frame.length;
+  var data = new Buffer(page + Math.ceil((64 + bytes) / page) * page);
+  data.fill(0);
+
+  data.writeUInt32LE(0x54434e4b, 0);    // magic
+  data.writeUInt32LE(1, 4);             // version
+  data.writeUInt32LE(page, 8);          // page bytes
+  data.writeUInt32LE(Kinect.RESOLUTION_MEDIUM, 16);
+  data.writeInt32LE(Kinect.DEPTH_11BIT, 20);
+  data.writeUInt32LE(Kinect.RESOLUTION_MEDIUM, 40);
+  data.writeInt32LE(Kinect.VIDEO_RGB, 44);
+
+  data.writeUInt32LE(0x454d5246, page);  // magic
+  data.writeUInt32LE(bytes, page + 32);
+  frame.copy(data, page + 64);
+  fs.writeFileSync(file, data);
+}
+
+// A flat frame at 800 with a short hole between 800 and 806 on row 100,
+// one between a near 700 and a far 900 on row 200, a 20 x 20 hole at
+// (300, 300) and a 40 x 3 one at (400, 400).
+function holeFrame() {
+  var frame = new Buffer(640 * 480 * 2);
+
+  for (var y = 0; y < 480; y++) {
+    for (var x = 0; x < 640; x++) {
+      var value = 800;
+
+      if (y == 100) {
+        value = x < 100 ? 800 : x < 104 ? 2047 : 806;
+      } else if (y == 200) {
+        value = x < 300 ? 700 : x < 304 ? 2047 : 900;
+      } else if (y >= 300 && y < 320 && x >= 300 && x < 320) {
+        value = 2047;
+      } else if (y >= 400 && y < 403 && x >= 400 && x < 440) {
+        value = 2047;
+      }
+
+      frame.writeUInt16LE(value, (y * 640 + x) * 2);
+    }
+  }
+
+  return frame;
+}
+
+describe("Depth filter", function() {
+  var context = null;
+
+  afterEach(function() {
+    if (context) {
+      context.stopProcessingEvents();
+      context.disable();
+      context = null;
+    }
+  });
+
+  function invalidPixels(depth) {
+    var invalid = 0;
+
+    for (var i = 0; i < depth.length; i += 2) {
+      if (depth.readUInt16LE(i) == 2047) {
+        invalid++;
+      }
+    }
+
+    return invalid;
+  }
+
+  it("reduces the sliding holes of synthetic frames", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic({holes: true});
+
+    var frames = 0;
+    var raw = 0;
+    context.setDepthCallback(function (depth) {
+      frames++;
+
+      if (frames == 2) {
+        raw = invalidPixels(depth);
+        context.setDepthFilter({temporal: 'median', fill: 16});
+      } else if (frames == 5) {
+        assert(raw > 0);
+        assert(invalidPixels(depth) < raw);
+        context.stopDepth();
+        done();
+      }
+    });
+
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  // Mean difference between neighbours on the same surface
+  function roughness(depth) {
+    var total = 0;
+    var count = 0;
+
+    for (var i = 0; i + 2 < depth.length; i += 2) {
+      var difference = Math.abs(depth.readUInt16LE(i + 2)
+          - depth.readUInt16LE(i));
+
+      if (difference < 20) {
+        total += difference;
+        count++;
+      }
+    }
+
+    return total / count;
+  }
+
+  it("fills short holes along rows and columns", function (done) {
+    this.timeout(10000);
+    var file = path.join(os.tmpdir(), 'kinect-filter-test.knct');
+    writeFrame(file, holeFrame());
+    context = new Kinect.Context;
+    context.enableReplay(file, {loop: true});
+    context.setDepthFilter({temporal: 'off', fill: 16});
+
+    context.setDepthCallback(function (depth) {
+      function at(x, y) {
+        return depth.readUInt16LE((y * 640 + x) * 2);
+      }
+
+      // Within the threshold the hole is interpolated
+      var previous = 800;
+      for (var x = 100; x < 104; x++) {
+        assert(at(x, 100) > previous && at(x, 100) < 806,
+               'pixel ' + x + ' is ' + at(x, 100));
+        previous = at(x, 100);
+      }
+
+      // Across surfaces it takes the farther value
+      for (x = 300; x < 304; x++) {
+        assert.equal(at(x, 200), 900);
+      }
+
+      // Too long along rows, but short along columns
+      assert.equal(at(400, 400), 800);
+      assert.equal(at(420, 401), 800);
+
+      // Longer than fill both ways, so left invalid
+      assert.equal(at(300, 300), 2047);
+      assert.equal(at(319, 319), 2047);
+      assert.equal(at(320, 310), 800);
+
+      context.stopDepth();
+      fs.unlinkSync(file);
+      done();
+    });
+
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("smooths within surfaces", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic({noise: 0.01, holes: false});
+
+    var frames = 0;
+    var raw = 0;
+    context.setDepthCallback(function (depth) {
+      frames++;
+
+      if (frames == 2) {
+        raw = roughness(depth);
+        context.setDepthFilter({temporal: 'off', spatial: 'bilateral',
+            radius: 3});
+      } else if (frames == 5) {
+        assert(roughness(depth) < raw);
+        context.stopDepth();
+        done();
+      }
+    });
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("can be cleared", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic();
+    context.setDepthFilter();
+    context.clearDepthFilter();
+    context.setDepthCallback(function (depth) {
+      assert.equal(depth.length, 640 * 480 * 2);
+      context.stopDepth();
+      done();
+    });
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("delivers nothing once stopped while filtering", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic({noise: 0.01});
+    context.setDepthFilter({spatial: 'bilateral'});
+
+    var frames = 0;
+    context.setDepthCallback(function () {
+      frames++;
+
+      if (frames == 2) {
+        // Stopped between frames, while the worker may be filtering one
+        setImmediate(function () {
+          context.stopDepth();
+          var delivered = frames;
+          setTimeout(function () {
+            assert.equal(frames, delivered);
+            done();
+          }, 100);
+        });
+      }
+    });
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("rejects invalid options", function () {
+    context = new Kinect.Context;
+    context.enableSynthetic();
+
+    [{temporal: 'mean'}, {alpha: 0}, {alpha: 1.5}, {hold: -1}, {frames: 4},
+        {spatial: 'guided'}, {radius: 0}, {radius: 6}, {fill: 65},
+        {threshold: -1}].forEach(function (options) {
+      assert.throws(function () {
+        context.setDepthFilter(options);
+      });
+    });
+  });
+});
@@ -0,0 +1,87 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Latency", function() {
+  var context;
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+    context.enableSynthetic({fps: 60});
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.disable();
+  });
+
+  it("starts with no durations recorded", function () {
+    var latency = context.getLatencyStats();
+    ['depth', 'video'].forEach(function (stream) {
+      ['dispatch', 'callback', 'total'].forEach(function (stage) {
+        assert.equal(latency[stream][stage].count, 0);
+      });
+    });
+    ['update', 'process', 'callback', 'total'].forEach(function (stage) {
+      assert.equal(latency.world[stage].count, 0);
+    });
+    context.startProcessingEvents();
+  });
+
+  it("rejects a reset that is not a boolean", function () {
+    assert.throws(function () {
+      context.getLatencyStats(1);
+    });
+    context.startProcessingEvents();
+  });
+
+  it("records depth frames until reset", function(done) {
+    this.timeout(10000);
+    context.startDepth();
+
+    var remaining = 10;
+
+    context.setDepthCallback(function (buf) {
+      if (--remaining > 0) {
+        return;
+      }
+
+      context.stopDepth();
+
+      // The last callback has not returned yet.
+      var total = context.getLatencyStats(true).depth.total;
+      assert.equal(total.count, 9);
+      assert(total.min > 0);
+      assert(total.min <= total.p50 && total.p50 <= total.max);
+
+      assert.equal(context.getLatencyStats().depth.total.count, 0);
+      done();
+    });
+
+    context.startProcessingEvents();
+  });
+
+  it("records world frames from publishing to the callback", function(done) {
+    this.timeout(10000);
+    var remaining = 3;
+
+    context.setWorldCallback(function () {
+      if (--remaining > 0) {
+        return;
+      }
+
+      context.unsetWorldCallback();
+      context.stopDepth();
+      context.stopVideo();
+
+      var world = context.getLatencyStats().world;
+      assert.equal(world.total.count, 2);
+      assert(world.total.min > 0);
+      assert(world.total.max >= world.callback.max);
+      done();
+    });
+
+    context.startDepth();
+    context.startVideo();
+    context.startProcessingEvents();
+  });
+});
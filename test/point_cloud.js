@@ -0,0 +1,48 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Point cloud", function() {
+  var context;
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+    context.enable(0);
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.unsetPointCloudCallback();
+    context.stopDepth();
+    context.stopVideo();
+    context.disable();
+  });
+
+  it("rejects a callback that is not a function", function () {
+    assert.throws(function () {
+      context.setPointCloudCallback({rgb: true});
+    });
+    context.startProcessingEvents();
+  });
+
+  it("delivers 3 floats per pixel", function(done) {
+    this.timeout(60000);
+    context.setPointCloudCallback(function (buf) {
+      assert.equal(buf.length, 640 * 480 * 3 * 4);
+      done();
+    });
+    context.startDepth();
+    context.startVideo();
+    context.startProcessingEvents();
+  });
+
+  it("delivers 4 floats per pixel with rgb", function(done) {
+    this.timeout(60000);
+    context.setPointCloudCallback(function (buf) {
+      assert.equal(buf.length, 640 * 480 * 4 * 4);
+      done();
+    }, {rgb: true});
+    context.startDepth();
+    context.startVideo();
+    context.startProcessingEvents();
+  });
+});
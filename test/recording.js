@@ -0,0 +1,65 @@
+var Kinect = require('..');
+var assert = require('assert');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+describe("Recording", function() {
+  var context;
+  var file = path.join(os.tmpdir(), 'kinect-recording-test.knct');
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+    context.enable(0);
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.stopDepth();
+    context.unsetDepthCallback();
+    context.disable();
+    if (fs.existsSync(file)) fs.unlinkSync(file);
+  });
+
+  it("rejects a second recording", function () {
+    context.startRecording(file);
+    assert.throws(function () {
+      context.startRecording(file);
+    });
+    context.stopRecording();
+    context.startProcessingEvents();
+  });
+
+  it("writes depth frames and an index", function(done) {
+    this.timeout(60000);
+    context.startRecording(file);
+    context.setDepthCallback(handleDepth);
+    context.startDepth();
+    context.startProcessingEvents();
+
+    var remaining = 30;
+
+    function handleDepth(buf) {
+      remaining--;
+
+      if (remaining == 0) {
+        context.stopRecording();
+
+        var stats = context.getRecordingStats();
+        assert.equal(stats.recording, false);
+        assert(stats.depth.written > 0, 'no depth frames written');
+        assert.equal(stats.video.written, 0);
+
+        var data = fs.readFileSync(file);
+        assert.equal(data.length, stats.bytes);
+        assert.equal(data.readUInt32LE(0), 0x54434e4b);
+
+        // The trailer counts every record written.
+        var trailer = data.length - 24;
+        assert.equal(data.readUInt32LE(trailer), 0x5844494b);
+        assert.equal(data.readUInt32LE(trailer + 16), stats.depth.written);
+        done();
+      }
+    }
+  });
+});
@@ -0,0 +1,59 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Region of interest", function() {
+  var context;
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+    context.enable(0);
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.stopDepth();
+    context.unsetDepthCallback();
+    context.clearRegionOfInterest();
+    context.clearDepthRange();
+    context.disable();
+  });
+
+  it("rejects a region outside the frame", function () {
+    assert.throws(function () {
+      context.setRegionOfInterest(600, 0, 100, 100);
+    });
+    assert.throws(function () {
+      context.setRegionOfInterest(0, 0, 0, 100);
+    });
+    context.startProcessingEvents();
+  });
+
+  it("rejects an empty depth range", function () {
+    assert.throws(function () {
+      context.setDepthRange(1.5, 0.5);
+    });
+    context.startProcessingEvents();
+  });
+
+  it("crops and masks depth frames", function(done) {
+    this.timeout(60000);
+    context.setRegionOfInterest(160, 120, 320, 240);
+    context.setDepthRange(0.5, 1.5);
+    context.setDepthCallback(handleDepth);
+    context.startDepth();
+    context.startProcessingEvents();
+
+    function handleDepth(buf) {
+      assert.equal(buf.length, 320 * 240 * 2);
+
+      for (var i = 0; i < buf.length; i += 2) {
+        var raw = buf.readUInt16LE(i);
+        var metres = 1 / (raw * -0.0030711016 + 3.3309495161);
+        assert(raw == 2047 || (metres >= 0.5 - 1e-3 && metres <= 1.5 + 1e-3),
+               'raw depth ' + raw + ' outside the range');
+      }
+
+      done();
+    }
+  });
+});
@@ -0,0 +1,165 @@
+var Kinect = require('..');
+var assert = require('assert');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+
+// Writes a recording of depth frames filled with their index, in
+// DEPTH_11BIT / RESOLUTION_MEDIUM, without the index so the records are
+// scanned. With bayer, the frames are VIDEO_BAYER video frames instead.
+function writeRecording(file, frames, bayer) {
+  var page = 4096;
+  var bytes = bayer ? 640 * 480 : 640 * 480 * 2;
+  var record = Math.ceil((64 + bytes) / page) * page;
+  var data = new Buffer(page + frames * record);
+  data.fill(0);
+
+  data.writeUInt32LE(0x54434e4b, 0);    // magic
+  data.writeUInt32LE(1, 4);             // version
+  data.writeUInt32LE(page, 8);          // page bytes
+  data.writeUInt32LE(Kinect.RESOLUTION_MEDIUM, 16);
+  data.writeInt32LE(Kinect.DEPTH_11BIT, 20);
+  data.writeUInt32LE(Kinect.RESOLUTION_MEDIUM, 40);
+  data.writeInt32LE(bayer ? Kinect.VIDEO_BAYER : Kinect.VIDEO_RGB, 44);
+
+  for (var i = 0; i < frames; i++) {
+    var offset = page + i * record;
+    data.writeUInt32LE(0x454d5246, offset);         // magic
+    data.writeUInt32LE(bayer ? 1 : 0, offset + 4);  // video or depth
+    data.writeUInt32LE(i, offset + 8);              // timestamp
+    data.writeUInt32LE(i * 33333333, offset + 16);  // host time
+    data.writeUInt32LE(i, offset + 24);             // sequence
+    data.writeUInt32LE(bytes, offset + 32);
+    data.fill(i, offset + 64, offset + 64 + bytes);
+  }
+
+  fs.writeFileSync(file, data);
+}
+
+describe("Replay", function() {
+  var context;
+  var file = path.join(os.tmpdir(), 'kinect-replay-test.knct');
+
+  before(function () {
+    writeRecording(file, 10);
+  });
+
+  after(function () {
+    fs.unlinkSync(file);
+  });
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.disable();
+  });
+
+  it("rejects a file that is not a recording", function () {
+    assert.throws(function () {
+      context.enableReplay(__filename);
+    });
+    context.startProcessingEvents();
+  });
+
+  it("delivers the recorded depth frames in order", function(done) {
+    this.timeout(10000);
+    context.enableReplay(file);
+    context.startDepth();
+
+    var next = 0;
+
+    // Frames may only be skipped if the loop falls behind.
+    context.setDepthCallback(function (buf) {
+      assert.equal(buf.length, 640 * 480 * 2);
+      assert(buf[0] >= next, 'frame out of order');
+      next = buf[0] + 1;
+
+      if (next == 10) {
+        context.stopDepth();
+        done();
+      }
+    });
+
+    context.startProcessingEvents();
+  });
+
+  it("loops as fast as possible", function(done) {
+    this.timeout(10000);
+    context.enableReplay(file, {speed: 0, loop: true});
+    context.startDepth();
+
+    context.setDepthCallback(function (buf) {
+      if (context.getStats().depth.produced > 100) {
+        context.stopDepth();
+        done();
+      }
+    });
+
+    context.startProcessingEvents();
+  });
+
+  it("stops a replay playing as fast as possible", function(done) {
+    this.timeout(10000);
+    context.enableReplay(file, {speed: 0, loop: true});
+    context.startDepth();
+
+    context.setDepthCallback(function () {
+      context.setDepthCallback(function () {});
+      context.stopDepth();
+
+      // No frame is produced once the stream is stopped.
+      var produced = context.getStats().depth.produced;
+      setTimeout(function () {
+        assert.equal(context.getStats().depth.produced, produced);
+        done();
+      }, 100);
+    });
+
+    context.startProcessingEvents();
+  });
+
+  it("demosaics a recorded Bayer stream", function(done) {
+    this.timeout(10000);
+    var bayer = path.join(os.tmpdir(), 'kinect-replay-bayer-test.knct');
+    writeRecording(bayer, 10, true);
+    context.enableReplay(bayer, {loop: true});
+    context.startVideo();
+
+    // Set while streaming, so the crop must follow the RGB mode.
+    context.setDemosaic('full');
+    context.setRegionOfInterest(160, 120, 320, 240);
+    context.setVideoCallback(function (buf) {
+      assert.equal(buf.length, 320 * 240 * 3);
+      context.stopVideo();
+      context.clearRegionOfInterest();
+      fs.unlinkSync(bayer);
+      done();
+    });
+
+    context.startProcessingEvents();
+  });
+
+  it("scales the region of interest to the video frame", function(done) {
+    this.timeout(10000);
+    var bayer = path.join(os.tmpdir(), 'kinect-replay-bayer-test.knct');
+    writeRecording(bayer, 10, true);
+    context.enableReplay(bayer, {loop: true});
+
+    // 320 x 240 video for 640 x 480 depth
+    context.setDemosaic('half');
+    context.setRegionOfInterest(160, 120, 320, 240);
+    context.setVideoCallback(function (buf) {
+      assert.equal(buf.length, 160 * 120 * 3);
+      context.stopVideo();
+      context.clearRegionOfInterest();
+      fs.unlinkSync(bayer);
+      done();
+    });
+
+    context.startVideo();
+    context.startProcessingEvents();
+  });
+});
@@ -0,0 +1,51 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Stats", function() {
+  var context;
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+    context.enable(0);
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.stopDepth();
+    context.unsetDepthCallback();
+    context.disable();
+  });
+
+  it("starts with no frames counted", function () {
+    var stats = context.getStats();
+    ['depth', 'video'].forEach(function (stream) {
+      assert.equal(stats[stream].produced, 0);
+      assert.equal(stats[stream].delivered, 0);
+      assert.equal(stats[stream].coalesced, 0);
+      assert.equal(stats[stream].dropped, 0);
+    });
+    context.startProcessingEvents();
+  });
+
+  it("counts depth frames as they are delivered", function(done) {
+    this.timeout(60000);
+    context.setDepthCallback(handleDepth);
+    context.startDepth();
+    context.startProcessingEvents();
+
+    var remaining = 30;
+
+    function handleDepth(buf) {
+      remaining--;
+
+      if (remaining == 0) {
+        var stats = context.getStats().depth;
+        assert.equal(stats.delivered, 30);
+        assert(stats.produced >= stats.delivered, 'produced < delivered');
+        assert(stats.produced >= stats.delivered + stats.dropped,
+               'produced < delivered + dropped');
+        done();
+      }
+    }
+  });
+});
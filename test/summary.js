@@ -0,0 +1,69 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Depth summary", function() {
+  var context = null;
+
+  afterEach(function() {
+    if (context) {
+      context.stopProcessingEvents();
+      context.disable();
+      context = null;
+    }
+  });
+
+  it("summarises the synthetic scene", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic({depthFormat: Kinect.DEPTH_MM});
+    context.setDepthSummaryCallback(function (summary) {
+      assert(summary.valid > 0 && summary.valid <= 640 * 480);
+      assert(summary.min > 0.5 && summary.min <= summary.mean);
+      assert(summary.mean <= summary.max && summary.max < 4);
+      assert.equal(summary.histogram.length, 16);
+
+      var binned = summary.histogram.reduce(function (a, b) {
+        return a + b;
+      }, 0);
+      assert(binned <= summary.valid);
+
+      assert.equal(summary.cells.length, 6);
+      var valid = summary.cells.reduce(function (total, cell) {
+        return total + cell.valid;
+      }, 0);
+      assert.equal(valid, summary.valid);
+
+      context.stopDepth();
+      done();
+    }, {bins: 16, min: 1, max: 3, columns: 3, rows: 2});
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("leaves out cells for a single cell", function (done) {
+    this.timeout(10000);
+    context = new Kinect.Context;
+    context.enableSynthetic();
+    context.setDepthSummaryCallback(function (summary) {
+      assert.equal(summary.cells, undefined);
+      assert.equal(summary.histogram.length, 64);
+      context.unsetDepthSummaryCallback();
+      context.stopDepth();
+      done();
+    });
+    context.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("rejects invalid options", function () {
+    context = new Kinect.Context;
+    context.enableSynthetic();
+
+    [{bins: 0}, {bins: 1025}, {columns: 0}, {rows: 17}, {min: -1},
+        {min: 2, max: 1}, {max: 'far'}].forEach(function (options) {
+      assert.throws(function () {
+        context.setDepthSummaryCallback(function () {}, options);
+      });
+    });
+  });
+});
@@ -0,0 +1,150 @@
+var Kinect = require('..');
+var assert = require('assert');
+
+describe("Synthetic", function() {
+  var context;
+
+  beforeEach(function() {
+    context = new Kinect.Context;
+  });
+
+  afterEach(function() {
+    context.stopProcessingEvents();
+    context.disable();
+  });
+
+  it("rejects invalid options", function () {
+    assert.throws(function () {
+      context.enableSynthetic({width: 0});
+    });
+    assert.throws(function () {
+      context.enableSynthetic({depthFormat: Kinect.VIDEO_RGB});
+    });
+    assert.throws(function () {
+      context.enableSynthetic({spheres: 9});
+    });
+    assert.throws(function () {
+      context.enableSynthetic({fps: -1});
+    });
+  });
+
+  it("renders depth of any size", function(done) {
+    this.timeout(10000);
+    context.enableSynthetic({width: 1280, height: 960, fps: 0});
+    context.startDepth();
+
+    context.setDepthCallback(function (buf) {
+      assert.equal(buf.length, 1280 * 960 * 2);
+      context.stopDepth();
+      done();
+    });
+
+    context.startProcessingEvents();
+  });
+
+  it("idles until a stream starts, as fast as possible", function(done) {
+    this.timeout(10000);
+    context.enableSynthetic({fps: 0});
+    context.startProcessingEvents();
+
+    setTimeout(function () {
+      assert.equal(context.getStats().depth.produced, 0);
+
+      context.setDepthCallback(function () {
+        context.stopDepth();
+        done();
+      });
+      context.startDepth();
+    }, 100);
+  });
+
+  it("renders the plane in millimetres", function(done) {
+    this.timeout(10000);
+    context.enableSynthetic({
+      depthFormat: Kinect.DEPTH_MM, spheres: 0, holes: false
+    });
+    context.startDepth();
+
+    // The plane is level along each row, 2.5 m away at first.
+    context.setDepthCallback(function (buf) {
+      var row = 240 * 640 * 2;
+      var centre = buf.readUInt16LE(row + 320 * 2);
+      assert(Math.abs(centre - 2500) < 100, 'centre at ' + centre);
+
+      for (var x = 0; x < 640; x++) {
+        assert.equal(buf.readUInt16LE(row + x * 2), centre);
+      }
+
+      context.stopDepth();
+      done();
+    });
+
+    context.startProcessingEvents();
+  });
+
+  it("delivers video at the frame rate", function(done) {
+    this.timeout(10000);
+    context.enableSynthetic({fps: 120});
+    context.startVideo();
+
+    var frames = 0;
+
+    context.setVideoCallback(function (buf) {
+      assert.equal(buf.length, 640 * 480 * 3);
+
+      if (++frames == 60) {
+        context.stopVideo();
+        done();
+      }
+    });
+
+    context.startProcessingEvents();
+  });
+
+  it("closes a device only once events stop", function(done) {
+    this.timeout(10000);
+    context.enableSynthetic();
+    var device = context.openSynthetic();
+
+    device.setDepthCallback(function () {
+      device.unsetDepthCallback();
+      assert.throws(function () {
+        device.close();
+      });
+
+      // Closing stops the depth stream.
+      context.stopProcessingEvents();
+      device.close();
+      context.startProcessingEvents();
+      done();
+    });
+
+    device.startDepth();
+    context.startProcessingEvents();
+  });
+
+  it("calls the context's callbacks on the context", function(done) {
+    this.timeout(10000);
+    context.enableSynthetic();
+    var device = context.openSynthetic();
+    var pending = 2;
+
+    function check(object) {
+      return function () {
+        assert.strictEqual(this, object);
+        object.stopDepth();
+        object.unsetDepthCallback();
+
+        if (--pending === 0) {
+          done();
+        }
+      };
+    }
+
+    context.setDepthCallback(check(context));
+    device.setDepthCallback(check(device));
+    context.startDepth();
+    device.startDepth();
+    context.startProcessingEvents();
+  });
+});